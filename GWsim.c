@@ -185,29 +185,29 @@ long double dotProduct(long double *m1,long double *m2)
 #ifdef __cplusplus
 extern "C"
 #endif
-void GWbackground(gwSrc *gw,int numberGW,long *idum,long double flo,long double fhi,
+void GWbackground(gwSrc *gw,int numberGW,TKstream *stream,long double flo,long double fhi,
 		  double gwAmp,double alpha,int loglin)
 {
   int k;
   for (k=0;k<numberGW;k++)
     {
-      gw[k].theta_g     = acos((TKranDev(idum)-0.5)*2);  
-      gw[k].phi_g       = TKranDev(idum)*2*M_PI;
+      gw[k].theta_g     = acos((TKstreamRanDev(stream)-0.5)*2);  
+      gw[k].phi_g       = TKstreamRanDev(stream)*2*M_PI;
       gw[k].phi_polar_g = 0.0; 
-      gw[k].phase_g     = TKranDev(idum)*2*M_PI; 
+      gw[k].phase_g     = TKstreamRanDev(stream)*2*M_PI; 
       if (loglin==1)  /* Use equal sampling in log */
 	{
-	  gw[k].omega_g  = 2*M_PI*exp(log(flo)+TKranDev(idum)*(log(fhi/flo))); 
-	  gw[k].aplus_g  = gwAmp*pow(gw[k].omega_g/(2.0*M_PI), alpha)/sqrt((double)(numberGW)/log(fhi/flo))*TKgaussDev(idum);
-	  gw[k].across_g = gwAmp*pow(gw[k].omega_g/(2.0*M_PI), alpha)/sqrt((double)(numberGW)/log(fhi/flo))*TKgaussDev(idum);
+	  gw[k].omega_g  = 2*M_PI*exp(log(flo)+TKstreamRanDev(stream)*(log(fhi/flo))); 
+	  gw[k].aplus_g  = gwAmp*pow(gw[k].omega_g/(2.0*M_PI), alpha)/sqrt((double)(numberGW)/log(fhi/flo))*TKstreamGaussDev(stream);
+	  gw[k].across_g = gwAmp*pow(gw[k].omega_g/(2.0*M_PI), alpha)/sqrt((double)(numberGW)/log(fhi/flo))*TKstreamGaussDev(stream);
 	  gw[k].aplus_im_g = 0.0;
 	  gw[k].across_im_g = 0.0;
 	}      
       else
 	{
-	  gw[k].omega_g = 2*M_PI*(TKranDev(idum)*(fhi-flo)+flo); 
-	  gw[k].aplus_g = gwAmp*pow(gw[k].omega_g/(2.0*M_PI), alpha)*sqrt(1.0/(double)numberGW)*(sqrt((fhi-flo)*(2.0*M_PI)/gw[k].omega_g))*TKgaussDev(idum);
-	  gw[k].across_g = gwAmp*pow(gw[k].omega_g/(2.0*M_PI), alpha)*sqrt(1.0/(double)numberGW)*(sqrt((fhi-flo)*(2.0*M_PI)/gw[k].omega_g))*TKgaussDev(idum); 
+	  gw[k].omega_g = 2*M_PI*(TKstreamRanDev(stream)*(fhi-flo)+flo); 
+	  gw[k].aplus_g = gwAmp*pow(gw[k].omega_g/(2.0*M_PI), alpha)*sqrt(1.0/(double)numberGW)*(sqrt((fhi-flo)*(2.0*M_PI)/gw[k].omega_g))*TKstreamGaussDev(stream);
+	  gw[k].across_g = gwAmp*pow(gw[k].omega_g/(2.0*M_PI), alpha)*sqrt(1.0/(double)numberGW)*(sqrt((fhi-flo)*(2.0*M_PI)/gw[k].omega_g))*TKstreamGaussDev(stream); 
 	  gw[k].aplus_im_g = 0.0;
 	  gw[k].across_im_g = 0.0;
 	}
@@ -53,6 +53,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include "T2toolkit.h"
 
 /* Have a structure to define a gravitational wave source */
 typedef struct gwSrc
@@ -100,7 +101,7 @@ long double matrixMult(long double m1[3][3],long double m2[3][3],long double out
 
 long double dotProduct(long double *m1,long double *m2);
 
-void GWbackground(gwSrc *gw,int numberGW,long *idum,long double flo,long double fhi,
+void GWbackground(gwSrc *gw,int numberGW,TKstream *stream,long double flo,long double fhi,
 		  double gwAmp,double alpha,int loglin);
 
 long double calculateResidualGW(long double *kp,gwSrc *gw,long double time,long double dist);
@@ -504,8 +504,9 @@ long TKsetSeed()
 #define RAND_N 624
 #define RAND_M 397
 
-static unsigned long rand_mt[RAND_N]; /* the array for the state vector  */
-static int rand_mti=RAND_N+1; /* rand_mti==RAND_N+1 means rand_mt[RAND_N] is not initialized */
+/* Each thread has its own generator state, which it seeds through TKranDev */
+static __thread unsigned long rand_mt[RAND_N]; /* the array for the state vector  */
+static __thread int rand_mti=RAND_N+1; /* rand_mti==RAND_N+1 means rand_mt[RAND_N] is not initialized */
 
 /* initializes rand_mt[RAND_N] with a seed */
 void init_genrand(unsigned long s)
@@ -571,3 +572,191 @@ double genrand_real1(void)
 }
 
 
+
+/* ************************************************************** */
+/* Counter based random numbers                                   */
+/* ************************************************************** */
+
+/* Philox4x32-10 (Salmon et al. 2011, "Parallel random numbers: as easy
+ * as 1, 2, 3"). Each block of four 32 bit words is a function of the key
+ * and the counter only, so a stream can be recreated anywhere without
+ * knowing what was drawn before it. */
+
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+
+void TKphilox4x32(const uint32_t ctr[4],const uint32_t key[2],uint32_t out[4])
+{
+  uint32_t c0,c1,c2,c3,k0,k1;
+  uint64_t p0,p1;
+  int i;
+
+  c0 = ctr[0]; c1 = ctr[1]; c2 = ctr[2]; c3 = ctr[3];
+  k0 = key[0]; k1 = key[1];
+  for (i=0;i<10;i++)
+    {
+      p0 = (uint64_t)PHILOX_M0*c0;
+      p1 = (uint64_t)PHILOX_M1*c2;
+      c0 = (uint32_t)(p1>>32)^c1^k0;
+      c1 = (uint32_t)p1;
+      c2 = (uint32_t)(p0>>32)^c3^k1;
+      c3 = (uint32_t)p0;
+      k0 += PHILOX_W0;
+      k1 += PHILOX_W1;
+    }
+  out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+/* Sets up the stream identified by (seed, realisation, pulsar, effect, index).
+ * Negative realisation, pulsar or index values can be used for streams that
+ * do not depend on them. Only the lower 32 bits of the seed are used. */
+void TKstreamInit(TKstream *stream,unsigned long seed,int real,int psr,int effect,int index)
+{
+  stream->key[0] = (uint32_t)seed;
+  stream->key[1] = (uint32_t)effect;
+  stream->ctr[0] = 0;            /* Block number within the stream */
+  stream->ctr[1] = (uint32_t)index;
+  stream->ctr[2] = (uint32_t)psr;
+  stream->ctr[3] = (uint32_t)real;
+  stream->nout = 0;
+  stream->haveGauss = 0;
+}
+
+/* Returns the next 32 bit word from the stream */
+uint32_t TKstreamInt32(TKstream *stream)
+{
+  if (stream->nout == 0)
+    {
+      TKphilox4x32(stream->ctr,stream->key,stream->out);
+      stream->ctr[0]++;
+      stream->nout = 4;
+    }
+  return stream->out[4-(stream->nout--)];
+}
+
+/* Returns random deviate between 0 and 1 (never exactly 0 or 1) */
+double TKstreamRanDev(TKstream *stream)
+{
+  return (TKstreamInt32(stream)+0.5)*(1.0/4294967296.0);
+}
+
+/* Returns Gaussian random deviates using the same polar method as
+ * TKgaussDev, but keeping the second deviate for the next call */
+double TKstreamGaussDev(TKstream *stream)
+{
+  double x, y, r2, f;
+
+  if (stream->haveGauss)
+    {
+      stream->haveGauss = 0;
+      return stream->gauss;
+    }
+  do
+    {
+      x = -1 + 2 * TKstreamRanDev(stream);
+      y = -1 + 2 * TKstreamRanDev(stream);
+      r2 = x * x + y * y;
+    }
+  while (r2 > 1.0 || r2 == 0);
+
+  f = sqrt (-2.0 * log (r2) / r2);
+  stream->gauss = x * f;
+  stream->haveGauss = 1;
+  return y * f;
+}
+
+/* Generates n consecutive blocks of the stream at once. The rounds are
+ * applied to all the blocks together so that the compiler can vectorise
+ * the multiplications */
+#define TK_FILL_BLOCKS 64
+
+static void TKstreamBlocks(TKstream *stream,int n,uint32_t *out)
+{
+  uint32_t c0[TK_FILL_BLOCKS],c1[TK_FILL_BLOCKS],c2[TK_FILL_BLOCKS],c3[TK_FILL_BLOCKS];
+  uint32_t t0,t2,k0,k1;
+  uint64_t p0,p1;
+  int i,j;
+
+  for (j=0;j<n;j++)
+    {
+      c0[j] = stream->ctr[0]+j;
+      c1[j] = stream->ctr[1];
+      c2[j] = stream->ctr[2];
+      c3[j] = stream->ctr[3];
+    }
+  k0 = stream->key[0]; k1 = stream->key[1];
+  for (i=0;i<10;i++)
+    {
+      for (j=0;j<n;j++)
+	{
+	  p0 = (uint64_t)PHILOX_M0*c0[j];
+	  p1 = (uint64_t)PHILOX_M1*c2[j];
+	  t0 = (uint32_t)(p1>>32)^c1[j]^k0;
+	  t2 = (uint32_t)(p0>>32)^c3[j]^k1;
+	  c1[j] = (uint32_t)p1;
+	  c3[j] = (uint32_t)p0;
+	  c0[j] = t0;
+	  c2[j] = t2;
+	}
+      k0 += PHILOX_W0;
+      k1 += PHILOX_W1;
+    }
+  for (j=0;j<n;j++)
+    {
+      out[4*j]   = c0[j];
+      out[4*j+1] = c1[j];
+      out[4*j+2] = c2[j];
+      out[4*j+3] = c3[j];
+    }
+  stream->ctr[0] += n;
+  stream->nout = 0;
+}
+
+/* Fills out[0..n-1] with random deviates between 0 and 1. Each call starts
+ * at a new block of the stream and deviate i is taken from word i */
+void TKstreamRanDevFill(TKstream *stream,double *out,size_t n)
+{
+  uint32_t w[4*TK_FILL_BLOCKS];
+  size_t i,m;
+  int k,nb;
+
+  for (i=0;i<n;i+=m)
+    {
+      m = n-i;
+      if (m > 4*TK_FILL_BLOCKS) m = 4*TK_FILL_BLOCKS;
+      nb = (int)((m+3)/4);
+      TKstreamBlocks(stream,nb,w);
+      for (k=0;k<(int)m;k++)
+	out[i+k] = (w[k]+0.5)*(1.0/4294967296.0);
+    }
+}
+
+/* Fills out[0..n-1] with Gaussian random deviates. This uses the
+ * trigonometric form of the Box-Muller transform (no rejection step) so
+ * each pair of deviates comes from a fixed pair of words in the stream.
+ * The values therefore differ from those given by TKstreamGaussDev */
+void TKgaussDevFill(TKstream *stream,double *out,size_t n)
+{
+  double u[4*TK_FILL_BLOCKS];
+  double r,theta;
+  size_t i,m;
+  int k;
+
+  for (i=0;i<n;i+=m)
+    {
+      m = n-i;
+      if (m > 4*TK_FILL_BLOCKS) m = 4*TK_FILL_BLOCKS;
+      TKstreamRanDevFill(stream,u,(m+1)&~(size_t)1);
+      for (k=0;k+1<(int)m;k+=2)
+	{
+	  r = sqrt(-2.0*log(u[k]));
+	  theta = 2.0*M_PI*u[k+1];
+	  out[i+k]   = r*cos(theta);
+	  out[i+k+1] = r*sin(theta);
+	}
+      if (k < (int)m) /* Odd number requested */
+	out[i+k] = sqrt(-2.0*log(u[k]))*cos(2.0*M_PI*u[k+1]);
+    }
+}
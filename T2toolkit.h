@@ -24,6 +24,12 @@
 *    timing model.
 */
 
+#ifndef T2TOOLKIT_H
+#define T2TOOLKIT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
 
 
 /* ************************************************************** */
@@ -88,3 +94,29 @@ void init_genrand(unsigned long s);
 unsigned long genrand_int32(void);
 double genrand_real1(void);
 
+
+/* ************************************************************** */
+/* Counter based random numbers                                   */
+/* ************************************************************** */
+
+/* One independent random number stream. A draw depends only on the key
+ * (seed and effect), the identifiers in the counter and its position in
+ * the stream, not on the order in which streams are used */
+typedef struct TKstream {
+  uint32_t key[2];
+  uint32_t ctr[4];
+  uint32_t out[4];  /* Last block generated */
+  int nout;         /* Words of out[] that have not been used */
+  int haveGauss;
+  double gauss;     /* Spare Gaussian deviate */
+} TKstream;
+
+void TKphilox4x32(const uint32_t ctr[4],const uint32_t key[2],uint32_t out[4]);
+void TKstreamInit(TKstream *stream,unsigned long seed,int real,int psr,int effect,int index);
+uint32_t TKstreamInt32(TKstream *stream);
+double TKstreamRanDev(TKstream *stream);
+double TKstreamGaussDev(TKstream *stream);
+void TKstreamRanDevFill(TKstream *stream,double *out,size_t n);
+void TKgaussDevFill(TKstream *stream,double *out,size_t n);
+
+#endif
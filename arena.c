@@ -0,0 +1,107 @@
+// Arena allocator for scratch memory (see arena.h)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+void arenaInit(arena *a,size_t blockSize)
+{
+  a->head = NULL;
+  a->spare = NULL;
+  a->blockSize = (blockSize > 0) ? blockSize : ARENA_BLOCK_SIZE;
+}
+
+// Returns a block with room for size bytes, reusing a spare one if possible
+static arenaBlock *newBlock(arena *a,size_t size)
+{
+  arenaBlock *b,**prev;
+
+  for (prev=&(a->spare);*prev!=NULL;prev=&((*prev)->next))
+    {
+      if ((*prev)->size >= size)
+	{
+	  b = *prev;
+	  *prev = b->next;
+	  b->used = 0;
+	  return b;
+	}
+    }
+  if (size < a->blockSize) size = a->blockSize;
+  if (!(b = (arenaBlock *)malloc(sizeof(arenaBlock))) ||
+      posix_memalign((void **)&(b->data),ARENA_ALIGN,size)!=0)
+    {
+      printf("Unable to allocate %zu bytes of scratch memory\n",size);
+      exit(1);
+    }
+  b->size = size;
+  b->used = 0;
+  return b;
+}
+
+void *arenaAlloc(arena *a,size_t size)
+{
+  arenaBlock *b;
+  void *ptr;
+
+  size = (size + ARENA_ALIGN-1) & ~((size_t)ARENA_ALIGN-1);
+  if (a->head == NULL || a->head->used + size > a->head->size)
+    {
+      b = newBlock(a,size);
+      b->next = a->head;
+      a->head = b;
+    }
+  ptr = a->head->data + a->head->used;
+  a->head->used += size;
+  return ptr;
+}
+
+void *arenaCalloc(arena *a,size_t n,size_t size)
+{
+  void *ptr = arenaAlloc(a,n*size);
+  memset(ptr,0,n*size);
+  return ptr;
+}
+
+arenaMark arenaGetMark(arena *a)
+{
+  arenaMark mark;
+
+  mark.block = a->head;
+  mark.used = (a->head == NULL) ? 0 : a->head->used;
+  return mark;
+}
+
+// Gives back everything allocated since mark was taken
+void arenaRelease(arena *a,arenaMark mark)
+{
+  arenaBlock *b;
+
+  while (a->head != mark.block)
+    {
+      b = a->head;
+      a->head = b->next;
+      b->next = a->spare;
+      a->spare = b;
+    }
+  if (a->head != NULL)
+    a->head->used = mark.used;
+}
+
+void arenaFree(arena *a)
+{
+  arenaBlock *b,*next;
+  int i;
+
+  for (i=0;i<2;i++)
+    {
+      for (b=(i==0 ? a->head : a->spare);b!=NULL;b=next)
+	{
+	  next = b->next;
+	  free(b->data);
+	  free(b);
+	}
+    }
+  a->head = NULL;
+  a->spare = NULL;
+}
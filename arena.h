@@ -0,0 +1,41 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+// Simple arena (bump) allocator for scratch memory.
+//
+// Memory is taken from large blocks and is given back all at once by
+// returning to an earlier mark, so routines that need temporary arrays
+// neither use the stack nor call malloc/free for each array. Blocks that are
+// released are kept and reused. An arena must only be used by one thread.
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE (1<<20) // Default block size (bytes)
+#define ARENA_ALIGN 64           // Alignment of every allocation
+
+typedef struct arenaBlock {
+  struct arenaBlock *next;
+  size_t size;
+  size_t used;
+  char *data;
+} arenaBlock;
+
+typedef struct arena {
+  arenaBlock *head;  // Block currently being used (earlier blocks follow)
+  arenaBlock *spare; // Released blocks available for reuse
+  size_t blockSize;
+} arena;
+
+typedef struct arenaMark {
+  arenaBlock *block;
+  size_t used;
+} arenaMark;
+
+void arenaInit(arena *a,size_t blockSize);
+void *arenaAlloc(arena *a,size_t size);
+void *arenaCalloc(arena *a,size_t n,size_t size);
+arenaMark arenaGetMark(arena *a);
+void arenaRelease(arena *a,arenaMark mark);
+void arenaFree(arena *a);
+
+#endif
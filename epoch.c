@@ -0,0 +1,21 @@
+// Split epochs (see epoch.h)
+
+#include <stdio.h>
+#include <string.h>
+#include "epoch.h"
+
+// Writes e as an MJD with ndp decimal places (the same digits as printing
+// the long double MJD with %.<ndp>Lf)
+void epochFormat(char *buf,size_t n,toaEpoch e,int ndp)
+{
+  char frac[64];
+  int64_t day = e.day;
+
+  snprintf(frac,sizeof(frac),"%.*f",ndp,e.frac);
+  if (frac[0] == '1') // Rounded up to the next day
+    {
+      day++;
+      frac[0] = '0';
+    }
+  snprintf(buf,n,"%lld%s",(long long)day,frac+1);
+}
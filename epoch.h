@@ -0,0 +1,59 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+// Epochs (MJD) split into an integer day and the fraction of that day.
+//
+// Per-ToA arithmetic on a long double MJD runs on the x87 unit and cannot be
+// vectorised. In the split form the difference between two epochs
+// (epochSeconds) only needs double arithmetic: the difference in days is an
+// exact integer and the fractions are each exact, so the result is the
+// difference correctly rounded to a double (~0.1 ns over a year, ~0.1 us
+// over decades when expressed in seconds). The fraction of a day is stored
+// rather than the seconds into the day because the fraction of any long
+// double MJD above 1024 fits in a double exactly, so converting from and to
+// long double does not change the epoch.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+
+typedef struct toaEpoch {
+  int64_t day; // Integer MJD
+  double frac; // Fraction of the day, 0 <= frac < 1
+} toaEpoch;
+
+static inline toaEpoch epochFromMJD(long double mjd)
+{
+  toaEpoch e;
+
+  e.day = (int64_t)floorl(mjd);
+  e.frac = (double)(mjd - e.day);
+  return e;
+}
+
+static inline long double epochToLong(toaEpoch e)
+{
+  return (long double)e.day + e.frac;
+}
+
+// Nearest double to the MJD (as (double) of the long double MJD)
+static inline double epochMJD(toaEpoch e)
+{
+  return (double)e.day + e.frac;
+}
+
+// Time (s) from ref to e
+static inline double epochSeconds(toaEpoch e,toaEpoch ref)
+{
+  return (double)(e.day - ref.day)*86400.0 + (e.frac - ref.frac)*86400.0;
+}
+
+// 1 if a is earlier than b
+static inline int epochBefore(toaEpoch a,toaEpoch b)
+{
+  return a.day < b.day || (a.day == b.day && a.frac < b.frac);
+}
+
+void epochFormat(char *buf,size_t n,toaEpoch e,int ndp);
+
+#endif
@@ -0,0 +1,1012 @@
+// Compiles expressions into stack programs (see evalcomp.h)
+//
+// This replaces the AnaGram parser that used to evaluate the script
+// expressions, and keeps its grammar and its conversion of numbers, so that
+// expressions give the same values as before. As in that parser every part
+// of an expression is evaluated: the operands of && and || and both
+// branches of ?: are always computed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "evalcomp.h"
+
+enum {OP_CONST,OP_LOAD,OP_STORE,OP_STORE_ADD,OP_STORE_SUB,OP_STORE_MUL,OP_STORE_DIV,
+      OP_POP,OP_NEG,OP_NOT,OP_ADD,OP_SUB,OP_MUL,OP_DIV,OP_POW,
+      OP_LT,OP_LE,OP_GT,OP_GE,OP_EQ,OP_NE,OP_AND,OP_OR,OP_SELECT,OP_CALL,
+      OP_RAN,OP_RAN_ONCE,OP_FDIST,OP_RANDOM};
+
+enum {RAN_GAUSSIAN,RAN_LINEAR}; // Argument of ran() and ranOnce()
+
+// Functions available in expressions
+static double fnRange(double compare,double val1,double val2)
+{
+  if (val2 < val1)
+    {
+      if (val1 < compare) return 1;
+      if (val2 > compare) return 1;
+    }
+  else
+    {
+      if (val1 < compare && val2 > compare) return 1;
+    }
+  return 0;
+}
+static double fnExist(double val) {return 1.0;}
+static double fnLn(double val) {return log(val);}
+static double fnCosd(double val) {return cos(val*M_PI/180.0);}
+static double fnSind(double val) {return sin(val*M_PI/180.0);}
+static double fnTand(double val) {return tan(val*M_PI/180.0);}
+static double fnSqr(double val) {return val*val;}
+
+typedef struct evalFunction {
+  const char *name;
+  int nargs;
+  double (*f1)(double);
+  double (*f2)(double,double);
+  double (*f3)(double,double,double);
+} evalFunction;
+
+static const evalFunction functions[] = {
+  {"acos",1,acos,NULL,NULL},  {"asin",1,asin,NULL,NULL},   {"atan",1,atan,NULL,NULL},
+  {"atan2",2,NULL,atan2,NULL},{"cos",1,cos,NULL,NULL},     {"cosd",1,fnCosd,NULL,NULL},
+  {"cosh",1,cosh,NULL,NULL},  {"exist",1,fnExist,NULL,NULL},{"exp",1,exp,NULL,NULL},
+  {"fabs",1,fabs,NULL,NULL},  {"fmod",2,NULL,fmod,NULL},   {"ln",1,fnLn,NULL,NULL},
+  {"log10",1,log10,NULL,NULL},{"range",3,NULL,NULL,fnRange},{"sin",1,sin,NULL,NULL},
+  {"sind",1,fnSind,NULL,NULL},{"sinh",1,sinh,NULL,NULL},   {"sqr",1,fnSqr,NULL,NULL},
+  {"sqrt",1,sqrt,NULL,NULL},  {"tan",1,tan,NULL,NULL},     {"tand",1,fnTand,NULL,NULL},
+  {"tanh",1,tanh,NULL,NULL}
+};
+#define N_FUNCTIONS (int)(sizeof(functions)/sizeof(functions[0]))
+
+// Distributions that draw a new random value each time that they are used
+enum {DIST_UNIFORM,DIST_LOGNORMAL,DIST_POWERLAW,DIST_TRUNCGAUSS};
+static const struct {const char *name; int nargs;} distributions[] = {
+  {"uniform",2},{"lognormal",2},{"powerlaw",3},{"truncgauss",4}
+};
+#define N_DISTRIBUTIONS (int)(sizeof(distributions)/sizeof(distributions[0]))
+#define MAX_TRUNCGAUSS_TRIES 1000000
+
+// Stops if the distribution cannot be sampled with these arguments
+static void badDistribution(const char *why,int type,const double *a)
+{
+  int i;
+
+  printf("%s: %s(",why,distributions[type].name);
+  for (i=0;i<distributions[type].nargs;i++)
+    printf("%s%g",(i>0) ? "," : "",a[i]);
+  printf(")\n");
+  exit(1);
+}
+
+static double drawDistribution(int type,const double *a,const evalRandom *ran)
+{
+  double u,e1,r,val;
+  int i;
+
+  switch (type)
+    {
+    case DIST_UNIFORM: // uniform(a,b)
+      return a[0]+(a[1]-a[0])*ran->uniform(ran->state);
+    case DIST_LOGNORMAL: // lognormal(mu,sigma) = exp(N(mu,sigma))
+      return exp(a[0]+a[1]*ran->gauss(ran->state));
+    case DIST_POWERLAW: // powerlaw(alpha,xmin,xmax): p(x) ~ x^alpha
+      if (a[1] <= 0 || a[2] <= a[1])
+	badDistribution("Invalid random parameter (need 0 < xmin < xmax)",type,a);
+      u = ran->uniform(ran->state);
+      if (a[0] == -1)
+	return a[1]*pow(a[2]/a[1],u);
+      e1 = a[0]+1;
+      r = pow(a[1],e1);
+      return pow(r+u*(pow(a[2],e1)-r),1.0/e1);
+    case DIST_TRUNCGAUSS: // truncgauss(mean,sigma,lo,hi)
+      if (a[1] <= 0 || a[3] <= a[2])
+	badDistribution("Invalid random parameter (need sigma > 0 and lo < hi)",type,a);
+      for (i=0;i<MAX_TRUNCGAUSS_TRIES;i++)
+	{
+	  val = a[0]+a[1]*ran->gauss(ran->state);
+	  if (val >= a[2] && val <= a[3]) return val;
+	}
+      badDistribution("Random parameter never falls inside its limits",type,a);
+    }
+  printf("Unknown random parameter: %d\n",type);
+  exit(1);
+}
+
+//
+// Cache of the fdist() files
+//
+typedef struct evalDist {
+  char *fname;
+  int n;
+  double *val;
+  struct evalDist *next;
+} evalDist;
+
+static evalDist *distList = NULL;
+static pthread_mutex_t distLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Values listed in file fname, read on first use
+static const evalDist *loadDistribution(const char *fname)
+{
+  evalDist *d;
+  FILE *fin;
+  int nalloc=0;
+  double v;
+
+  pthread_mutex_lock(&distLock);
+  for (d=distList;d!=NULL;d=d->next)
+    {
+      if (strcmp(d->fname,fname)==0)
+	break;
+    }
+  if (d == NULL)
+    {
+      if (!(fin = fopen(fname,"r")))
+	{
+	  printf("Unable to open file: %s in fdist\n",fname);
+	  exit(1);
+	}
+      if (!(d = (evalDist *)calloc(1,sizeof(evalDist))) || !(d->fname = strdup(fname)))
+	{
+	  printf("Unable to allocate memory for the fdist values in %s\n",fname);
+	  exit(1);
+	}
+      while (fscanf(fin,"%lf",&v)==1)
+	{
+	  if (d->n == nalloc)
+	    {
+	      nalloc = (nalloc > 0) ? 2*nalloc : 1024;
+	      if (!(d->val = (double *)realloc(d->val,sizeof(double)*nalloc)))
+		{
+		  printf("Unable to allocate memory for the fdist values in %s\n",fname);
+		  exit(1);
+		}
+	    }
+	  d->val[d->n++] = v;
+	}
+      fclose(fin);
+      printf("Read %d values for fdist from %s\n",d->n,fname);
+      d->next = distList;
+      distList = d;
+    }
+  pthread_mutex_unlock(&distLock);
+  return d;
+}
+
+//
+// Lexical analysis
+//
+enum {TOK_END,TOK_NUM,TOK_NAME,TOK_OP,TOK_TEXT};
+
+typedef struct token {
+  int type;
+  double value;
+  char text[64]; // Name or operator
+  const char *str; int len; // Argument of ran(), ranOnce() or fdist()
+} token;
+
+typedef struct compiler {
+  token *tok;
+  int nTok,pos;
+  evalProgram *prog;
+  int nAlloc;
+  int depth,maxDepth;
+  const char *error;
+} compiler;
+
+static const char *operators[] = {"**","+=","-=","*=","/=","==","!=","<=",">=","&&","||",
+				  "=","+","-","*","/","<",">","!","?",":","(",")",",",";"};
+#define N_OPERATORS (int)(sizeof(operators)/sizeof(operators[0]))
+
+static int isLetter(char c) {return (c>='a' && c<='z') || (c>='A' && c<='Z') || c=='_';}
+static int isDigit(char c) {return c>='0' && c<='9';}
+
+// Converts a number in the same way as the old AnaGram grammar did
+static const char *lexNumber(const char *s,double *value)
+{
+  double x=0,f=0;
+  const char *frac,*end;
+  int e=0,neg=0;
+
+  if (isDigit(*s))
+    {
+      x = *s-'0';
+      for (s++;isDigit(*s);s++)
+	x = 10*x + *s-'0';
+    }
+  if (*s=='.')
+    {
+      frac = ++s;
+      while (isDigit(*s)) s++;
+      end = s;
+      if (end > frac)
+	{
+	  f = (end[-1]-'0')/10.;
+	  for (end-=2;end>=frac;end--)
+	    f = (*end-'0' + f)/10.;
+	}
+      x += f;
+    }
+  if ((*s=='e' || *s=='E') && (isDigit(s[1]) || ((s[1]=='+' || s[1]=='-') && isDigit(s[2]))))
+    {
+      s++;
+      if (*s=='+') s++;
+      else if (*s=='-') {neg=1; s++;}
+      for (;isDigit(*s);s++)
+	e = 10*e + *s-'0';
+      x = neg ? x*pow(10,-e) : x*pow(10,e);
+    }
+  *value = x;
+  return s;
+}
+
+static int tokenise(compiler *c,const char *s)
+{
+  int nAlloc=16,i,n;
+  token *t;
+
+  c->nTok = 0;
+  if (!(c->tok = (token *)malloc(sizeof(token)*nAlloc)))
+    {
+      printf("Unable to allocate memory for compiling an expression\n");
+      exit(1);
+    }
+  for (;;)
+    {
+      // White space and comments
+      while (*s==' ' || *s=='\t' || *s=='\f' || *s=='\v' || *s=='\r' || *s=='\n')
+	s++;
+      if (s[0]=='/' && s[1]=='*')
+	{
+	  const char *end = strstr(s+2,"*/");
+	  if (end==NULL) {c->error = "Unterminated comment"; return 1;}
+	  s = end+2;
+	  continue;
+	}
+      if (s[0]=='/' && s[1]=='/')
+	{
+	  while (*s && *s!='\n') s++;
+	  if (*s==0) {c->error = "Unterminated comment"; return 1;}
+	  continue;
+	}
+
+      if (c->nTok == nAlloc)
+	{
+	  nAlloc*=2;
+	  if (!(c->tok = (token *)realloc(c->tok,sizeof(token)*nAlloc)))
+	    {
+	      printf("Unable to allocate memory for compiling an expression\n");
+	      exit(1);
+	    }
+	}
+      t = &(c->tok[c->nTok++]);
+      if (*s==0)
+	{
+	  t->type = TOK_END;
+	  return 0;
+	}
+      else if (isDigit(*s) || (*s=='.' && isDigit(s[1])))
+	{
+	  t->type = TOK_NUM;
+	  s = lexNumber(s,&(t->value));
+	  if (isLetter(*s) || isDigit(*s) || *s=='.')
+	    {c->error = "Syntax Error"; return 1;}
+	}
+      else if (isLetter(*s))
+	{
+	  t->type = TOK_NAME;
+	  for (n=0;isLetter(*s) || isDigit(*s);s++)
+	    {
+	      if (n == (int)sizeof(t->text)-1) {c->error = "Name too long"; return 1;}
+	      t->text[n++] = *s;
+	    }
+	  t->text[n] = 0;
+	  // The argument of ran(), ranOnce() and fdist() is kept as it is
+	  // (it may be a file name)
+	  if (strcmp(t->text,"ran")==0 || strcmp(t->text,"ranOnce")==0 || strcmp(t->text,"fdist")==0)
+	    {
+	      while (*s==' ' || *s=='\t') s++;
+	      if (*s=='(')
+		{
+		  const char *start,*end;
+
+		  for (start=s+1;*start==' ' || *start=='\t';start++);
+		  for (end=start;*end && *end!=')' && *end!=';';end++);
+		  if (*end!=')') {c->error = "Syntax Error"; return 1;}
+		  s = end;
+		  while (end>start && (end[-1]==' ' || end[-1]=='\t')) end--;
+		  t->str = start;
+		  t->len = end-start;
+		  t->type = TOK_TEXT;
+		}
+	    }
+	}
+      else
+	{
+	  for (i=0;i<N_OPERATORS;i++)
+	    {
+	      if (strncmp(s,operators[i],strlen(operators[i]))==0)
+		break;
+	    }
+	  if (i==N_OPERATORS) {c->error = "Syntax Error"; return 1;}
+	  t->type = TOK_OP;
+	  strcpy(t->text,operators[i]);
+	  s += strlen(operators[i]);
+	}
+    }
+}
+
+//
+// Code generation
+//
+static void emit(compiler *c,int op,int arg,double value)
+{
+  evalProgram *prog = c->prog;
+
+  if (prog->nCode == c->nAlloc)
+    {
+      c->nAlloc = (c->nAlloc > 0) ? 2*c->nAlloc : 16;
+      if (!(prog->code = (evalInstr *)realloc(prog->code,sizeof(evalInstr)*c->nAlloc)))
+	{
+	  printf("Unable to allocate memory for compiling an expression\n");
+	  exit(1);
+	}
+    }
+  prog->code[prog->nCode].op = op;
+  prog->code[prog->nCode].arg = arg;
+  prog->code[prog->nCode].value = value;
+  prog->nCode++;
+
+  // Keep track of the stack depth
+  if (op==OP_CONST || op==OP_LOAD || op==OP_RAN || op==OP_RAN_ONCE || op==OP_FDIST) c->depth++;
+  else if (op==OP_SELECT) c->depth-=2;
+  else if (op==OP_CALL || op==OP_RANDOM) c->depth -= arg-1;
+  else if (op>=OP_POP && op!=OP_NEG && op!=OP_NOT) c->depth--;
+  if (c->depth > c->maxDepth) c->maxDepth = c->depth;
+  if (c->depth > EVAL_STACK_SIZE && c->error==NULL) c->error = "Expression too complex";
+}
+
+static int variableSlot(compiler *c,const char *name)
+{
+  evalProgram *prog = c->prog;
+  int slot = evalSlot(prog,name);
+
+  if (slot >= 0) return slot;
+  if (!(prog->varName = (char **)realloc(prog->varName,sizeof(char *)*(prog->nVars+1))) ||
+      !(prog->varName[prog->nVars] = strdup(name)))
+    {
+      printf("Unable to allocate memory for compiling an expression\n");
+      exit(1);
+    }
+  return prog->nVars++;
+}
+
+static token *peek(compiler *c,int ahead)
+{
+  int p = c->pos+ahead;
+  return &(c->tok[p < c->nTok ? p : c->nTok-1]);
+}
+
+static int isOp(compiler *c,const char *op)
+{
+  token *t = peek(c,0);
+  return t->type==TOK_OP && strcmp(t->text,op)==0;
+}
+
+static int accept(compiler *c,const char *op)
+{
+  if (!isOp(c,op)) return 0;
+  c->pos++;
+  return 1;
+}
+
+static void expect(compiler *c,const char *op)
+{
+  if (!accept(c,op) && c->error==NULL) c->error = "Syntax Error";
+}
+
+static void parseExpression(compiler *c);
+static void parseConditional(compiler *c);
+static void parseUnary(compiler *c);
+
+// ran(gaussian), ran(linear), ranOnce(...) or fdist(file)
+static void parseRandom(compiler *c,token *t)
+{
+  char arg[1024];
+  const evalDist *d;
+  int type;
+
+  if (t->len >= (int)sizeof(arg)) {if (c->error==NULL) c->error = "Name too long"; return;}
+  strncpy(arg,t->str,t->len);
+  arg[t->len] = 0;
+  if (strcmp(t->text,"fdist")==0)
+    {
+      d = loadDistribution(arg);
+      if (d->n == 0) {if (c->error==NULL) c->error = "Empty fdist file"; return;}
+      emit(c,OP_FDIST,d->n,0);
+      c->prog->code[c->prog->nCode-1].data = d->val;
+      c->prog->random = 1;
+      return;
+    }
+  if (strcmp(arg,"gaussian")==0) type = RAN_GAUSSIAN;
+  else if (strcmp(arg,"linear")==0) type = RAN_LINEAR;
+  else
+    {
+      printf("Unknown random parameter: %s\n",arg);
+      exit(1);
+    }
+  if (strcmp(t->text,"ran")==0)
+    {
+      emit(c,OP_RAN,type,0);
+      c->prog->random = 1;
+    }
+  else
+    emit(c,OP_RAN_ONCE,type,(double)(c->prog->nOnce++));
+}
+
+static void parsePrimary(compiler *c)
+{
+  token *t = peek(c,0);
+  int i,nargs=0,slot;
+
+  if (c->error) return;
+  if (t->type==TOK_NUM)
+    {
+      c->pos++;
+      emit(c,OP_CONST,0,t->value);
+    }
+  else if (t->type==TOK_TEXT)
+    {
+      c->pos++;
+      expect(c,")");
+      parseRandom(c,t);
+    }
+  else if (t->type==TOK_NAME)
+    {
+      c->pos++;
+      if (accept(c,"("))
+	{
+	  if (!isOp(c,")"))
+	    {
+	      do {
+		parseExpression(c);
+		nargs++;
+	      } while (accept(c,",") && c->error==NULL);
+	    }
+	  expect(c,")");
+	  for (i=0;i<N_DISTRIBUTIONS;i++)
+	    {
+	      if (strcmp(t->text,distributions[i].name)==0)
+		{
+		  if (nargs != distributions[i].nargs)
+		    {if (c->error==NULL) c->error = "Wrong Number of Arguments"; return;}
+		  emit(c,OP_RANDOM,nargs,(double)i);
+		  c->prog->random = 1;
+		  return;
+		}
+	    }
+	  for (i=0;i<N_FUNCTIONS;i++)
+	    {
+	      if (strcmp(t->text,functions[i].name)==0)
+		break;
+	    }
+	  if (i==N_FUNCTIONS)
+	    {if (c->error==NULL) c->error = "Unknown Function"; return;}
+	  if (nargs != functions[i].nargs)
+	    {if (c->error==NULL) c->error = "Wrong Number of Arguments"; return;}
+	  emit(c,OP_CALL,nargs,(double)i);
+	}
+      else
+	{
+	  slot = variableSlot(c,t->text);
+	  emit(c,OP_LOAD,slot,0);
+	}
+    }
+  else if (accept(c,"("))
+    {
+      parseExpression(c);
+      expect(c,")");
+    }
+  else if (accept(c,"!"))
+    {
+      parsePrimary(c);
+      emit(c,OP_NOT,0,0);
+    }
+  else if (c->error==NULL)
+    c->error = "Syntax Error";
+}
+
+static void parseFactor(compiler *c)
+{
+  parsePrimary(c);
+  if (accept(c,"**"))
+    {
+      parseUnary(c);
+      emit(c,OP_POW,0,0);
+    }
+}
+
+static void parseUnary(compiler *c)
+{
+  if (accept(c,"-"))
+    {
+      parseUnary(c);
+      emit(c,OP_NEG,0,0);
+    }
+  else if (accept(c,"+"))
+    parseUnary(c);
+  else
+    parseFactor(c);
+}
+
+// Left associative binary operators, from the loosest binding level
+static const char *binaryOps[][5] = {{"||"},{"&&"},{"==","!="},{"<","<=",">",">="},{"+","-"},{"*","/"}};
+static const int binaryCodes[][4] = {{OP_OR},{OP_AND},{OP_EQ,OP_NE},{OP_LT,OP_LE,OP_GT,OP_GE},{OP_ADD,OP_SUB},{OP_MUL,OP_DIV}};
+#define N_LEVELS 6
+
+static void parseBinary(compiler *c,int level)
+{
+  int i,found;
+
+  if (level==N_LEVELS) {parseUnary(c); return;}
+  parseBinary(c,level+1);
+  do {
+    found = 0;
+    for (i=0;i<4 && binaryOps[level][i]!=NULL;i++)
+      {
+	if (accept(c,binaryOps[level][i]))
+	  {
+	    parseBinary(c,level+1);
+	    emit(c,binaryCodes[level][i],0,0);
+	    found = 1;
+	    break;
+	  }
+      }
+  } while (found && c->error==NULL);
+}
+
+static void parseConditional(compiler *c)
+{
+  parseBinary(c,0);
+  if (accept(c,"?"))
+    {
+      parseExpression(c);
+      expect(c,":");
+      parseConditional(c);
+      emit(c,OP_SELECT,0,0);
+    }
+}
+
+static void parseExpression(compiler *c)
+{
+  static const char *assign[] = {"=","+=","-=","*=","/="};
+  static const int codes[] = {OP_STORE,OP_STORE_ADD,OP_STORE_SUB,OP_STORE_MUL,OP_STORE_DIV};
+  token *t = peek(c,0),*next = peek(c,1);
+  int i,slot;
+
+  if (c->error) return;
+  if (t->type==TOK_NAME && next->type==TOK_OP)
+    {
+      for (i=0;i<5;i++)
+	{
+	  if (strcmp(next->text,assign[i])==0)
+	    {
+	      c->pos+=2;
+	      slot = variableSlot(c,t->text);
+	      parseExpression(c);
+	      emit(c,codes[i],slot,0);
+	      return;
+	    }
+	}
+    }
+  parseConditional(c);
+}
+
+evalProgram *evalCompile(const char *expression,const char **error)
+{
+  compiler c;
+  evalProgram *prog;
+
+  if (!(prog = (evalProgram *)calloc(1,sizeof(evalProgram))))
+    {
+      printf("Unable to allocate memory for compiling an expression\n");
+      exit(1);
+    }
+  memset(&c,0,sizeof(compiler));
+  c.prog = prog;
+  if (tokenise(&c,expression)==0)
+    {
+      // Expressions separated by commas or semicolons
+      for (;;)
+	{
+	  if (!isOp(&c,",") && !isOp(&c,";") && peek(&c,0)->type!=TOK_END)
+	    {
+	      parseExpression(&c);
+	      emit(&c,OP_POP,0,0);
+	    }
+	  if (c.error || (!accept(&c,",") && !accept(&c,";")))
+	    break;
+	}
+      if (c.error==NULL && peek(&c,0)->type!=TOK_END)
+	c.error = "Syntax Error";
+    }
+  free(c.tok);
+  if (c.error)
+    {
+      if (error) *error = c.error;
+      evalFree(prog);
+      return NULL;
+    }
+  prog->maxDepth = c.maxDepth;
+  return prog;
+}
+
+void evalFree(evalProgram *prog)
+{
+  int i;
+
+  if (prog==NULL) return;
+  for (i=0;i<prog->nVars;i++)
+    free(prog->varName[i]);
+  free(prog->varName);
+  free(prog->code);
+  free(prog);
+}
+
+int evalSlot(const evalProgram *prog,const char *name)
+{
+  int i;
+
+  for (i=0;i<prog->nVars;i++)
+    {
+      if (strcmp(prog->varName[i],name)==0)
+	return i;
+    }
+  return -1;
+}
+
+static double drawRan(int type,const evalRandom *ran)
+{
+  return (type==RAN_GAUSSIAN) ? ran->gauss(ran->state) : ran->uniform(ran->state);
+}
+
+// Draws the ranOnce() values, in the order in which they appear
+static int drawOnce(const evalProgram *prog,const evalRandom *ran,double *once)
+{
+  int i;
+
+  if (prog->nOnce == 0) return 0;
+  if (ran == NULL) return 1;
+  for (i=0;i<prog->nCode;i++)
+    {
+      if (prog->code[i].op == OP_RAN_ONCE)
+	once[(int)prog->code[i].value] = drawRan(prog->code[i].arg,ran);
+    }
+  return 0;
+}
+
+static int runCode(const evalProgram *prog,double *vars,const evalRandom *ran,const double *once)
+{
+  double stack[EVAL_STACK_SIZE];
+  double x,y;
+  const evalInstr *in;
+  const evalFunction *f;
+  int sp=0,i;
+
+  for (i=0;i<prog->nCode;i++)
+    {
+      in = &(prog->code[i]);
+      switch (in->op)
+	{
+	case OP_CONST: stack[sp++] = in->value; break;
+	case OP_LOAD: stack[sp++] = vars[in->arg]; break;
+	case OP_STORE: vars[in->arg] = stack[sp-1]; break;
+	case OP_STORE_ADD: stack[sp-1] = (vars[in->arg] += stack[sp-1]); break;
+	case OP_STORE_SUB: stack[sp-1] = (vars[in->arg] -= stack[sp-1]); break;
+	case OP_STORE_MUL: stack[sp-1] = (vars[in->arg] *= stack[sp-1]); break;
+	case OP_STORE_DIV: stack[sp-1] = (vars[in->arg] /= stack[sp-1]); break;
+	case OP_POP: sp--; break;
+	case OP_NEG: stack[sp-1] = -stack[sp-1]; break;
+	case OP_NOT: stack[sp-1] = !stack[sp-1]; break;
+	case OP_SELECT:
+	  sp-=2;
+	  stack[sp-1] = stack[sp-1] ? stack[sp] : stack[sp+1];
+	  break;
+	case OP_CALL:
+	  f = &(functions[(int)in->value]);
+	  sp -= in->arg;
+	  if (in->arg==1) x = f->f1(stack[sp]);
+	  else if (in->arg==2) x = f->f2(stack[sp],stack[sp+1]);
+	  else x = f->f3(stack[sp],stack[sp+1],stack[sp+2]);
+	  stack[sp++] = x;
+	  break;
+	case OP_RAN:
+	  if (ran == NULL) return 1;
+	  stack[sp++] = drawRan(in->arg,ran);
+	  break;
+	case OP_RAN_ONCE: stack[sp++] = once[(int)in->value]; break;
+	case OP_FDIST:
+	  if (ran == NULL) return 1;
+	  stack[sp++] = in->data[(int)(ran->uniform(ran->state)*in->arg)];
+	  break;
+	case OP_RANDOM:
+	  if (ran == NULL) return 1;
+	  sp -= in->arg;
+	  x = drawDistribution((int)in->value,stack+sp,ran);
+	  stack[sp++] = x;
+	  break;
+	default: // Binary operators
+	  y = stack[--sp];
+	  x = stack[sp-1];
+	  switch (in->op)
+	    {
+	    case OP_ADD: x = x+y; break;
+	    case OP_SUB: x = x-y; break;
+	    case OP_MUL: x = x*y; break;
+	    case OP_DIV:
+	      if (y==0) return 1; // Divide by zero
+	      x = x/y;
+	      break;
+	    case OP_POW: x = pow(x,y); break;
+	    case OP_LT: x = x<y; break;
+	    case OP_LE: x = x<=y; break;
+	    case OP_GT: x = x>y; break;
+	    case OP_GE: x = x>=y; break;
+	    case OP_EQ: x = x==y; break;
+	    case OP_NE: x = x!=y; break;
+	    case OP_AND: x = x&&y; break;
+	    case OP_OR: x = x||y; break;
+	    }
+	  stack[sp-1] = x;
+	  break;
+	}
+    }
+  return 0;
+}
+
+int evalRun(const evalProgram *prog,double *vars,const evalRandom *ran)
+{
+  double once[prog->nOnce+1];
+
+  if (drawOnce(prog,ran,once)) return 1;
+  return runCode(prog,vars,ran,once);
+}
+
+// Each instruction is applied to a block of EVAL_BLOCK points at a time, so
+// that the arithmetic loops can be vectorised by the compiler and the
+// interpreter overhead is shared between the points
+#define BLOCK_LOOP(expr) for (k=0;k<nb;k++) {expr;}
+
+// Runs a program that draws random values one point at a time
+static int runArrayPoints(const evalProgram *prog,const double *vars,int xSlot,const double *x,
+			  int outSlot,double *out,int n,const evalRandom *ran,const double *once)
+{
+  double v[prog->nVars+1];
+  int i,anyFail=0;
+
+  for (i=0;i<n;i++)
+    {
+      memcpy(v,vars,sizeof(double)*prog->nVars);
+      if (xSlot >= 0) v[xSlot] = x[i];
+      if (runCode(prog,v,ran,once)!=0)
+	{
+	  out[i] = 0;
+	  anyFail = 1;
+	}
+      else
+	out[i] = (outSlot >= 0) ? v[outSlot] : 0;
+    }
+  return anyFail;
+}
+
+int evalRunArray(const evalProgram *prog,const double *vars,int xSlot,const double *x,
+		 int outSlot,double *out,int n,const evalRandom *ran)
+{
+  int nv = prog->nVars;
+  double *mem,*stack,*var,*a,*b,*v;
+  char fail[EVAL_BLOCK];
+  const evalInstr *in;
+  const evalFunction *f;
+  double once[prog->nOnce+1];
+  int i,j,k,nb,sp,anyFail=0;
+
+  if (drawOnce(prog,ran,once))
+    {
+      memset(out,0,sizeof(double)*n);
+      return 1;
+    }
+  if (prog->random)
+    return runArrayPoints(prog,vars,xSlot,x,outSlot,out,n,ran,once);
+
+  if (!(mem = (double *)malloc(sizeof(double)*EVAL_BLOCK*(prog->maxDepth+nv+1))))
+    {
+      printf("Unable to allocate memory for evaluating an expression\n");
+      exit(1);
+    }
+  var = mem;
+  stack = mem+EVAL_BLOCK*nv;
+#define S(p) (stack+EVAL_BLOCK*(p))
+#define V(s) (var+EVAL_BLOCK*(s))
+
+  for (j=0;j<n;j+=EVAL_BLOCK)
+    {
+      nb = (n-j < EVAL_BLOCK) ? n-j : EVAL_BLOCK;
+      for (i=0;i<nv;i++)
+	{
+	  v = V(i);
+	  if (i==xSlot) {BLOCK_LOOP(v[k] = x[j+k])}
+	  else {BLOCK_LOOP(v[k] = vars[i])}
+	}
+      memset(fail,0,sizeof(fail));
+      sp = 0;
+      for (i=0;i<prog->nCode;i++)
+	{
+	  in = &(prog->code[i]);
+	  a = (sp>0) ? S(sp-1) : NULL; // Top of the stack
+	  b = (sp>1) ? S(sp-2) : NULL;
+	  switch (in->op)
+	    {
+	    case OP_CONST: a = S(sp++); BLOCK_LOOP(a[k] = in->value) break;
+	    case OP_RAN_ONCE: a = S(sp++); BLOCK_LOOP(a[k] = once[(int)in->value]) break;
+	    case OP_LOAD: a = S(sp++); v = V(in->arg); BLOCK_LOOP(a[k] = v[k]) break;
+	    case OP_STORE: v = V(in->arg); BLOCK_LOOP(v[k] = a[k]) break;
+	    case OP_STORE_ADD: v = V(in->arg); BLOCK_LOOP(a[k] = (v[k] += a[k])) break;
+	    case OP_STORE_SUB: v = V(in->arg); BLOCK_LOOP(a[k] = (v[k] -= a[k])) break;
+	    case OP_STORE_MUL: v = V(in->arg); BLOCK_LOOP(a[k] = (v[k] *= a[k])) break;
+	    case OP_STORE_DIV: v = V(in->arg); BLOCK_LOOP(a[k] = (v[k] /= a[k])) break;
+	    case OP_POP: sp--; break;
+	    case OP_NEG: BLOCK_LOOP(a[k] = -a[k]) break;
+	    case OP_NOT: BLOCK_LOOP(a[k] = !a[k]) break;
+	    case OP_SELECT:
+	      v = S(sp-3);
+	      BLOCK_LOOP(v[k] = v[k] ? b[k] : a[k])
+	      sp-=2;
+	      break;
+	    case OP_CALL:
+	      f = &(functions[(int)in->value]);
+	      sp -= in->arg;
+	      v = S(sp);
+	      if (in->arg==1)
+		{
+		  // Common functions are called directly, so they can use the
+		  // vector versions of the maths library where available
+		  if (f->f1==sin) {BLOCK_LOOP(v[k] = sin(v[k]))}
+		  else if (f->f1==cos) {BLOCK_LOOP(v[k] = cos(v[k]))}
+		  else if (f->f1==exp) {BLOCK_LOOP(v[k] = exp(v[k]))}
+		  else {BLOCK_LOOP(v[k] = f->f1(v[k]))}
+		}
+	      else if (in->arg==2)
+		{
+		  a = S(sp+1);
+		  BLOCK_LOOP(v[k] = f->f2(v[k],a[k]))
+		}
+	      else
+		{
+		  a = S(sp+1);
+		  b = S(sp+2);
+		  BLOCK_LOOP(v[k] = f->f3(v[k],a[k],b[k]))
+		}
+	      sp++;
+	      break;
+	    default: // Binary operators, giving b = b op a
+	      switch (in->op)
+		{
+		case OP_ADD: BLOCK_LOOP(b[k] = b[k]+a[k]) break;
+		case OP_SUB: BLOCK_LOOP(b[k] = b[k]-a[k]) break;
+		case OP_MUL: BLOCK_LOOP(b[k] = b[k]*a[k]) break;
+		case OP_DIV:
+		  BLOCK_LOOP(fail[k] |= (a[k]==0))
+		  BLOCK_LOOP(b[k] = b[k]/a[k])
+		  break;
+		case OP_POW: BLOCK_LOOP(b[k] = pow(b[k],a[k])) break;
+		case OP_LT: BLOCK_LOOP(b[k] = b[k]<a[k]) break;
+		case OP_LE: BLOCK_LOOP(b[k] = b[k]<=a[k]) break;
+		case OP_GT: BLOCK_LOOP(b[k] = b[k]>a[k]) break;
+		case OP_GE: BLOCK_LOOP(b[k] = b[k]>=a[k]) break;
+		case OP_EQ: BLOCK_LOOP(b[k] = b[k]==a[k]) break;
+		case OP_NE: BLOCK_LOOP(b[k] = b[k]!=a[k]) break;
+		case OP_AND: BLOCK_LOOP(b[k] = b[k]&&a[k]) break;
+		case OP_OR: BLOCK_LOOP(b[k] = b[k]||a[k]) break;
+		}
+	      sp--;
+	      break;
+	    }
+	}
+      for (k=0;k<nb;k++)
+	{
+	  if (fail[k]) {out[j+k] = 0; anyFail=1;}
+	  else out[j+k] = (outSlot >= 0) ? var[EVAL_BLOCK*outSlot+k] : 0;
+	}
+    }
+#undef S
+#undef V
+  free(mem);
+  return anyFail;
+}
+
+//
+// Cache of compiled programs
+//
+#define EVAL_CACHE_SIZE 1024 // Number of hash buckets
+
+typedef struct evalCacheEntry {
+  char *expression;
+  evalProgram *prog; // NULL if the expression could not be compiled
+  struct evalCacheEntry *next;
+} evalCacheEntry;
+
+static evalCacheEntry *cache[EVAL_CACHE_SIZE];
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned hashString(const char *s)
+{
+  unsigned h = 2166136261u;
+
+  for (;*s;s++)
+    h = (h ^ (unsigned char)*s)*16777619u;
+  return h;
+}
+
+evalProgram *evalCached(const char *expression)
+{
+  unsigned h = hashString(expression)%EVAL_CACHE_SIZE;
+  evalCacheEntry *e;
+  evalProgram *prog;
+
+  pthread_mutex_lock(&cacheLock);
+  for (e=cache[h];e!=NULL;e=e->next)
+    {
+      if (strcmp(e->expression,expression)==0)
+	break;
+    }
+  if (e == NULL)
+    {
+      if (!(e = (evalCacheEntry *)malloc(sizeof(evalCacheEntry))) ||
+	  !(e->expression = strdup(expression)))
+	{
+	  printf("Unable to allocate memory for the expression cache\n");
+	  exit(1);
+	}
+      e->prog = evalCompile(expression,NULL);
+      e->next = cache[h];
+      cache[h] = e;
+    }
+  prog = e->prog;
+  pthread_mutex_unlock(&cacheLock);
+  return prog;
+}
+
+void evalCacheCleanup(void)
+{
+  evalCacheEntry *e,*next;
+  evalDist *d,*dnext;
+  int i;
+
+  pthread_mutex_lock(&cacheLock);
+  for (i=0;i<EVAL_CACHE_SIZE;i++)
+    {
+      for (e=cache[i];e!=NULL;e=next)
+	{
+	  next = e->next;
+	  evalFree(e->prog);
+	  free(e->expression);
+	  free(e);
+	}
+      cache[i] = NULL;
+    }
+  pthread_mutex_unlock(&cacheLock);
+
+  pthread_mutex_lock(&distLock);
+  for (d=distList;d!=NULL;d=dnext)
+    {
+      dnext = d->next;
+      free(d->fname);
+      free(d->val);
+      free(d);
+    }
+  distList = NULL;
+  pthread_mutex_unlock(&distLock);
+}
@@ -0,0 +1,87 @@
+#ifndef EVALCOMP_H
+#define EVALCOMP_H
+
+// Compiled expressions.
+//
+// The syntax is that of C expressions with the FORTRAN exponentiation
+// operator (**) added. All arithmetic is double precision:
+//   Assignment operators:        =, +=, -=, *=, /=
+//   Conditional expressions:     ? :
+//   Logical operators:           !, &&, ||
+//   Comparison operators:        ==, !=, <, <=, >, >=
+//   Binary arithmetic operators: +, -, *, /
+//   Exponentiation:              **
+//   Unary arithmetic operators:  +, -
+//   Parentheses and function calls (see functions[] in evalcomp.c)
+//   Random values:               ran(gaussian), ran(linear), ranOnce(...),
+//                                fdist(file), uniform(a,b), lognormal(mu,sigma),
+//                                powerlaw(alpha,xmin,xmax),
+//                                truncgauss(mean,sigma,lo,hi)
+// A string may hold several expressions separated by commas or semicolons,
+// and may contain C and C++ style comments.
+//
+// An expression string is compiled once into a short stack program.
+// Variables are held in slots, so a program can then be evaluated many
+// times, by several threads at once, with each caller supplying its own
+// variable values.
+//
+// ran() and the distributions give a new value each time that they are
+// evaluated. ranOnce() gives one value for each call of evalRun or
+// evalRunArray, shared by all of the points. fdist(file) picks one of the
+// values listed in file at random; each file is read once and then kept in
+// a shared, read-only cache.
+
+#define EVAL_STACK_SIZE 256 // Deepest evaluation stack allowed in a program
+#define EVAL_BLOCK 64       // Number of points evaluated together by evalRunArray
+
+typedef struct evalInstr {
+  int op;
+  int arg;      // Variable slot, function number or argument count
+  double value; // Constant
+  const double *data; // Values of an fdist() distribution (arg values)
+} evalInstr;
+
+// Source of the random values: uniform gives values in [0,1) and gauss
+// values from a normal distribution with unit variance
+typedef struct evalRandom {
+  double (*uniform)(void *state);
+  double (*gauss)(void *state);
+  void *state;
+} evalRandom;
+
+typedef struct evalProgram {
+  int nCode;
+  evalInstr *code;
+  int nVars;
+  char **varName; // Variable names, in the order that they first appear
+  int maxDepth;   // Deepest stack used by the program
+  int random;     // Non-zero if new random values are drawn for each point
+  int nOnce;      // Number of ranOnce() values
+} evalProgram;
+
+// Returns NULL (and sets *error if error is not NULL) if the expression
+// cannot be parsed
+evalProgram *evalCompile(const char *expression,const char **error);
+void evalFree(evalProgram *prog);
+// Slot of variable name in the program, or -1 if it is not used
+int evalSlot(const evalProgram *prog,const char *name);
+// Runs the program using (and updating) vars[0..nVars). Non-zero on error.
+// ran is only needed if the program uses random values
+int evalRun(const evalProgram *prog,double *vars,const evalRandom *ran);
+// Runs the program for n points: variable xSlot takes the values x[0..n)
+// (the other variables start from vars[]) and out[0..n) receives the final
+// values of variable outSlot. Points that fail (divide by zero) are set to
+// 0 and give a non-zero return value. Programs that draw random values for
+// each point are run one point at a time, so that the values are drawn in
+// the same order as by evalRun
+int evalRunArray(const evalProgram *prog,const double *vars,int xSlot,const double *x,
+		 int outSlot,double *out,int n,const evalRandom *ran);
+
+// Process-wide cache of compiled programs, keyed by the expression string.
+// The programs are shared and must not be freed by the caller. NULL if the
+// expression cannot be parsed
+evalProgram *evalCached(const char *expression);
+// Frees the cached programs and fdist() distributions
+void evalCacheCleanup(void);
+
+#endif
@@ -0,0 +1,260 @@
+// Process-wide cache of FFTW plans (see fftCache.h)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "fftCache.h"
+
+enum {DFT_F_FWD,DFT_F_BWD,R2C_F,C2R_F,DFT_D_FWD,DFT_D_BWD,R2C_D,C2R_D};
+
+typedef struct fftCacheEntry {
+  int kind;
+  int n;
+  int howmany;   // Number of transforms stored one after another
+  int unaligned; // Arrays not aligned as by fftw_malloc
+  int inplace;
+  void *plan;    // fftw_plan or fftwf_plan, depending on kind
+  struct fftCacheEntry *next;
+} fftCacheEntry;
+
+static fftCacheEntry *cache = NULL;
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned planFlags = FFTW_ESTIMATE;
+static int planThreads = 1;
+static int useWisdom = 0;
+static char wisdomFile[1024],wisdomFile_f[1024];
+
+// flags is FFTW_ESTIMATE, FFTW_MEASURE or FFTW_PATIENT. Wisdom is read from
+// (and later saved to) wisdomDir unless plans are only being estimated
+void fftCacheSetup(unsigned flags,int nthreads,const char *wisdomDir)
+{
+  pthread_mutex_lock(&cacheLock);
+  planFlags = flags;
+  planThreads = nthreads;
+  if (planThreads > 1)
+    {
+      fftw_init_threads();
+      fftwf_init_threads();
+    }
+  useWisdom = 0;
+  if (wisdomDir != NULL && !(flags & FFTW_ESTIMATE))
+    {
+      sprintf(wisdomFile,"%s/fftw.wisdom",wisdomDir);
+      sprintf(wisdomFile_f,"%s/fftwf.wisdom",wisdomDir);
+      if (fftw_import_wisdom_from_filename(wisdomFile))
+	printf("Read FFTW wisdom from %s\n",wisdomFile);
+      if (fftwf_import_wisdom_from_filename(wisdomFile_f))
+	printf("Read FFTW wisdom from %s\n",wisdomFile_f);
+      useWisdom = 1;
+    }
+  pthread_mutex_unlock(&cacheLock);
+}
+
+void fftCacheSaveWisdom(void)
+{
+  pthread_mutex_lock(&cacheLock);
+  if (useWisdom)
+    {
+      if (!fftw_export_wisdom_to_filename(wisdomFile) ||
+	  !fftwf_export_wisdom_to_filename(wisdomFile_f))
+	printf("Warning: unable to save FFTW wisdom in %s\n",wisdomFile);
+    }
+  pthread_mutex_unlock(&cacheLock);
+}
+
+void fftCacheCleanup(void)
+{
+  fftCacheEntry *e,*next;
+
+  pthread_mutex_lock(&cacheLock);
+  for (e=cache;e!=NULL;e=next)
+    {
+      next = e->next;
+      if (e->kind < DFT_D_FWD)
+	fftwf_destroy_plan((fftwf_plan)e->plan);
+      else
+	fftw_destroy_plan((fftw_plan)e->plan);
+      free(e);
+    }
+  cache = NULL;
+  pthread_mutex_unlock(&cacheLock);
+}
+
+// Plans are made using scratch arrays, so FFTW_MEASURE does not overwrite
+// the caller's data. Batches of transforms are stored contiguously, with
+// the real arrays of an in-place batch padded to 2*(n/2+1) as FFTW requires
+static void *makePlan(int kind,int n,int howmany,int unaligned,int inplace)
+{
+  unsigned flags = planFlags | (unaligned ? FFTW_UNALIGNED : 0);
+  int rdist = inplace ? 2*(n/2+1) : n;
+  int cdist = n/2+1;
+  int nthreads = (planThreads > 1 && (long)n*howmany >= FFTCACHE_THREAD_MIN);
+  size_t nin,nout;
+  void *in,*out,*plan=NULL;
+
+  // Number of bytes in the input and output arrays
+  switch (kind)
+    {
+    case DFT_F_FWD: case DFT_F_BWD: nin = nout = n*sizeof(fftwf_complex); break;
+    case R2C_F: nin = n*sizeof(float); nout = (n/2+1)*sizeof(fftwf_complex); break;
+    case C2R_F: nin = (n/2+1)*sizeof(fftwf_complex); nout = n*sizeof(float); break;
+    case DFT_D_FWD: case DFT_D_BWD: nin = nout = n*sizeof(fftw_complex); break;
+    case R2C_D: nin = n*sizeof(double); nout = (n/2+1)*sizeof(fftw_complex); break;
+    default: nin = (n/2+1)*sizeof(fftw_complex); nout = n*sizeof(double); break;
+    }
+  if (inplace)
+    nin = nout = (nin > nout) ? nin : nout;
+  nin *= howmany;
+  nout *= howmany;
+  in = fftw_malloc(nin);
+  out = inplace ? in : fftw_malloc(nout);
+  if (in == NULL || out == NULL)
+    {
+      printf("Unable to allocate memory for planning a transform of length %d\n",n);
+      exit(1);
+    }
+
+  if (nthreads)
+    {
+      fftw_plan_with_nthreads(planThreads);
+      fftwf_plan_with_nthreads(planThreads);
+    }
+  if (howmany == 1)
+    {
+      switch (kind)
+	{
+	case DFT_F_FWD: plan = fftwf_plan_dft_1d(n,in,out,FFTW_FORWARD,flags); break;
+	case DFT_F_BWD: plan = fftwf_plan_dft_1d(n,in,out,FFTW_BACKWARD,flags); break;
+	case R2C_F: plan = fftwf_plan_dft_r2c_1d(n,in,out,flags); break;
+	case C2R_F: plan = fftwf_plan_dft_c2r_1d(n,in,out,flags); break;
+	case DFT_D_FWD: plan = fftw_plan_dft_1d(n,in,out,FFTW_FORWARD,flags); break;
+	case DFT_D_BWD: plan = fftw_plan_dft_1d(n,in,out,FFTW_BACKWARD,flags); break;
+	case R2C_D: plan = fftw_plan_dft_r2c_1d(n,in,out,flags); break;
+	case C2R_D: plan = fftw_plan_dft_c2r_1d(n,in,out,flags); break;
+	}
+    }
+  else
+    {
+      switch (kind)
+	{
+	case DFT_F_FWD: plan = fftwf_plan_many_dft(1,&n,howmany,in,NULL,1,n,out,NULL,1,n,FFTW_FORWARD,flags); break;
+	case DFT_F_BWD: plan = fftwf_plan_many_dft(1,&n,howmany,in,NULL,1,n,out,NULL,1,n,FFTW_BACKWARD,flags); break;
+	case R2C_F: plan = fftwf_plan_many_dft_r2c(1,&n,howmany,in,NULL,1,rdist,out,NULL,1,cdist,flags); break;
+	case C2R_F: plan = fftwf_plan_many_dft_c2r(1,&n,howmany,in,NULL,1,cdist,out,NULL,1,rdist,flags); break;
+	case DFT_D_FWD: plan = fftw_plan_many_dft(1,&n,howmany,in,NULL,1,n,out,NULL,1,n,FFTW_FORWARD,flags); break;
+	case DFT_D_BWD: plan = fftw_plan_many_dft(1,&n,howmany,in,NULL,1,n,out,NULL,1,n,FFTW_BACKWARD,flags); break;
+	case R2C_D: plan = fftw_plan_many_dft_r2c(1,&n,howmany,in,NULL,1,rdist,out,NULL,1,cdist,flags); break;
+	case C2R_D: plan = fftw_plan_many_dft_c2r(1,&n,howmany,in,NULL,1,cdist,out,NULL,1,rdist,flags); break;
+	}
+    }
+  if (nthreads)
+    {
+      fftw_plan_with_nthreads(1);
+      fftwf_plan_with_nthreads(1);
+    }
+  if (plan == NULL)
+    {
+      printf("Unable to create FFTW plan for %d transforms of length %d\n",howmany,n);
+      exit(1);
+    }
+  if (!inplace) fftw_free(out);
+  fftw_free(in);
+  return plan;
+}
+
+static void *getPlan(int kind,int n,int howmany,int unaligned,int inplace)
+{
+  fftCacheEntry *e;
+  void *plan;
+
+  pthread_mutex_lock(&cacheLock);
+  for (e=cache;e!=NULL;e=e->next)
+    {
+      if (e->kind==kind && e->n==n && e->howmany==howmany && e->unaligned==unaligned && e->inplace==inplace)
+	break;
+    }
+  if (e == NULL)
+    {
+      if (!(e = (fftCacheEntry *)malloc(sizeof(fftCacheEntry))))
+	{
+	  printf("Unable to allocate memory for the FFTW plan cache\n");
+	  exit(1);
+	}
+      e->kind = kind;
+      e->n = n;
+      e->howmany = howmany;
+      e->unaligned = unaligned;
+      e->inplace = inplace;
+      e->plan = makePlan(kind,n,howmany,unaligned,inplace);
+      e->next = cache;
+      cache = e;
+    }
+  plan = e->plan;
+  pthread_mutex_unlock(&cacheLock);
+  return plan;
+}
+
+void fftCacheDFT_f(int n,fftwf_complex *in,fftwf_complex *out,int sign)
+{
+  int unaligned = (fftwf_alignment_of((float *)in)!=0 || fftwf_alignment_of((float *)out)!=0);
+  fftwf_plan plan = getPlan(sign==FFTW_FORWARD ? DFT_F_FWD : DFT_F_BWD,n,1,unaligned,(void *)in==(void *)out);
+  fftwf_execute_dft(plan,in,out);
+}
+
+void fftCacheR2C_f(int n,float *in,fftwf_complex *out)
+{
+  int unaligned = (fftwf_alignment_of(in)!=0 || fftwf_alignment_of((float *)out)!=0);
+  fftwf_plan plan = getPlan(R2C_F,n,1,unaligned,(void *)in==(void *)out);
+  fftwf_execute_dft_r2c(plan,in,out);
+}
+
+void fftCacheC2R_f(int n,fftwf_complex *in,float *out)
+{
+  int unaligned = (fftwf_alignment_of((float *)in)!=0 || fftwf_alignment_of(out)!=0);
+  fftwf_plan plan = getPlan(C2R_F,n,1,unaligned,(void *)in==(void *)out);
+  fftwf_execute_dft_c2r(plan,in,out);
+}
+
+void fftCacheDFT_d(int n,fftw_complex *in,fftw_complex *out,int sign)
+{
+  int unaligned = (fftw_alignment_of((double *)in)!=0 || fftw_alignment_of((double *)out)!=0);
+  fftw_plan plan = getPlan(sign==FFTW_FORWARD ? DFT_D_FWD : DFT_D_BWD,n,1,unaligned,(void *)in==(void *)out);
+  fftw_execute_dft(plan,in,out);
+}
+
+void fftCacheR2C_d(int n,double *in,fftw_complex *out)
+{
+  int unaligned = (fftw_alignment_of(in)!=0 || fftw_alignment_of((double *)out)!=0);
+  fftw_plan plan = getPlan(R2C_D,n,1,unaligned,(void *)in==(void *)out);
+  fftw_execute_dft_r2c(plan,in,out);
+}
+
+void fftCacheC2R_d(int n,fftw_complex *in,double *out)
+{
+  int unaligned = (fftw_alignment_of((double *)in)!=0 || fftw_alignment_of(out)!=0);
+  fftw_plan plan = getPlan(C2R_D,n,1,unaligned,(void *)in==(void *)out);
+  fftw_execute_dft_c2r(plan,in,out);
+}
+
+// Batches of howmany transforms, stored one after another
+void fftCacheDFT_many_f(int n,int howmany,fftwf_complex *in,fftwf_complex *out,int sign)
+{
+  int unaligned = (fftwf_alignment_of((float *)in)!=0 || fftwf_alignment_of((float *)out)!=0);
+  fftwf_plan plan = getPlan(sign==FFTW_FORWARD ? DFT_F_FWD : DFT_F_BWD,n,howmany,unaligned,(void *)in==(void *)out);
+  fftwf_execute_dft(plan,in,out);
+}
+
+void fftCacheC2R_many_f(int n,int howmany,fftwf_complex *in,float *out)
+{
+  int unaligned = (fftwf_alignment_of((float *)in)!=0 || fftwf_alignment_of(out)!=0);
+  fftwf_plan plan = getPlan(C2R_F,n,howmany,unaligned,(void *)in==(void *)out);
+  fftwf_execute_dft_c2r(plan,in,out);
+}
+
+void fftCacheR2C_many_d(int n,int howmany,double *in,fftw_complex *out)
+{
+  int unaligned = (fftw_alignment_of(in)!=0 || fftw_alignment_of((double *)out)!=0);
+  fftw_plan plan = getPlan(R2C_D,n,howmany,unaligned,(void *)in==(void *)out);
+  fftw_execute_dft_r2c(plan,in,out);
+}
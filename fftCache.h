@@ -0,0 +1,34 @@
+#ifndef FFTCACHE_H
+#define FFTCACHE_H
+
+// Process-wide cache of FFTW plans.
+//
+// Plans are created once for each (kind, length, batch size, precision,
+// alignment, in-place) combination and then applied to the caller's arrays using the
+// FFTW new-array execute functions, which are safe to call from several
+// threads at once. Planning itself is serialised by the cache.
+
+#include <fftw3.h>
+
+#define FFTCACHE_THREAD_MIN 65536 // Shortest transform that uses FFTW threads
+
+void fftCacheSetup(unsigned flags,int nthreads,const char *wisdomDir);
+void fftCacheSaveWisdom(void);
+void fftCacheCleanup(void);
+
+// Single precision
+void fftCacheDFT_f(int n,fftwf_complex *in,fftwf_complex *out,int sign);
+void fftCacheR2C_f(int n,float *in,fftwf_complex *out);
+void fftCacheC2R_f(int n,fftwf_complex *in,float *out);
+// howmany transforms stored contiguously, (n/2+1) complex values or n reals
+// apart (2*(n/2+1) for in-place real arrays)
+void fftCacheDFT_many_f(int n,int howmany,fftwf_complex *in,fftwf_complex *out,int sign);
+void fftCacheC2R_many_f(int n,int howmany,fftwf_complex *in,float *out);
+
+// Double precision
+void fftCacheDFT_d(int n,fftw_complex *in,fftw_complex *out,int sign);
+void fftCacheR2C_d(int n,double *in,fftw_complex *out);
+void fftCacheC2R_d(int n,fftw_complex *in,double *out);
+void fftCacheR2C_many_d(int n,int howmany,double *in,fftw_complex *out);
+
+#endif
@@ -0,0 +1,342 @@
+// Fourier-domain template matching (see fftfit.h)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "fftCache.h"
+#include "fftfit.h"
+
+#define FCCF_NPROF 64 // Length of the coarse cross-correlation (as in fccf.f)
+
+static void fccf(double *amp,double *pha,double *shift);
+static double dchisqr(double tau,double *tmp,double *r,int nsum);
+static double zbrent(double x1,double x2,double f1,double f2,double tol,double *tmp,
+		     double *pha,int nsum);
+
+static void *fftfitAlloc(size_t n)
+{
+  void *ptr = fftw_malloc(n);
+
+  if (ptr == NULL)
+    {
+      printf("Unable to allocate memory for fftfit\n");
+      exit(1);
+    }
+  memset(ptr,0,n);
+  return ptr;
+}
+
+// Amplitudes and phases of harmonics 0..nh. The phases follow the e^{+ikx}
+// convention of the original NR four1 based transform, which is the
+// conjugate of the FFTW forward transform
+static void harmonics(fftw_complex *X,int nh,double *amp,double *pha)
+{
+  int k;
+
+  for (k=0;k<=nh;k++)
+    {
+      amp[k] = 2*sqrt(X[k][0]*X[k][0]+X[k][1]*X[k][1]);
+      pha[k] = atan2(-X[k][1],X[k][0]);
+    }
+}
+
+// Fits one profile (amplitudes p, phases theta) against the standard (s,
+// phi), using tmp and r as workspace
+static void fitHarmonics(double *s,double *phi,double *p,double *theta,double *tmp,double *r,
+			 int nmax,double *shift,double *eshift,double *snr,double *esnr,
+			 double *b,double *errb)
+{
+  int nh,k;
+  double errtau,fac;
+  double tau,s1,s2,s3,cosfac,sq,rms;
+  int isum;
+  int nsum,ntries;
+  double edtau,ftau,a=0,fa=0,dtau,fb=0;
+  int low,high;
+
+  nh = nmax/2;
+  for (k=0;k<=nh;k++)
+    {
+      tmp[k]=p[k]*s[k];
+      r[k]=theta[k]-phi[k];
+    }
+
+  fac = nmax/(2.0*M_PI);
+  fccf(tmp,r,shift);
+  tau = *shift;
+  for (isum=5;isum<99;isum++)
+    {
+      nsum=(int)pow(2,isum);
+      if (nsum>nh) break;
+      dtau = (2.0*M_PI)/(nsum*5);
+      edtau = 1.0/(2.0*nsum+1.0);
+      if (nsum > (nh/2.+0.5)) edtau = 1.0e-4;
+
+      ntries = 0;
+      low = -1;
+      high = -1;
+      do {
+	ftau = dchisqr(tau,tmp,r,nsum);
+	ntries++;
+	if (ftau < 0)
+	  {
+	    a=tau;
+	    fa=ftau;
+	    tau+=dtau;
+	    low=1;
+	  }
+	else
+	  {
+	    *b=tau;
+	    fb=ftau;
+	    tau=tau-dtau;
+	    high = 1;
+	  }
+	if (ntries>10)
+	  {
+	    *shift=0.0;
+	    *eshift=999.0;
+	    *snr=0.0;
+	    *esnr=0.0;
+	    return;
+	  }
+      }	while (low!=high);
+      tau = zbrent(a,*b,fa,fb,edtau,tmp,r,nsum);
+    }
+  s1=0.0;
+  s2=0.0;
+  s3=0.0;
+  for (k=1;k<=nh;k++)  /* SHOULD THIS START FROM 0 */
+    {
+      cosfac = cos(-r[k]+k*tau);
+      s1=s1+tmp[k]*cosfac;
+      s2=s2+s[k]*s[k];
+      s3=s3+k*k*tmp[k]*cosfac;
+    }
+
+  *b=s1/s2;
+  s1=0.0;
+
+  for (k=1;k<=nh;k++)
+    {
+      sq = p[k]*p[k]-2.0*(*b)*p[k]*s[k]*cos(r[k]-k*tau)+pow((*b)*s[k],2);
+      s1+=sq;
+    }
+  rms =sqrt(s1/nh);
+  *errb = rms/sqrt(2.0*s2);
+  errtau = rms/sqrt(2.0*(*b)*s3);
+  *snr = 2.0*sqrt(2.0*nh)*(*b)/rms;
+  *shift = fac*tau;
+  *eshift = fac*(errtau);
+  *esnr = *snr*(*errb)/(*b);
+}
+
+void fftfitMany(double *prof,int nprof,double *standard,int nmax,double *shift,double *eshift,
+		double *snr,double *esnr,double *b,double *errb,int *ngood)
+{
+  int nh,i,j,nwork;
+  double sum,ave;
+  double *s,*phi,*p,*theta,*tmp,*r;
+  fftw_complex *X;
+
+  nh = nmax/2;
+  // fccf uses the first FCCF_NPROF/4 harmonics even if there are fewer
+  nwork = (nh+1 > FCCF_NPROF/4+1) ? nh+1 : FCCF_NPROF/4+1;
+  s = (double *)fftfitAlloc(sizeof(double)*6*nwork);
+  phi = s+nwork;
+  p = s+2*nwork;
+  theta = s+3*nwork;
+  tmp = s+4*nwork;
+  r = s+5*nwork;
+  X = (fftw_complex *)fftfitAlloc(sizeof(fftw_complex)*(nh+1)*nprof);
+
+  /* Obtain Fourier transform of template */
+  fftCacheR2C_d(nmax,standard,X);
+  harmonics(X,nh,s,phi);
+
+  sum=0.0;
+  for (i=nh/2+1;i<=nh;i++)
+    sum+=s[i];
+  ave=2.0*sum/nh;
+
+  for (i=1;i<=nh;i++)
+    if (s[i] < ave) break;
+  *ngood=i-1;
+
+  /* Obtain Fourier transforms of the profiles */
+  if (nprof == 1)
+    fftCacheR2C_d(nmax,prof,X);
+  else
+    fftCacheR2C_many_d(nmax,nprof,prof,X);
+  for (j=0;j<nprof;j++)
+    {
+      harmonics(X+j*(nh+1),nh,p,theta);
+      fitHarmonics(s,phi,p,theta,tmp,r,nmax,shift+j,eshift+j,snr+j,esnr+j,b+j,errb+j);
+    }
+  fftw_free(X);
+  fftw_free(s);
+}
+
+void fftfit(double *prof,double *standard,int nmax,double *shift,double *eshift,
+	    double *snr,double *esnr,double *b,double *errb,int *ngood)
+{
+  fftfitMany(prof,1,standard,nmax,shift,eshift,snr,esnr,b,errb,ngood);
+}
+
+static double dchisqr(double tau,double *tmp,double *r,int nsum)
+{
+  int k;
+  double s;
+
+  s=0.0;
+  for (k=1;k<=nsum;k++)
+    s+=k*tmp[k]*sin(-r[k]+k*tau);
+
+  return s;
+}
+
+// Coarse shift (in radians) from the peak of the cross-correlation
+// function, made from the first FCCF_NPROF/4 harmonics
+static void fccf(double *amp,double *pha,double *shift)
+{
+  int nprof = FCCF_NPROF;
+  int nh,i;
+  fftw_complex ccf[FCCF_NPROF];
+  double cmax,rc,fb,fa,fc;
+  int imax=0,ia,ic;
+
+  nh = nprof/2;
+  memset(ccf,0,sizeof(ccf));
+  for (i=1;i<=nh/2;i++)
+    {
+      ccf[i][0] = amp[i]*cos(pha[i]);
+      ccf[i][1] = amp[i]*sin(pha[i]);
+      ccf[nprof-i][0] = amp[i]*cos(pha[i]);
+      ccf[nprof-i][1] = -amp[i]*sin(pha[i]);
+    }
+
+  fftCacheDFT_d(nprof,ccf,ccf,FFTW_FORWARD);
+
+  cmax = -1.0e30;
+  for (i=0;i<nprof;i++)
+    {
+      rc = ccf[i][0];
+      if (rc>cmax)
+	{
+	  cmax= rc;
+	  imax = i;
+	}
+    }
+  fb = cmax;
+  ia = imax-1;
+  if (ia==-1) ia=nprof-1;
+  fa=ccf[ia][0];
+  ic=imax+1;
+  if (ic==nprof) ic=0;
+  fc=ccf[ic][0];
+  if ((2*fb-fc-fa)!=0.0)
+    *shift=imax+0.5*(fa-fc)/(2*fb-fc-fa);
+  else
+    *shift=imax;
+  if (*shift>nh) *shift-=nprof;
+  *shift=*shift*(2.0*M_PI)/nprof;
+}
+
+static double sign(double a,double b)
+{
+  if (b>0)
+    return fabs(a);
+  else
+    return -fabs(a);
+}
+
+static double min(double a,double b)
+{
+  if (a<b)
+    return a;
+  else
+    return b;
+}
+
+static double zbrent(double x1,double x2,double f1,double f2,double tol,double *tmp,
+		     double *pha,int nsum)
+{
+  double a,b,c,d,e,fa,fb,fc,tol1,xm,p,q,r;
+  int iter;
+  int itmax=100;
+  double eps=6.0e-8,s;
+
+  a=x1;
+  b=x2;
+  fa=f1;
+  fb=f2;
+  fc=fb;
+
+  for (iter=1;iter<=itmax;iter++)
+    {
+      if (fb*fc>0)
+	{
+	  c=a;
+	  fc=fa;
+	  d=b-a;
+	  e=d;
+	}
+      if (fabs(fc)<fabs(fb))
+	{
+	  a=b;
+	  b=c;
+	  c=a;
+	  fa=fb;
+	  fb=fc;
+	  fc=fa;
+	}
+      tol1 = 2.0*eps*fabs(b)+0.5*tol;
+      xm=0.5*(c-b);
+      if (fabs(xm)<=tol1 || fb==0)
+	return b;
+      
+      if (fabs(e)>=tol1 && fabs(fa)>fabs(fb))
+	{
+	  s=fb/fa;
+	  if (a==c)
+	    {
+	      p=2.0*xm*s;
+	      q=1.0-s;
+	    }
+	  else
+	    {
+	      q=fa/fc;
+	      r=fb/fc;
+	      p=s*(2.0*xm*q*(q-r)-(b-a)*(r-1.0));
+	      q=(q-1.0)*(r-1.0)*(s-1.0);     
+	    }
+	  if (p>0.0)q=-q;
+	  p=fabs(p);
+	  if (2.0*p < min(3.0*xm*q-fabs(tol1*q),fabs(e*q)))
+	    {
+	      e=d;
+	      d=p/q;
+	    }
+	  else
+	    {
+	      d=xm;
+	      e=d;
+	    }
+	}
+      else
+	{
+	  d=xm;
+	  e=d;
+	}
+      a=b;
+      fa=fb;
+      if (fabs(d) > tol1)
+	b=b+d;
+      else
+	b=b+sign(tol1,xm);
+
+      fb=dchisqr(b,tmp,pha,nsum);
+    }
+  return b;
+}
@@ -0,0 +1,25 @@
+#ifndef FFTFIT_H
+#define FFTFIT_H
+
+// Fourier-domain template matching (Taylor 1992, Phil. Trans. R. Soc. A
+// 341, 117).
+//
+// The phase shift of a profile relative to a standard profile is found by
+// fitting in the Fourier domain. Shifts and their errors are in bins, b is
+// the scaling of the standard in the profile and ngood is the number of
+// harmonics of the standard that are above its noise level.
+//
+// The transforms use cached FFTW real-to-complex plans and the workspaces
+// are sized from nmax, so there is no limit on the number of bins.
+
+void fftfit(double *prof,double *standard,int nmax,double *shift,double *eshift,
+	    double *snr,double *esnr,double *b,double *errb,int *ngood);
+
+// Fits nprof profiles, stored one after another (nmax values apart),
+// against the same standard. The standard is transformed once and the
+// profiles together in a single batch of transforms. shift .. errb receive
+// nprof values each
+void fftfitMany(double *prof,int nprof,double *standard,int nmax,double *shift,double *eshift,
+		double *snr,double *esnr,double *b,double *errb,int *ngood);
+
+#endif
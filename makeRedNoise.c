@@ -8,6 +8,7 @@
 #include "T2toolkit.h"
 #include <fftw3.h>
 #include "makeRedNoise.h"
+#include "fftCache.h"
 
 float CubicInterpolate( float y0,float y1, float y2,float y3, float mu);
 float CatmullRomInterpolate( float y0,float y1, float y2,float y3, float mu);
@@ -15,13 +16,18 @@ float CatmullRomInterpolate( float y0,float y1, float y2,float y3, float mu);
 
 
 rednoisemodel_t* setupRedNoiseModel(float start,float end, int npt, int nreal, float pwr_1yr, float index,float beta){
-	if (nreal < 100)nreal=100;
+	// Only the realisations asked for are made. The low frequencies are
+	// instead provided by padding the transform (see model->pad)
+	if (nreal < 1)nreal=1;
+	if (npt < 8)npt=8;
 
 	rednoisemodel_t* model = (rednoisemodel_t*) malloc(sizeof(rednoisemodel_t));
 	model->start=start;
 	model->end=end;
 	model->npt=npt;
 	model->nreal=nreal;
+	model->pad=REDNOISE_PAD;
+	model->stride=npt;
 	model->pwr_1yr=pwr_1yr;
 	model->index=index;
 	model->beta=beta;
@@ -33,40 +39,81 @@ rednoisemodel_t* setupRedNoiseModel(float start,float end, int npt, int nreal, f
 	return model;
 }
 
+// Number of points per realisation needed to follow the noise at the given
+// observing cadence (days): two per observation interval, plus the points
+// used for the interpolation at either end
+int redNoiseNpt(float start,float end,double cadence){
+	int npt;
+
+	if (cadence <= 0)
+	  return 1024;
+	npt = (int)(2*(end-start)/cadence)+5;
+	if (npt < REDNOISE_MIN_NPT) npt=REDNOISE_MIN_NPT;
+	if (npt > REDNOISE_MAX_NPT) npt=REDNOISE_MAX_NPT;
+	return npt;
+}
+
+// Smallest length >= n with no prime factors larger than 7, which FFTW
+// transforms efficiently
+int smoothFFTLength(int n){
+	int m;
+
+	for (;;n++){
+	  m=n;
+	  while (m%2==0) m/=2;
+	  while (m%3==0) m/=3;
+	  while (m%5==0) m/=5;
+	  while (m%7==0) m/=7;
+	  if (m==1) return n;
+	}
+}
+
 void freeRedNoiseModel(rednoisemodel_t* model){
 	if(model->data != NULL)free(model->data);
 	free(model);
 }
 
-void populateRedNoiseModel(rednoisemodel_t* model,long *seed){
-	int t_npts;
-	int i;
+// Each realisation is the start of its own transform, and all the
+// realisations are made with one batched c2r transform
+void populateRedNoiseModel(rednoisemodel_t* model,TKstream *stream){
+	int t_npts,nspec,ngauss;
+	int i,r;
 	double freq,A,index,beta;
+	double aa,bb;
+	double *gauss,*scale;
 	double t_samp,f_bin,t_span;
 	float *data;
-	fftwf_plan plan;
 	fftwf_complex *spectrum;
 	double secperyear=365*86400.0;
 
-	t_samp=(model->end - model->start)/(float)model->npt;
-
-	model->start-=t_samp;
-	model->end+=t_samp*2.0;
-
-	if (*seed == 0){
-	  *seed=TKsetSeed();
+	// One point before the start and two after the end are needed for the
+	// interpolation in getRedNoiseValue. Half a point more is left at each
+	// end so that rounding of the (float) start time cannot give data[-1]
+	t_samp=(model->end - model->start)/(float)(model->npt-5);
+
+	model->start-=1.5*t_samp;
+	model->end=model->start+t_samp*model->npt;
+
+	t_npts=smoothFFTLength(model->npt*model->pad);
+	nspec=t_npts/2+1;
+	ngauss=2*(t_npts/2);
+
+	spectrum = (fftwf_complex*) fftwf_malloc(model->nreal*nspec*sizeof(fftwf_complex));
+	data = (float*) fftwf_malloc(model->nreal*t_npts*sizeof(float));
+	scale = (double*) malloc(nspec*sizeof(double));
+	// Draw all the random numbers for the spectra at once. Realisation r
+	// uses the same part of the stream whatever the number of realisations
+	gauss = (double*) malloc(model->nreal*ngauss*sizeof(double));
+	if (spectrum==NULL || data==NULL || scale==NULL || gauss==NULL){
+	   printf("Unable to allocate memory for %d red noise realisations of %d points\n",model->nreal,t_npts);
+	   exit(1);
 	}
-
-	t_npts=model->npt*model->nreal;
-
-	spectrum = (fftwf_complex*) fftwf_malloc((t_npts/2+1)*sizeof(fftwf_complex));
-	data = (float*) fftwf_malloc(t_npts*sizeof(float));
+	TKgaussDevFill(stream,gauss,model->nreal*ngauss);
 	
-	t_span=(model->end - model->start)/365.25; // years
-
-	t_samp=t_span/(float)model->npt;
-	model->tres=t_samp*365.25;
-	f_bin=1.0/(t_span*model->nreal); // frequency in yr^-1
+	model->tres=t_samp;
+	model->stride=t_npts;
+	t_span=t_npts*t_samp/365.25; // years covered by the transform
+	f_bin=1.0/t_span; // frequency in yr^-1
 
 
     // To convert PSD to FFT power, need to multiply by N^2/T.
@@ -77,7 +124,7 @@ void populateRedNoiseModel(rednoisemodel_t* model,long *seed){
 	//
 	// I am now 99% sure this is correct. George looked at it too!
 	// M. Keith 2013.
-	A=model->pwr_1yr /(4*t_span*model->nreal);
+	A=model->pwr_1yr /(4*t_span);
 
 
 	// we are forming "amplitudes" not powers
@@ -86,72 +133,80 @@ void populateRedNoiseModel(rednoisemodel_t* model,long *seed){
 	index=model->index/2.0;
 	A = sqrt(A);
 
-	// form a complex spectrum, then do a c2r transform.
-	spectrum[0]=0;
-	for (i=1; i < t_npts/2+1; i++){
+	// The spectral shape is the same for every realisation
+	scale[0]=0;
+	for (i=1; i < nspec; i++){
 	   freq=(double)i*f_bin;
-	   double scale=0;
+	   scale[i]=0;
 	   if(model->mode==MODE_T2CHOL){
 		  // same definition as the Cholesky code (except index is negative)
-	     scale=A*pow(fabs(freq)/model->flatten,beta)*pow(1.0+pow(fabs(freq)/model->flatten,2),index/2.0);
+	     scale[i]=A*pow(fabs(freq)/model->flatten,beta)*pow(1.0+pow(fabs(freq)/model->flatten,2),index/2.0);
 	   }
 	   if(model->mode==MODE_SIMPLE){
 		  if (freq < model->flatten)
 			 freq=model->flatten;
 
-		  scale = A*pow(freq,index);
-		  if (freq < model->cutoff)scale=0;
+		  scale[i] = A*pow(freq,index);
+		  if (freq < model->cutoff)scale[i]=0;
+	   }
+	}
+
+	// form complex spectra, then do the c2r transforms.
+	for (r=0; r < model->nreal; r++){
+	   fftwf_complex *spec=spectrum+r*nspec;
+	   double *g=gauss+r*ngauss;
+
+	   spec[0]=0;
+	   for (i=1; i < nspec; i++){
+		  aa = scale[i]*g[2*i-2];
+		  bb = scale[i]*g[2*i-1];
+		  spec[i]=(aa + I*bb);
 	   }
-	   // complex spectrum
-	   spectrum[i]=(scale*TKgaussDev(seed) + I*scale*TKgaussDev(seed));
 	}
 	
-	plan=fftwf_plan_dft_c2r_1d(t_npts,spectrum,data,FFTW_ESTIMATE);
-	fftwf_execute(plan);
-	fftwf_destroy_plan(plan);
+	fftCacheC2R_many_f(t_npts,model->nreal,spectrum,data);
 	fftwf_free(spectrum);
+	free(scale);
+	free(gauss);
 
 	model->data=data;
 }
 
-void populateRedNoiseModel2(rednoisemodel_t* model,rednoisemodel_t* model2,long *seed){
+void populateRedNoiseModel2(rednoisemodel_t* model,rednoisemodel_t* model2,TKstream *stream){
   int t_npts;
   int i;
   double freq,A,index;
   double t_samp,f_bin,t_span;
   float *data,*data2;
-  fftwf_plan plan,plan2;
   fftwf_complex *spectrum;
   fftwf_complex *spectrum2;
   double secperyear=365*86400.0;
   double aa,bb;
+  double *gauss;
 
   printf("Setting up model 2\n");
-  t_samp=(model->end - model->start)/(float)model->npt;
+  t_samp=(model->end - model->start)/(float)(model->npt-5);
   
-  model->start-=t_samp;
-  model->end+=t_samp*2.0;
+  model->start-=1.5*t_samp;
+  model->end=model->start+t_samp*model->npt;
 
-  model2->start-=t_samp;
-  model2->end+=t_samp*2.0;
-  
-  if (*seed == 0){
-	  *seed=TKsetSeed();
-  }
+  model2->start=model->start;
+  model2->end=model->end;
   
-  t_npts=model->npt*model->nreal;
+  t_npts=smoothFFTLength(model->npt*model->pad);
   
   spectrum = (fftwf_complex*) fftwf_malloc((t_npts/2+1)*sizeof(fftwf_complex));
   spectrum2 = (fftwf_complex*) fftwf_malloc((t_npts/2+1)*sizeof(fftwf_complex));
   data = (float*) fftwf_malloc(t_npts*sizeof(float));
   data2 = (float*) fftwf_malloc(t_npts*sizeof(float));
+  gauss = (double*) malloc(2*(t_npts/2)*sizeof(double));
+  TKgaussDevFill(stream,gauss,2*(t_npts/2));
   
-  t_span=(model->end - model->start)/365.25; // years
-  
-  t_samp=t_span/(float)model->npt;
-  model->tres=t_samp*365.25;
-  model2->tres=t_samp*365.25;
-  f_bin=1.0/(t_span*model->nreal); // frequency in yr^-1
+  model->tres=t_samp;
+  model2->tres=t_samp;
+  model->stride=model2->stride=t_npts;
+  t_span=t_npts*t_samp/365.25; // years covered by the transform
+  f_bin=1.0/t_span; // frequency in yr^-1
   
   
     // To convert PSD to FFT power, need to multiply by N^2/T.
@@ -162,7 +217,7 @@ void populateRedNoiseModel2(rednoisemodel_t* model,rednoisemodel_t* model2,long
   //
   // I am now 99% sure this is correct. George looked at it too!
   // M. Keith 2013.
-  A=model->pwr_1yr /(4*t_span*model->nreal);
+  A=model->pwr_1yr /(4*t_span);
 
 
   // we are forming "amplitudes" not powers
@@ -188,21 +243,18 @@ void populateRedNoiseModel2(rednoisemodel_t* model,rednoisemodel_t* model2,long
       if (freq < model->cutoff)scale=0;
     }
     // complex spectrum
-    aa = scale*TKgaussDev(seed);
-    bb = scale*TKgaussDev(seed);
+    aa = scale*gauss[2*i-2];
+    bb = scale*gauss[2*i-1];
     spectrum[i]=(aa + I*bb);
     spectrum2[i]=(bb - I*aa);
 	   //    spectrum2[i]=(aa + I*bb);
   }
   
-  plan=fftwf_plan_dft_c2r_1d(t_npts,spectrum,data,FFTW_ESTIMATE);
-  plan2=fftwf_plan_dft_c2r_1d(t_npts,spectrum2,data2,FFTW_ESTIMATE);
-  fftwf_execute(plan);
-  fftwf_execute(plan2);
-  fftwf_destroy_plan(plan);
-  fftwf_destroy_plan(plan2);
+  fftCacheC2R_f(t_npts,spectrum,data);
+  fftCacheC2R_f(t_npts,spectrum2,data2);
   fftwf_free(spectrum);
   fftwf_free(spectrum2);
+  free(gauss);
   
   model->data=data;
   model2->data=data2;
@@ -214,7 +266,7 @@ float getRedNoiseValue(rednoisemodel_t* model, float mjd,int real){
    int i = (int)((mjd-model->start)/model->tres);
    float mu = ((mjd-model->start)/model->tres) - (float)i;
 
-   i+=real*model->npt;
+   i+=real*model->stride;
    return CatmullRomInterpolate(model->data[i-1],model->data[i],model->data[i+1],model->data[i+2],mu);
 }
 
@@ -256,7 +308,6 @@ float CatmullRomInterpolate( float y0,float y1, float y2,float y3, float mu)
 
 float* getPowerSpectrum(rednoisemodel_t* model){
    fftwf_complex *spectrum;
-   fftwf_plan plan;
    float *data;
    float *power_spectrum;
    int p;
@@ -270,11 +321,10 @@ float* getPowerSpectrum(rednoisemodel_t* model){
    for (p =0 ; p < (model->npt/2+1); p++){
 	  power_spectrum[p]=0;
    }
-   plan=fftwf_plan_dft_r2c_1d(model->npt,data,spectrum,FFTW_ESTIMATE);
    int r;
    
    for (r =0 ; r < model->nreal; r++){
-	  int off=r*model->npt;
+	  int off=r*model->stride;
 	  for (p =0 ; p < model->npt; p++){
 		 data[p]=model->data[p+off];
 	  }
@@ -286,7 +336,7 @@ float* getPowerSpectrum(rednoisemodel_t* model){
 	  }
 	  float dy=data[0]-data[p];
 	  data[p] = 0;
-	  fftwf_execute(plan);
+	  fftCacheR2C_f(model->npt,data,spectrum);
 	  for (p =1 ; p < (model->npt/2+1); p++){
 		 float factor=1.0/((float)p*f_bin);
 		 spectrum[p]/=(float)(model->npt/2);
@@ -294,7 +344,6 @@ float* getPowerSpectrum(rednoisemodel_t* model){
 		 power_spectrum[p]+=crealf(spectrum[p]*conjf(spectrum[p]));
 	  }
    }
-   fftwf_destroy_plan(plan);
    fftwf_free(spectrum);
    fftwf_free(data);
    for (p =0 ; p < (model->npt/2+1); p++){
@@ -1,12 +1,20 @@
+#include "T2toolkit.h"
+
 #define MODE_T2CHOL 1
 #define MODE_SIMPLE 0
 
+#define REDNOISE_PAD 10         // Default padding factor for the FFT length
+#define REDNOISE_MIN_NPT 64     // Limits on the points per realisation chosen by redNoiseNpt
+#define REDNOISE_MAX_NPT 16384
+
 
 typedef struct rednoisemodel {
 	float start;   // start MJD
 	float end;     // end MJD
 	int npt;       // points per realisation
-	int nreal;     // number of realisations
+	int nreal;     // number of independent realisations
+	int pad;       // FFT length is at least npt*pad (protects against red leakage)
+	int stride;    // points between the start of each realisation in data
 	float pwr_1yr; // power at 1 year
 	float index;   // index in power spectrum
   float beta;
@@ -19,8 +27,10 @@ typedef struct rednoisemodel {
 
 
 rednoisemodel_t* setupRedNoiseModel(float start,float end, int npt, int nreal, float amp_1yr, float index,float beta);
-void populateRedNoiseModel(rednoisemodel_t* model,long *seed);
+void populateRedNoiseModel(rednoisemodel_t* model,TKstream *stream);
 float getRedNoiseValue(rednoisemodel_t* model, float mjd,int real);
 void freeRedNoiseModel(rednoisemodel_t* model);
 float* getPowerSpectrum(rednoisemodel_t* model);
-void populateRedNoiseModel2(rednoisemodel_t* model,rednoisemodel_t* model2,long *seed);
+int redNoiseNpt(float start,float end,double cadence);
+int smoothFFTLength(int n);
+void populateRedNoiseModel2(rednoisemodel_t* model,rednoisemodel_t* model2,TKstream *stream);
@@ -23,12 +23,13 @@
 #include "T2toolkit.h"
 #include "toasim.h"
 #include "makeRedNoise.h"
+#include "fftCache.h"
+#include "fftfit.h"
 #include "TKfit.h"
 #include "GWsim.h"
 #include "ptimeLib.h"
 #include <fftw3.h>
 #include <complex.h>
-#include "evaldefs.h"
 
 void createDirectoryStructure(controlStruct *control);
 void createRunScript(controlStruct *control,char *dir0);
@@ -43,7 +44,7 @@ size_t trimwhitespace(char *out, size_t len, const char *str);
 void readRCVRFromScript(controlStruct *control,FILE *fin);
 void readBEFromScript(controlStruct *control,FILE *fin);
 void readObsSysFromScript(controlStruct *control,FILE *fin);
-double BTmodel(double pb,double ecc,double a1,double t0,double om,long double t);
+double BTmodel(double pb,double ecc,double a1,double t0,double om,toaEpoch t);
 void readPulsarsFromScript(controlStruct *control,FILE *fin);
 void readObsRunFromScript(controlStruct *control,FILE *fin);
 void readScheduleFromScript(controlStruct *control,FILE *fin);
@@ -88,30 +89,18 @@ void processGW(controlStruct *control,int r);
 void createGW(controlStruct *control,int r);
 void processBE(controlStruct *control,int r);
 void processRCVR(controlStruct *control,int r);
-void loadProfileFromFile(double *prof,double *templ,int nbin,char *fname);
-double calcDiffractiveScint(controlStruct *control,int s0,int j,int sys);
-
-void fftfit(double *prof,double *standard,int nmax,double *shift,double *eshift,
-	    double *snr,double *esnr,double *b,double *errb,int *ngood);
-void fft(double *y,int nmax,double *amp,double *pha);
-void four1(double data[], unsigned long nn, int isign);
-void fccf(double *amp,double *pha,double *shift,int nprof);
-double dchisqr(double tau,double *tmp,double *r,int num);
-double zbrent(double x1,double x2,double f1,double f2,double tol,double *tmp,
-	      double *pha,int nsum);
-double min(double a,double b);
-double sign(double a,double b);
+double calcDiffractiveScint(controlStruct *control,int s0,int j,int sys,int realisation);
+
 void readObservatoryPositions(controlStruct *control);
 long double getTimeHA(controlStruct *control,double ha,long double sat,int telID,long double ra);
 long double fortran_mod(long double a,long double p);
 
-#define SWAP(a,b) tempr=(a);(a)=(b);(b)=tempr
-
 int main(int argc,char *argv[])
 {
   controlStruct *control;
   char dir0[MAX_STRLEN];
-  int r,p;
+  char setupDir[MAX_STRLEN];
+  int r;
   printf("At the start\n");
   getcwd(dir0,MAX_STRLEN);
 
@@ -122,96 +111,151 @@ int main(int argc,char *argv[])
   loadInputs(control,argc,argv);
   printf("Reading script\n");
   readScript(control);
+  printf("Random number seed = %ld\n",control->seed);
   printf("Starting\n");
   createDirectoryStructure(control);
   printf("Complete directory structure\n");
+  // FFTW plans are shared by all realisations; any wisdom is kept with the setup files
+  if (snprintf(setupDir,sizeof(setupDir),"%s/setup",control->name) >= (int)sizeof(setupDir))
+    {
+      printf("Simulation name is too long: %s\n",control->name);
+      finishOff(control);
+    }
+  fftCacheSetup(control->fftPlanFlags,control->fftThreads,setupDir);
   // Setup pulsars
 
   readObservatoryPositions(control);
 
+  allocateObservations(control);
+
   // Note that this should run for every iteration if the user requests that pulsar positions etc. change
   // for each iteration. Should only run once if kept constant
-  for (r=0;r<control->nreal;r++)
+  if (control->nthreads > 1 && control->nreal > 1)
+    runRealisationsThreaded(control,dir0);
+  else
     {
-      // Reinitialise number of observations
-      for (p=0;p<control->npsr;p++)
-	control->psr[p].nToAs=0;
-
-      printf("Creating realisation %d\n",r);
-      processBE(control,r);
-      processRCVR(control,r);
-
-      processPulsars(control,r);
-
-      processGlitches(control,r);
-      // Create parameter files used in the simulation
-      createParSimulate(control,r);
-      printf("process ObsRun\n");
-      processObsRun(control,r);
-      printf("process Sched\n");
-      processSched(control,r);
-      printf("process ObsSys\n");
-      processObsSys(control,r);
-      printf("createIdealArrivaltimes\n");
-
-      createIdealArrivalTimes(control,r);
-      printf("writeArrivalTimes %d\n",r);
-      writeTimFiles(control,r);
-      printf("Create radiometer noise %d\n",r);
-      createRadiometerNoise(control,r);
-      printf("ProcessTnoise %d\n",r);
-      processTnoise(control,r);
-      printf("createTnoise %d\n",r);
-      createTnoise(control,r);
-
-      printf("ProcessPlanets %d\n",r);
-      processPlanets(control,r);
-      printf("createPlanets %d\n",r);
-      createPlanets(control,r);
-
-      printf("processCLKNoise\n");
-      processClkNoise(control,r);
-      printf("createCLKnoise\n");
-      createClkNoise(control,r);
-
-      printf("processEphemNoise\n");
-      processEphemNoise(control,r);
-      printf("createEphemNoise\n");
-      createEphemNoise(control,r);
-
-      printf("processDMvar\n");
-      processDMvar(control,r);
-      printf("CreateDMvar\n");
-      createDMvar(control,r);
-
-      printf("ProcessDMcovar %d\n",r);
-      processDMcovar(control,r);
-      createDMcovar(control,r);
-
-      printf("CreateDMfunc %d\n",r);
-      createDMfunc(control,r);
-
-      printf("processJitter %d\n",r);
-      processJitter(control,r);
-      createJitter(control,r);
-
-      printf("ProcessGW %d\n",r);
-      processGW(control,r);
-      createGW(control,r);
-      
-      //      printf("CreateBEoffsets %d\n",r);
-      //      createBEoffsets(control,r);
-      //      printf("CreateOutliers %d\n",r);
-      createOutliers(control,r);
-
-      printf("meanRealScript %d\n",r);
-      makeRealScript(control,r,dir0);
+      for (r=0;r<control->nreal;r++)
+	runRealisation(control,r,dir0);
     }
   createRunScript(control,dir0);
+  gwbPrecisionReport();
+  fftCacheSaveWisdom();
+  fftCacheCleanup();
+  evalCacheCleanup();
+  radiometerCacheCleanup();
+  profileStoreCleanup();
+  gwbFourierCleanup();
+  gwResponseCleanup();
+  cwCatalogueCleanup();
+  gwbCacheCleanup();
 
   finishOff(control);
 }
 
+// Creates all the files for realisation r. Everything that changes between
+// realisations is stored in control, so concurrent calls must each be given
+// their own copy (see runRealisationsThreaded)
+void runRealisation(controlStruct *control,int r,char *dir0)
+{
+  int p;
+
+  // Reinitialise number of observations and the time span for this realisation
+  for (p=0;p<control->npsr;p++)
+    control->psr[p].nToAs=0;
+  control->minT = 99999;
+  control->maxT = 0;
+
+  printf("Creating realisation %d\n",r);
+  // Each stage evaluates its expressions using its own random number stream
+  setExpressionStream(control,r,RAN_BE);
+  processBE(control,r);
+  setExpressionStream(control,r,RAN_RCVR);
+  processRCVR(control,r);
+
+  setExpressionStream(control,r,RAN_PSR);
+  processPulsars(control,r);
+
+  setExpressionStream(control,r,RAN_GLITCH);
+  processGlitches(control,r);
+  // Create parameter files used in the simulation
+  createParSimulate(control,r);
+  setExpressionStream(control,r,RAN_OBSRUN);
+  printf("process ObsRun\n");
+  processObsRun(control,r);
+  setExpressionStream(control,r,RAN_SCHED);
+  printf("process Sched\n");
+  processSched(control,r);
+  setExpressionStream(control,r,RAN_OBSSYS);
+  printf("process ObsSys\n");
+  processObsSys(control,r);
+  setExpressionStream(control,r,RAN_TOAS);
+  printf("createIdealArrivaltimes\n");
+
+  createIdealArrivalTimes(control,r);
+  printf("writeArrivalTimes %d\n",r);
+  writeTimFiles(control,r);
+  setExpressionStream(control,r,RAN_RADIOMETER);
+  printf("Create radiometer noise %d\n",r);
+  createRadiometerNoise(control,r);
+  setExpressionStream(control,r,RAN_TNOISE);
+  printf("ProcessTnoise %d\n",r);
+  processTnoise(control,r);
+  printf("createTnoise %d\n",r);
+  createTnoise(control,r);
+
+  setExpressionStream(control,r,RAN_PLANETS);
+  printf("ProcessPlanets %d\n",r);
+  processPlanets(control,r);
+  printf("createPlanets %d\n",r);
+  createPlanets(control,r);
+
+  setExpressionStream(control,r,RAN_CLKNOISE);
+  printf("processCLKNoise\n");
+  processClkNoise(control,r);
+  printf("createCLKnoise\n");
+  createClkNoise(control,r);
+
+  setExpressionStream(control,r,RAN_EPHEMNOISE);
+  printf("processEphemNoise\n");
+  processEphemNoise(control,r);
+  printf("createEphemNoise\n");
+  createEphemNoise(control,r);
+
+  setExpressionStream(control,r,RAN_DMVAR);
+  printf("processDMvar\n");
+  processDMvar(control,r);
+  printf("CreateDMvar\n");
+  createDMvar(control,r);
+
+  setExpressionStream(control,r,RAN_DMCOVAR);
+  printf("ProcessDMcovar %d\n",r);
+  processDMcovar(control,r);
+  createDMcovar(control,r);
+
+  setExpressionStream(control,r,RAN_DMFUNC);
+  printf("CreateDMfunc %d\n",r);
+  createDMfunc(control,r);
+
+  setExpressionStream(control,r,RAN_JITTER);
+  printf("processJitter %d\n",r);
+  processJitter(control,r);
+  createJitter(control,r);
+
+  setExpressionStream(control,r,RAN_GW);
+  printf("ProcessGW %d\n",r);
+  processGW(control,r);
+  createGW(control,r);
+  
+  //      printf("CreateBEoffsets %d\n",r);
+  //      createBEoffsets(control,r);
+  //      printf("CreateOutliers %d\n",r);
+  setExpressionStream(control,r,RAN_OUTLIERS);
+  createOutliers(control,r);
+
+  printf("meanRealScript %d\n",r);
+  makeRealScript(control,r,dir0);
+}
+
 void createRunScript(controlStruct *control,char *dir0)
 {
   FILE *fout;
@@ -318,8 +362,13 @@ void makeRealScript(controlStruct *control,int r,char *dir0)
   FILE *fout;
   char foutName[1024];
   char runStr[4096];
+  char corrStr[4096];
   char add[1024];
-  int i,j,k,l,m;
+  char realDir[1024];
+  char outTim[MAX_STRLEN];
+  char composeName[MAX_STRLEN];
+  FILE *compose=NULL;
+  int i,j,k,l,m,n;
   int beOff;
   int beNums[1024];
   int nBE,found;
@@ -361,10 +410,28 @@ void makeRealScript(controlStruct *control,int r,char *dir0)
       //      fprintf(fout,"mv %s.itim.sim %s.sim\n",control->psr[i].name,control->psr[i].name);
       fprintf(fout,"mv withpn.tim %s.sim\n",control->psr[i].name,control->psr[i].name);
 
+      if (control->composeMode == COMPOSE_INTERNAL)
+	{
+	  // All the tim files for this pulsar are made by one run of ptaSimulate
+	  if (snprintf(composeName,sizeof(composeName),"%s/workFiles/real_%d/%s.compose",
+		       control->name,r,control->psr[i].name) >= (int)sizeof(composeName))
+	    {
+	      printf("File name too long for the realisations of %s\n",control->psr[i].name);
+	      finishOff(control);
+	    }
+	  if (!(compose = fopen(composeName,"w")))
+	    {
+	      printf("Unable to open %s\n",composeName);
+	      finishOff(control);
+	    }
+	  fprintf(compose,"# Ideal ToAs, realisation, output, corrections (made by ptaSimulate)\n");
+	  fprintf(fout,"%s --compose %s.compose\n",control->simExe,control->psr[i].name);
+	}
+
       for (l=0;l<control->nOutput;l++)
 	{
 	  
-	  sprintf(runStr,"%s -gr createRealisation -f %s.sim -corr %s.addGauss",control->t2exe,control->psr[i].name,control->psr[i].name);
+	  sprintf(corrStr," -corr %s.addGauss",control->psr[i].name);
 	  
 	  // Shall we add backend jumps?
 	  //	  sprintf(add," -corr %s.addBEoffsets",control->psr[i].name);
@@ -372,7 +439,7 @@ void makeRealScript(controlStruct *control,int r,char *dir0)
 	  
 	  // Outliers?
 	  sprintf(add," -corr %s.addOutliers",control->psr[i].name);
-	  strcat(runStr,add);
+	  strcat(corrStr,add);
 	  
 	  // Does this pulsar have red noise model?
 	  for (j=0;j<control->nTnoise;j++)
@@ -390,7 +457,7 @@ void makeRealScript(controlStruct *control,int r,char *dir0)
 	      if (control->tnoise[j].psrNum == i && include==1)
 		{
 		  sprintf(add," -corr %s.tnoise.%d",control->psr[i].name,j);
-		  strcat(runStr,add);
+		  strcat(corrStr,add);
 		}
 	    }
 	  
@@ -410,20 +477,20 @@ void makeRealScript(controlStruct *control,int r,char *dir0)
 	      if (control->planets[j].psrNum == i && include==1)
 		{
 		  sprintf(add," -corr %s.planets.%d",control->psr[i].name,j);
-		  strcat(runStr,add);
+		  strcat(corrStr,add);
 		}
 	    }
 	  
 	  if (control->nClkNoise == 1)
 	    {
 	      sprintf(add," -corr %s.clknoise.%d",control->psr[i].name,0);
-	      strcat(runStr,add);	      
+	      strcat(corrStr,add);	      
 	    }
 	  
 	  if (control->nEphemNoise == 1)
 	    {
 	      sprintf(add," -corr %s.ephemnoise.%d",control->psr[i].name,0);
-	      strcat(runStr,add);	      
+	      strcat(corrStr,add);	      
 	    }
 	  
 	  
@@ -433,7 +500,7 @@ void makeRealScript(controlStruct *control,int r,char *dir0)
 	      if (control->dmVar[j].psrNum == i)
 		{
 		  sprintf(add," -corr %s.dmvar.%d",control->psr[i].name,j);
-		  strcat(runStr,add);
+		  strcat(corrStr,add);
 		}
 	    }
 	  
@@ -443,7 +510,7 @@ void makeRealScript(controlStruct *control,int r,char *dir0)
 	      if (control->dmCovar[j].psrNum == i)
 		{
 		  sprintf(add," -corr %s.dmcovar.%d",control->psr[i].name,j);
-		  strcat(runStr,add);
+		  strcat(corrStr,add);
 		}
 	    }
 	  
@@ -453,7 +520,7 @@ void makeRealScript(controlStruct *control,int r,char *dir0)
 	      if (control->dmFunc[j].psrNum == i)
 		{
 		  sprintf(add," -corr %s.dmfunc.%d",control->psr[i].name,j);
-		  strcat(runStr,add);
+		  strcat(corrStr,add);
 		}
 	    }
 	  
@@ -463,14 +530,14 @@ void makeRealScript(controlStruct *control,int r,char *dir0)
 	      if (control->jitter[j].psrNum == i)
 		{
 		  sprintf(add," -corr %s.jitter.%d",control->psr[i].name,j);
-		  strcat(runStr,add);
+		  strcat(corrStr,add);
 		}
 	    }
 	  
 	  for (j=0;j<control->nGW;j++)
 	    {
 	      sprintf(add," -corr %s.addGW.%d",control->psr[i].name,j);
-	      strcat(runStr,add);
+	      strcat(corrStr,add);
 	    }
 	  
 	  //sprintf(runStr,"tempo2 -gr createRealisation -f %s.sim -corr %s.addGauss -corr %s.addBackendOffsets",control->psr[i].name,control->psr[i].name,control->psr[i].name);
@@ -486,45 +553,87 @@ void makeRealScript(controlStruct *control,int r,char *dir0)
 	      strcat(runStr,add);
 	      }*/
 	  //      printf("Running: >%s<\n",runStr);
-	  fprintf(fout,"%s\n",runStr);
-      
-	  fprintf(fout,"mv %s.sim.real %s.tim\n",control->psr[i].name,control->psr[i].name);
-	  if (l==0)
-	    fprintf(fout,"cp %s.tim %s/%s/output/real_%d/.\n",control->psr[i].name,dir0,control->name,r);
-	  else
-	    fprintf(fout,"cp %s.tim %s/%s/output/real_%d/%s/.\n",control->psr[i].name,dir0,control->name,r,control->output[l].fname);
-	  fprintf(fout,"%s -f %s.par %s.tim -newpar\n",control->t2exe,control->psr[i].name,control->psr[i].name);
-	  if (l==0)
-	    fprintf(fout,"cp new.par %s/%s/output/real_%d/%s.par\n",dir0,control->name,r,control->psr[i].name);
-	  else
-	    fprintf(fout,"cp new.par %s/%s/output/real_%d/%s/%s.par\n",dir0,control->name,r,control->output[l].fname,control->psr[i].name);
-
-	  // Now cope with the cuts
-	  for (j=0;j<control->nCut;j++)
+	  // A batched run (nbatch:) stores several noise realisations in each
+	  // correction file, and each one gets its own output directory
+	  if (snprintf(runStr,sizeof(runStr),"%s -gr createRealisation -f %s.sim%s",
+		       control->t2exe,control->psr[i].name,corrStr) >= (int)sizeof(runStr))
+	    {
+	      printf("The createRealisation command for %s is too long\n",control->psr[i].name);
+	      finishOff(control);
+	    }
+	  for (k=0;k<control->nbatch;k++)
 	    {
+	      if (control->nbatch==1)
+		sprintf(realDir,"real_%d",r);
+	      else
+		sprintf(realDir,"real_%d_%d",r,k);
 	      if (l==0)
+		n = snprintf(outTim,sizeof(outTim),"%s/%s/output/%s/%s.tim",dir0,control->name,realDir,control->psr[i].name);
+	      else
+		n = snprintf(outTim,sizeof(outTim),"%s/%s/output/%s/%s/%s.tim",dir0,control->name,realDir,
+			     control->output[l].fname,control->psr[i].name);
+	      if (n >= (int)sizeof(outTim))
 		{
-		  fprintf(fout,"mkdir %s/%s/output/real_%d/%s\n",dir0,control->name,r,control->cutName[j]);
+		  printf("Output file name too long for %s\n",control->psr[i].name);
+		  finishOff(control);
 		}
-	      else
+
+	      if (control->composeMode == COMPOSE_INTERNAL)
 		{
-		  fprintf(fout,"mkdir %s/%s/output/real_%d/%s/%s\n",dir0,control->name,r,control->output[l].fname,control->cutName[j]);
+		  // Written by the --compose run above
+		  fprintf(compose,"%s.sim %d %s%s\n",control->psr[i].name,k,outTim,corrStr);
+		  fprintf(fout,"cp %s %s.tim\n",outTim,control->psr[i].name);
 		}
-	      fprintf(fout,"\\rm cut.%s.tim; awk '{if ($3 < %f) {print $0}}' %s.tim > cut.%s.tim \n",control->psr[i].name,control->mjdCut[j],control->psr[i].name,control->psr[i].name);
-	      fprintf(fout,"%s -f %s.par cut.%s.tim -newpar\n",control->t2exe,control->psr[i].name,control->psr[i].name);
-	      if (l==0)
+	      else
 		{
-		  fprintf(fout,"cp new.par %s/%s/output/real_%d/%s/%s.par\n",dir0,control->name,r,control->cutName[j],control->psr[i].name);
-		  fprintf(fout,"cp cut.%s.tim %s/%s/output/real_%d/%s/%s.tim\n",control->psr[i].name,dir0,control->name,r,control->cutName[j],control->psr[i].name);
+		  if (control->nbatch==1)
+		    fprintf(fout,"%s\n",runStr);
+		  else
+		    fprintf(fout,"%s -real %d\n",runStr,k);
+		  fprintf(fout,"mv %s.sim.real %s.tim\n",control->psr[i].name,control->psr[i].name);
+		  if (l==0)
+		    fprintf(fout,"cp %s.tim %s/%s/output/%s/.\n",control->psr[i].name,dir0,control->name,realDir);
+		  else
+		    fprintf(fout,"cp %s.tim %s/%s/output/%s/%s/.\n",control->psr[i].name,dir0,control->name,realDir,control->output[l].fname);
 		}
+	      fprintf(fout,"%s -f %s.par %s.tim -newpar\n",control->t2exe,control->psr[i].name,control->psr[i].name);
+	      if (l==0)
+		fprintf(fout,"cp new.par %s/%s/output/%s/%s.par\n",dir0,control->name,realDir,control->psr[i].name);
 	      else
+		fprintf(fout,"cp new.par %s/%s/output/%s/%s/%s.par\n",dir0,control->name,realDir,control->output[l].fname,control->psr[i].name);
+	      
+	      // Now cope with the cuts
+	      for (j=0;j<control->nCut;j++)
 		{
-		  fprintf(fout,"cp new.par %s/%s/output/real_%d/%s/%s/%s.par\n",dir0,control->name,r,control->output[l].fname,control->cutName[j],control->psr[i].name);
-		  fprintf(fout,"cp cut.%s.tim %s/%s/output/real_%d/%s/%s/%s.tim\n",control->psr[i].name,dir0,control->name,r,control->output[l].fname,control->cutName[j],control->psr[i].name);
+		  if (l==0)
+		    {
+		      fprintf(fout,"mkdir %s/%s/output/%s/%s\n",dir0,control->name,realDir,control->cutName[j]);
+		    }
+		  else
+		    {
+		      fprintf(fout,"mkdir %s/%s/output/%s/%s/%s\n",dir0,control->name,realDir,control->output[l].fname,control->cutName[j]);
+		    }
+		  fprintf(fout,"\\rm cut.%s.tim; awk '{if ($3 < %f) {print $0}}' %s.tim > cut.%s.tim \n",control->psr[i].name,control->mjdCut[j],control->psr[i].name,control->psr[i].name);
+		  fprintf(fout,"%s -f %s.par cut.%s.tim -newpar\n",control->t2exe,control->psr[i].name,control->psr[i].name);
+		  if (l==0)
+		    {
+		      fprintf(fout,"cp new.par %s/%s/output/%s/%s/%s.par\n",dir0,control->name,realDir,control->cutName[j],control->psr[i].name);
+		      fprintf(fout,"cp cut.%s.tim %s/%s/output/%s/%s/%s.tim\n",control->psr[i].name,dir0,control->name,realDir,control->cutName[j],control->psr[i].name);
+		    }
+		  else
+		    {
+		      fprintf(fout,"cp new.par %s/%s/output/%s/%s/%s/%s.par\n",dir0,control->name,realDir,control->output[l].fname,control->cutName[j],control->psr[i].name);
+		      fprintf(fout,"cp cut.%s.tim %s/%s/output/%s/%s/%s/%s.tim\n",control->psr[i].name,dir0,control->name,realDir,control->output[l].fname,control->cutName[j],control->psr[i].name);
+		    }
 		}
 	    }
 
 	}
+      if (compose)
+	{
+	  fclose(compose);
+	  compose = NULL;
+	}
     }
   fprintf(fout,"set dte = `date`\n");
   fprintf(fout,"echo \"[$dte] [$host] [$usr] [$pid] Complete processing realisation %d\" >> %s/%s/scripts/status/runStat\n",r,dir0,control->name);
@@ -537,6 +646,7 @@ void writeTimFiles(controlStruct *control,int r)
   int i,j,k,p;
   FILE *fout;
   char fname[1024];
+  char mjd[64];
 
   for (p=0;p<control->npsr;p++)
     {
@@ -545,10 +655,18 @@ void writeTimFiles(controlStruct *control,int r)
       fprintf(fout,"FORMAT 1\n");
       for (i=0;i<control->psr[p].nToAs;i++)
 	{
-	  fprintf(fout,"%d %.5f %15.15Lf %.5f %s -or %s -sched %s -tobs %g\n",i,
-		  control->psr[p].obs[i].freq.dval,control->psr[p].obs[i].sat,
-		  control->psr[p].obs[i].toaErr.dval*1e6,control->psr[p].obs[i].tel,
-		  control->psr[p].obs[i].or,control->psr[p].obs[i].sched,control->psr[p].obs[i].tobs.dval);
+	  epochFormat(mjd,sizeof(mjd),control->psr[p].toa.sat[i],15);
+	  fprintf(fout,"%d %.5f %s %.5f %s -or %s -sched %s -tobs %g",i,
+		  control->psr[p].toa.freq[i],mjd,
+		  control->psr[p].toa.toaErr[i]*1e6,control->psr[p].toa.telName[control->psr[p].toa.tel[i]],
+		  control->obsRun[control->psr[p].toa.obsRun[i]].name,
+		  control->psr[p].toa.sched[i]==-1 ? "NA" : control->sched[control->psr[p].toa.sched[i]].name,
+		  control->psr[p].toa.tobs[i]);
+	  // A wideband ToA: the ideal ToAs have no DM offset, so the measured DM
+	  // is the pulsar's DM
+	  if (control->psr[p].toa.dmErr[i] > 0)
+	    fprintf(fout," -pp_dm %.12g -pp_dme %g",control->psr[p].dm,control->psr[p].toa.dmErr[i]);
+	  fprintf(fout,"\n");
 	}
       fclose(fout);
     }
@@ -556,10 +674,11 @@ void writeTimFiles(controlStruct *control,int r)
 
 void createIdealArrivalTimes(controlStruct *control,int r)
 {
-  int i,j,s0,k,p0,sys;
+  int i,j,s0,k,p0,sys,c,nwide;
   char tel[128];
   long double t0,addT,sat;
-  double err,efac,equad,freq,scale=1;
+  double err=0,efac,equad,freq,scale=1;
+  double *wideFreq,*wideErr,dmErr;
   int telID=-1;
   int v=0;
   int ntoa;
@@ -606,16 +725,18 @@ void createIdealArrivalTimes(controlStruct *control,int r)
 	      {
 		sys=0;
 		do {
+		  arenaMark mark = arenaGetMark(&(control->scratch));
 		  //		  printf("Processing system: %d %d\n",sys,control->sched[s0].obs[j].obsSysNum);
 		  // Now add this observation to the correct pulsar
 		  p0=control->sched[s0].obs[j].psrNum;
 		  ntoa = control->psr[p0].nToAs;
+		  reserveToAs(control,p0,ntoa+1);
 		  
 		  //		  printf("Setting tobs for %s\n",control->psr[p0].name);
 		  fillDval(&(control->sched[s0].obs[j].tobs),control);
-		  control->psr[p0].obs[ntoa].tobs.dval = control->sched[s0].obs[j].tobs.dval;
-		  control->psr[p0].obs[ntoa].beNum = control->sched[s0].obs[j].beNum;
-		  printf("Setting Result = %g %d %d\n", control->psr[p0].obs[ntoa].tobs.dval,p0,ntoa);
+		  control->psr[p0].toa.tobs[ntoa] = control->sched[s0].obs[j].tobs.dval;
+		  control->psr[p0].toa.beNum[ntoa] = control->sched[s0].obs[j].beNum;
+		  printf("Setting Result = %g %d %d\n", control->psr[p0].toa.tobs[ntoa],p0,ntoa);
 		  
 		  // Update the error bar size
 		  fillDval(&(control->sched[s0].obs[j].toaErr),control);
@@ -626,15 +747,21 @@ void createIdealArrivalTimes(controlStruct *control,int r)
 		  if (control->psr[control->sched[s0].obs[j].psrNum].setDiff_df==1
 		      && control->psr[control->sched[s0].obs[j].psrNum].setDiff_ts==1)
 		    {
-		      printf("Into diff scale %g %d %d\n",control->psr[p0].obs[ntoa].tobs.dval,p0,ntoa);
-		      scale = calcDiffractiveScint(control,s0,j,sys);
-		      printf("Out diff scale %g\n",control->psr[p0].obs[ntoa].tobs.dval);
+		      printf("Into diff scale %g %d %d\n",control->psr[p0].toa.tobs[ntoa],p0,ntoa);
+		      scale = calcDiffractiveScint(control,s0,j,sys,r);
+		      printf("Out diff scale %g\n",control->psr[p0].toa.tobs[ntoa]);
 		    }
 		  else
 		    scale=1;
 		  
+		  nwide=0;
 		  if (strcmp(control->sched[s0].obs[j].toaErr.inVal,"radiometer")==0)
-		    err = calculateToaErrRadiometer(control,s0,j,sys,scale,r);
+		    {
+		      // The backend's channels may give several ToAs, or a ToA and a DM
+		      nwide = widebandToaErrs(control,s0,j,sys,scale,r,&wideFreq,&wideErr,&dmErr);
+		      if (nwide==0)
+			err = calculateToaErrRadiometer(control,s0,j,sys,scale,r);
+		    }
 		  else
 		    err=control->sched[s0].obs[j].toaErr.dval;
 		  efac=control->sched[s0].obs[j].efac.dval;
@@ -678,26 +805,39 @@ void createIdealArrivalTimes(controlStruct *control,int r)
 			}
 
 		      //	    printf("Process %s\n",control->psr[p0].name);
-		      control->psr[p0].obs[ntoa].sat = sat;
-		      if (sat > control->maxT) control->maxT = sat;
-		      if (sat < control->minT) control->minT = sat;
-		      control->psr[p0].obs[ntoa].freq.dval = freq;
-		      control->psr[p0].obs[ntoa].toaErr.dval = err;
-		      control->psr[p0].obs[ntoa].efac.dval = efac;
-		      control->psr[p0].obs[ntoa].equad.dval = equad;
+		      for (c=0;c<((nwide > 0) ? nwide : 1);c++)
+			{
+			  ntoa = control->psr[p0].nToAs;
+			  reserveToAs(control,p0,ntoa+1);
+			  if (nwide > 0)
+			    {
+			      freq = wideFreq[c];
+			      err = wideErr[c];
+			      control->psr[p0].toa.tobs[ntoa] = control->sched[s0].obs[j].tobs.dval;
+			      control->psr[p0].toa.beNum[ntoa] = control->sched[s0].obs[j].beNum;
+			    }
+			  control->psr[p0].toa.sat[ntoa] = epochFromMJD(sat);
+			  if (sat > control->maxT) control->maxT = sat;
+			  if (sat < control->minT) control->minT = sat;
+			  control->psr[p0].toa.freq[ntoa] = freq;
+			  control->psr[p0].toa.toaErr[ntoa] = err;
+			  control->psr[p0].toa.dmErr[ntoa] = (nwide > 0) ? dmErr : 0;
+			  control->psr[p0].toa.efac[ntoa] = efac;
+			  control->psr[p0].toa.equad[ntoa] = equad;
+		      
+			  control->psr[p0].toa.rcvrNum[ntoa] = control->sched[s0].obs[j].rcvrNum;
+			  control->psr[p0].toa.obsSysNum[ntoa] = control->sched[s0].obs[j].obsSysNum;
 		      
-		      // Look for outliers
-		      printf("Outlier here: %s %s\n",control->sched[s0].obs[j].outlierAmp.inVal,control->sched[s0].obs[j].outlierProb.inVal);
-		      control->psr[p0].obs[ntoa].outlierAmp.set = control->sched[s0].obs[j].outlierAmp.set;
-		      control->psr[p0].obs[ntoa].outlierProb.set = control->sched[s0].obs[j].outlierProb.set;
-		      strcpy(control->psr[p0].obs[ntoa].outlierAmp.inVal,control->sched[s0].obs[j].outlierAmp.inVal);
-		      strcpy(control->psr[p0].obs[ntoa].outlierProb.inVal,control->sched[s0].obs[j].outlierProb.inVal);
-		      strcpy(control->psr[p0].obs[ntoa].tel,tel);
-		      strcpy(control->psr[p0].obs[ntoa].sched,control->sched[s0].name);
-		      strcpy(control->psr[p0].obs[ntoa].or,control->obsRun[i].name);
-		      (control->psr[p0].nToAs)++;
+			  // Outliers are defined by the schedule entry (see createOutliers)
+			  printf("Outlier here: %s %s\n",control->sched[s0].obs[j].outlierAmp.inVal,control->sched[s0].obs[j].outlierProb.inVal);
+			  control->psr[p0].toa.tel[ntoa] = toaTelescopeId(&(control->psr[p0].toa),tel);
+			  control->psr[p0].toa.obsRun[ntoa] = i;
+			  control->psr[p0].toa.sched[ntoa] = s0;
+			  control->psr[p0].toa.schedObs[ntoa] = j;
+			  (control->psr[p0].nToAs)++;
+			}
 		    }
-		  
+		  arenaRelease(&(control->scratch),mark);
 		  sys++;
 		} while (control->sched[s0].obs[j].obsSysNum!=-1 && sys < control->obsSys[control->sched[s0].obs[j].obsSysNum].nSys);
 	      }
@@ -707,7 +847,7 @@ void createIdealArrivalTimes(controlStruct *control,int r)
 	      addT = control->obsRun[i].cadence.dval; 
 	      t0 += addT;
 	      if (control->obsRun[i].probFailure.set==1)
-		fail = checkProbability(control->obsRun[i].probFailure,control);
+		fail = checkProbability(control->obsRun[i].probFailure,&(control->expr));
 	    } while (fail==1);
 	  } while (t0 < control->obsRun[i].finish.dval);
 	}
@@ -822,8 +962,6 @@ void processPulsars(controlStruct *control,int r)
 {
   int i,p;
   char str[1024];
-  char expression[1024];
-  int errorFlag;
   double dist,dm;
   //
   // 1. Check if these parameters should remain constant, change or be set for the first time
@@ -886,15 +1024,10 @@ void processPulsars(controlStruct *control,int r)
 	{
 	  printf("str = %s %s\n",control->psr[p].setParamName[i],
 		 control->psr[p].paramVal[i].inVal);
-	  sprintf(expression,"v = %s",control->psr[p].paramVal[i].inVal);
-	  nVariables = 0;
-	  //	  printf("evaluating: %s\n",expression);
 	  if (r==0 || control->psr[p].paramVal[i].constant == 0)
 	    {
-	      errorFlag = runEvaluateExpression(expression,control);
+	      control->psr[p].paramVal[i].dval = evaluateValue(control->psr[p].paramVal[i].inVal,0,&(control->expr));
 	      convertToUpper(control->psr[p].setParamName[i]);
-	      //	  printf("[%s] [%d] [%d] result = %g\n",expression,errorFlag,nVariables,variable[0].value);
-	      control->psr[p].paramVal[i].dval = variable[0].value;
 	      control->psr[p].paramVal[i].set = 1;
 
 	      if (strcmp(control->psr[p].setParamName[i],"RAJ")==0)
@@ -1177,7 +1310,7 @@ void processGW(controlStruct *control,int r)
   for (i=0;i<control->nGW;i++)
     {
 	  // Evaluate expressions
-      if (control->gw[i].type==1)
+      if (control->gw[i].type==1 || control->gw[i].type==7)
 	{
 	  fillDval(&(control->gw[i].alpha),control);
 	  fillDval(&(control->gw[i].amp),control);
@@ -1215,6 +1348,10 @@ void processGW(controlStruct *control,int r)
 	  fillDval(&(control->gw[i].gwcsEpoch),control);
 	  fillDval(&(control->gw[i].gwcsWidth),control);
 	}
+      // A source that stays in the same place can share its antenna responses
+      // between realisations (gwResponseGet)
+      control->gw[i].ra.constant = constantValue(control->gw[i].ra.inVal);
+      control->gw[i].dec.constant = constantValue(control->gw[i].dec.inVal);
     }
 
 }
@@ -1229,6 +1366,7 @@ void processBE(controlStruct *control,int r)
       // Evaluate expressions
       fillDval(&(control->be[i].bw),control);
       fillDval(&(control->be[i].nbin),control);
+      fillDval(&(control->be[i].nchan),control);
       for (j=0;j<control->be[i].nOffset;j++)
 	{
 	  fillDval(&(control->be[i].offsetMJD[j]),control);
@@ -1257,33 +1395,26 @@ void processRCVR(controlStruct *control,int r)
 
 void fillDval(valStruct *param,controlStruct *control)
 {
- char expression[1024];
- int errorFlag;
- 
- sprintf(expression,"v = %s",param->inVal);
-
- nVariables = 0;
- errorFlag = runEvaluateExpression(expression,control);
- param->dval = variable[0].value;
+ param->dval = evaluateValue(param->inVal,0,&(control->expr));
 }
 
 
 void createPulsarName(controlStruct *control,int p)
 {
-  char *tok;
+  char *tok,*save;
   int hr,min,deg;
   double sec;
   char psrName1[128],psrName2[128];
 
-  tok = strtok(control->psr[p].rajStr,":");
+  tok = strtok_r(control->psr[p].rajStr,":",&save);
   sscanf(tok,"%d",&hr);
-  tok = strtok(NULL,":");
+  tok = strtok_r(NULL,":",&save);
   sscanf(tok,"%d",&min);
   sprintf(psrName1,"J%02d%02d",hr,min);
 
-  tok = strtok(control->psr[p].decjStr,":");
+  tok = strtok_r(control->psr[p].decjStr,":",&save);
   sscanf(tok,"%d",&deg);
-  tok = strtok(NULL,":");
+  tok = strtok_r(NULL,":",&save);
   sscanf(tok,"%d",&min);
   //  printf("Here with %d %d %02d%02d\n",deg,min,deg,min);
   if (deg < 0)
@@ -1412,6 +1543,7 @@ void readObsRunFromScript(controlStruct *control,FILE *fin)
   paramStruct p[MAX_LINE_PARAMS];
   int np,i,npsr;
   int or=control->nObsRun;
+  GROW_TABLE(control,control->obsRun,control->nObsRunAlloc,or);
   control->obsRun[or].nT2Tim=0;
   control->obsRun[or].setSched=0;
   control->obsRun[or].probFailure.set=0;
@@ -1458,6 +1590,7 @@ void readObsRunFromScript(controlStruct *control,FILE *fin)
 	else if (strcmp(label,"t2tim:")==0)
 	  {
 	    int nt = control->obsRun[or].nT2Tim;
+	    GROW_TABLE(control,control->obsRun[or].T2Tim,control->obsRun[or].nT2TimAlloc,nt);
 	    control->obsRun[or].T2Tim[nt].toaErr.set=0;
 	    control->obsRun[or].T2Tim[nt].efac.set=1;
 	    control->obsRun[or].T2Tim[nt].equad.set=1;
@@ -1505,6 +1638,7 @@ void readRCVRFromScript(controlStruct *control,FILE *fin)
   paramStruct p[MAX_LINE_PARAMS];
   int np,i,npsr;
   int or=control->nRCVR;
+  GROW_TABLE(control,control->rcvr,control->nRCVRAlloc,or);
   do {
     if (fgets(line,1024,fin)==NULL)
       {
@@ -1554,8 +1688,10 @@ void readBEFromScript(controlStruct *control,FILE *fin)
   paramStruct p[MAX_LINE_PARAMS];
   int np,i,npsr;
   int or=control->nBE;
+  GROW_TABLE(control,control->be,control->nBEAlloc,or);
 
   control->be[or].nOffset=0;
+  strcpy(control->be[or].nchan.inVal,"1");
 
   do {
     if (fgets(line,1024,fin)==NULL)
@@ -1580,6 +1716,8 @@ void readBEFromScript(controlStruct *control,FILE *fin)
 	  strcpy(control->be[or].bw.inVal,p[0].v);
 	else if (strcmp(label,"nbin:")==0)
 	  strcpy(control->be[or].nbin.inVal,p[0].v);
+	else if (strcmp(label,"nchan:")==0)
+	  strcpy(control->be[or].nchan.inVal,p[0].v);
 	else if (strcmp(label,"offset:")==0)
 	  {
 	    int nos = control->be[or].nOffset;
@@ -1615,6 +1753,7 @@ void readObsSysFromScript(controlStruct *control,FILE *fin)
   paramStruct p[MAX_LINE_PARAMS];
   int np,i,npsr;
   int or=control->nObsSys;
+  GROW_TABLE(control,control->obsSys,control->nObsSysAlloc,or);
   control->obsSys[or].nSys=0;
 
   do {
@@ -1672,6 +1811,7 @@ void readScheduleFromScript(controlStruct *control,FILE *fin)
   paramStruct p[MAX_LINE_PARAMS];
   int np,i,npsr,j;
   int ns=control->nSched;
+  GROW_TABLE(control,control->sched,control->nSchedAlloc,ns);
   control->sched[ns].nObsSched=0;
   do {
     if (fgets(line,1024,fin)==NULL)
@@ -1707,6 +1847,7 @@ void readScheduleFromScript(controlStruct *control,FILE *fin)
 	    int setHa=-1;
 	    int setOutlier=-1;
 
+	    GROW_TABLE(control,control->sched[ns].obs,control->sched[ns].nObsSchedAlloc,no);
 	    strcpy(efac,"1");
 	    strcpy(equad,"0");
 
@@ -1780,6 +1921,7 @@ void readScheduleFromScript(controlStruct *control,FILE *fin)
 			//			if (setlabel==1)
 			//			  printf("label: in here\n");
 			no = control->sched[ns].nObsSched;
+			GROW_TABLE(control,control->sched[ns].obs,control->sched[ns].nObsSchedAlloc,no);
 			//			strcpy(control->sched[ns].obs[no].psrName,control->psr[i].name);
 			control->sched[ns].obs[no].psrNum = i;
 			strcpy(control->sched[ns].obs[no].toaErr.inVal,toaErr);
@@ -1972,15 +2114,104 @@ void readDefineFromScript(controlStruct *control,FILE *fin)
 	  }	 
 	else if (strcmp(label,"t2exe:")==0)
 	  strcpy(control->t2exe,p[0].v);
+	else if (strcmp(label,"simExe:")==0)
+	  strcpy(control->simExe,p[0].v);
+	else if (strcmp(label,"compose:")==0)
+	  {
+	    if (strcasecmp(p[0].v,"tempo2")==0)
+	      control->composeMode = COMPOSE_TEMPO2;
+	    else if (strcasecmp(p[0].v,"internal")==0)
+	      control->composeMode = COMPOSE_INTERNAL;
+	    else
+	      {
+		printf("Unknown compose mode: %s (use tempo2 or internal)\n",p[0].v);
+		finishOff(control);
+	      }
+	  }
 	else if (strcmp(label,"shell:")==0)
 	  strcpy(control->shell,p[0].v);
 	else if (strcasecmp(label,"shellpth:")==0)
 	  strcpy(control->shellPth,p[0].v);
 	else if (strcmp(label,"nreal:")==0)
 	  sscanf(p[0].v,"%d",&(control->nreal));
+	else if (strcmp(label,"fftPlan:")==0)
+	  {
+	    if (strcasecmp(p[0].v,"estimate")==0)
+	      control->fftPlanFlags = FFTW_ESTIMATE;
+	    else if (strcasecmp(p[0].v,"measure")==0)
+	      control->fftPlanFlags = FFTW_MEASURE;
+	    else if (strcasecmp(p[0].v,"patient")==0)
+	      control->fftPlanFlags = FFTW_PATIENT;
+	    else
+	      {
+		printf("Unknown FFT planning mode: %s (use estimate, measure or patient)\n",p[0].v);
+		finishOff(control);
+	      }
+	  }
+	else if (strcmp(label,"fftThreads:")==0)
+	  sscanf(p[0].v,"%d",&(control->fftThreads));
+	else if (strcmp(label,"nbatch:")==0)
+	  {
+	    sscanf(p[0].v,"%d",&(control->nbatch));
+	    if (control->nbatch < 1)
+	      {
+		printf("nbatch must be at least 1\n");
+		finishOff(control);
+	      }
+	  }
+	else if (strcmp(label,"redNoisePad:")==0)
+	  sscanf(p[0].v,"%d",&(control->redNoisePad));
+	else if (strcmp(label,"radiometer:")==0)
+	  {
+	    if (strcasecmp(p[0].v,"analytic")==0)
+	      control->radiometerMode = RADIOMETER_ANALYTIC;
+	    else if (strcasecmp(p[0].v,"fftfit")==0)
+	      control->radiometerMode = RADIOMETER_FFTFIT;
+	    else
+	      {
+		printf("Unknown radiometer mode: %s (use analytic or fftfit)\n",p[0].v);
+		finishOff(control);
+	      }
+	  }
+	else if (strcmp(label,"gwPrecision:")==0)
+	  {
+	    if (strcasecmp(p[0].v,"long")==0)
+	      control->gwPrecision = GW_PRECISION_LONG;
+	    else if (strcasecmp(p[0].v,"fast")==0)
+	      control->gwPrecision = GW_PRECISION_FAST;
+	    else if (strcasecmp(p[0].v,"check")==0)
+	      control->gwPrecision = GW_PRECISION_CHECK;
+	    else
+	      {
+		printf("Unknown GW precision: %s (use long, fast or check)\n",p[0].v);
+		finishOff(control);
+	      }
+	  }
+	else if (strcmp(label,"dumpProfiles:")==0)
+	  sscanf(p[0].v,"%d",&(control->dumpProfiles));
+	else if (strcmp(label,"wideband:")==0)
+	  {
+	    if (strcasecmp(p[0].v,"off")==0)
+	      control->widebandMode = WIDEBAND_OFF;
+	    else if (strcasecmp(p[0].v,"channels")==0)
+	      control->widebandMode = WIDEBAND_CHANNELS;
+	    else if (strcasecmp(p[0].v,"wideband")==0)
+	      control->widebandMode = WIDEBAND_FIT;
+	    else
+	      {
+		printf("Unknown wideband mode: %s (use off, channels or wideband)\n",p[0].v);
+		finishOff(control);
+	      }
+	  }
+	else if (strcmp(label,"seed:")==0) // Only affects what is read after it
+	  {
+	    sscanf(p[0].v,"%ld",&(control->seed));
+	    setExpressionStream(control,-1,RAN_SCRIPT);
+	  }
 	else if (strcmp(label,"output:")==0)
 	  {
 	    int no = control->nOutput;
+	    GROW_TABLE(control,control->output,control->nOutputAlloc,no);
 	    control->output[no].nAdd=0;
 	    for (i=0;i<np;i++)
 	      strcpy(control->output[no].label[i],p[i].v);
@@ -2115,6 +2346,15 @@ void readT2filesFromScript(controlStruct *control,FILE *fin)
 }
 
 
+// Adds an empty GW definition, with no single source amplitudes
+static void newGW(controlStruct *control)
+{
+  GROW_TABLE(control,control->gw,control->nGWAlloc,control->nGW);
+  strcpy(control->gw[control->nGW].ap.inVal,"0");
+  strcpy(control->gw[control->nGW].ac.inVal,"0");
+  control->gw[control->nGW].nspan = 10;
+}
+
 void readAdditionsFromScript(controlStruct *control,FILE *fin)
 {
   int endit=0;
@@ -2143,17 +2383,38 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 	np = getParams(trimLine,label,p);
 	if (strcmp(label,"gwb:")==0)
 	  {
+	    newGW(control);
 	    control->gw[control->nGW].type=1;
 	    strcpy(control->gw[control->nGW].alpha.inVal,"-0.666666");
 	    for (i=0;i<np;i++)
 	      {
 		if (strcmp(p[i].l,"amp")==0)
 		  strcpy(control->gw[control->nGW].amp.inVal,p[i].v);
+		else if (strcmp(p[i].l,"nfreq")==0) // Type = 7 - Fourier basis with Hellings & Downs correlations
+		  {
+		    if (sscanf(p[i].v,"%d",&(control->gw[control->nGW].nfreq))!=1 || control->gw[control->nGW].nfreq < 1)
+		      {
+			printf("nfreq for the GWB must be a positive integer: %s\n",p[i].v);
+			finishOff(control);
+		      }
+		    control->gw[control->nGW].type=7;
+		  }
+		else if (strcmp(p[i].l,"nspan")==0)
+		  {
+		    if (sscanf(p[i].v,"%lf",&(control->gw[control->nGW].nspan))!=1 || control->gw[control->nGW].nspan <= 0)
+		      {
+			printf("nspan for the GWB must be positive: %s\n",p[i].v);
+			finishOff(control);
+		      }
+		  }
+		else if (strcmp(p[i].l,"cache")==0) // Indexed file of the GW sources of each realisation
+		  strcpy(control->gw[control->nGW].fname,p[i].v);
 	      }	    
 	    (control->nGW)++;
 	  }
 	else if (strcmp(label,"gwsingle:")==0)
 	  {
+	    newGW(control);
 	    control->gw[control->nGW].type=2;
 	    for (i=0;i<np;i++)
 	      {
@@ -2244,6 +2505,7 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 	    char idLabel[1024];
 	    int setIDlabel=0;
 
+	    GROW_TABLE(control,control->tnoise,control->nTnoiseAlloc,nt);
 	    strcpy(beta,"0");
 
 	    for (i=0;i<np;i++)
@@ -2276,6 +2538,7 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 		    if (setlabel==0 || strcmp(control->psr[i].label,label)==0)
 		      {
 			nt = control->nTnoise;
+			GROW_TABLE(control,control->tnoise,control->nTnoiseAlloc,nt);
 			if (setIDlabel==0)
 			  strcpy(control->tnoise[nt].label,"UNSET");
 			else
@@ -2320,7 +2583,7 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 	    int setIDlabel=0;
 	    int setlabel=0;
 
-
+	    GROW_TABLE(control,control->planets,control->nPlanetsAlloc,npl);
 	    for (i=0;i<np;i++)
 	      {
 		printf("planets: test %s %s\n",p[i].l,p[i].v);
@@ -2349,6 +2612,7 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 		    if (setlabel==0 || strcmp(control->psr[i].label,label)==0)
 		      {
 			npl = control->nPlanets;
+			GROW_TABLE(control,control->planets,control->nPlanetsAlloc,npl);
 			if (setIDlabel==0)
 			  strcpy(control->planets[npl].label,"UNSET");
 			else
@@ -2400,6 +2664,7 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 	    char label[1024];
 	    int setlabel=0;
 
+	    GROW_TABLE(control,control->glitches,control->nGlitchesAlloc,ng);
 	    for (i=0;i<np;i++)
 	      {
 		if (strcmp(p[i].l,"psr")==0)
@@ -2427,6 +2692,7 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 		    if (setlabel==0 || strcmp(control->psr[i].label,label)==0)
 		      {
 			ng = control->nGlitches;
+			GROW_TABLE(control,control->glitches,control->nGlitchesAlloc,ng);
 			control->glitches[ng].psrNum = i;
 			if (setGlep==1)
 			  {
@@ -2549,6 +2815,7 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 	    char label[1024];
 	    int setlabel=0;
 
+	    GROW_TABLE(control,control->dmVar,control->nDMvarAlloc,ndm);
 	    for (i=0;i<np;i++)
 	      {
 		if (strcmp(p[i].l,"psr")==0)
@@ -2577,6 +2844,7 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 		    if (setlabel==0 || strcmp(control->psr[i].label,label)==0)
 		      {
 			ndm = control->nDMvar;
+			GROW_TABLE(control,control->dmVar,control->nDMvarAlloc,ndm);
 			control->dmVar[ndm].psrNum = i;
 			if (setD==1)
 			  {
@@ -2612,6 +2880,7 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 	    char label[1024];
 	    int setlabel=0;
 
+	    GROW_TABLE(control,control->dmCovar,control->nDMcovarAlloc,ndm);
 	    for (i=0;i<np;i++)
 	      {
 		if (strcmp(p[i].l,"psr")==0)
@@ -2632,6 +2901,7 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 		    if (setlabel==0 || strcmp(control->psr[i].label,label)==0)
 		      {
 			ndm = control->nDMcovar;
+			GROW_TABLE(control,control->dmCovar,control->nDMcovarAlloc,ndm);
 			control->dmCovar[ndm].psrNum = i;
 			strcpy(control->dmCovar[ndm].alpha.inVal,alpha);
 			strcpy(control->dmCovar[ndm].a.inVal,a);
@@ -2667,6 +2937,7 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 	    char label[1024];
 	    int setlabel=0;
 
+	    GROW_TABLE(control,control->dmFunc,control->nDMfuncAlloc,ndm);
 	    for (i=0;i<np;i++)
 	      {
 		if (strcmp(p[i].l,"psr")==0)
@@ -2683,6 +2954,7 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 		    if (setlabel==0 || strcmp(control->psr[i].label,label)==0)
 		      {
 			ndm = control->nDMfunc;
+			GROW_TABLE(control,control->dmFunc,control->nDMfuncAlloc,ndm);
 			control->dmFunc[ndm].psrNum = i;
 			strcpy(control->dmFunc[ndm].ddm.inVal,ddm);
  			(control->nDMfunc)++;
@@ -2710,6 +2982,7 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 	    char label[1024];
 	    int setlabel=0;
 
+	    GROW_TABLE(control,control->jitter,control->nJitterAlloc,nJitter);
 	    for (i=0;i<np;i++)
 	      {
 		if (strcmp(p[i].l,"psr")==0)
@@ -2738,6 +3011,7 @@ void readAdditionsFromScript(controlStruct *control,FILE *fin)
 		    if (setlabel==0 || strcmp(control->psr[i].label,label)==0)
 		      {
 			nJitter = control->nJitter;
+			GROW_TABLE(control,control->jitter,control->nJitterAlloc,nJitter);
 			control->jitter[nJitter].psrNum = i;
 			if (setSJ==1)
 			  {
@@ -2810,6 +3084,7 @@ void readPulsarsFromScript(controlStruct *control,FILE *fin)
 	printf("processing: %s\n",label);
 	if (strcmp(label,"psr:")==0)
 	  {
+	    GROW_TABLE(control,control->psr,control->npsrAlloc,control->npsr);
 	    for (i=0;i<np;i++)
 	      {
 		printf("... %s\n",p[i].l);
@@ -2903,6 +3178,7 @@ void readPulsarsFromScript(controlStruct *control,FILE *fin)
 	  }
 	else if (strcmp(label,"ephem:")==0)
 	  {
+	    GROW_TABLE(control,control->psr,control->npsrAlloc,control->npsr);
 	    for (i=0;i<np;i++)
 	      {
 		if (strcmp(p[i].l,"name")==0){
@@ -2933,6 +3209,7 @@ void readPulsarsFromScript(controlStruct *control,FILE *fin)
 	    for (j=0;j<npsrReq;j++)
 	      {
 		npsr = control->npsr;
+		GROW_TABLE(control,control->psr,control->npsrAlloc,npsr);
 		for (i=0;i<np;i++)
 		  {
 		    if (strcmp(p[i].l,"name")==0)
@@ -2960,6 +3237,7 @@ void readPulsarsFromScript(controlStruct *control,FILE *fin)
 
 			    int notGood,ii;
 			    double cval;
+			    TKstream stream;
 
 			    strcpy(t,p[i].v);
 			    // Get parameters
@@ -2970,9 +3248,10 @@ void readPulsarsFromScript(controlStruct *control,FILE *fin)
 				inp++;
 			      }
 			    //			    printf("Have %d parameters\n",inp);
+			    TKstreamInit(&stream,control->seed,-1,npsr,RAN_POSITION,0);
 			    do {
-			      theta = (acos((TKranDev(&(control->seed))-0.5)*2)-M_PI/2.0)/(2.0*M_PI);
-			      phi = TKranDev(&(control->seed));
+			      theta = (acos((TKstreamRanDev(&stream)-0.5)*2)-M_PI/2.0)/(2.0*M_PI);
+			      phi = TKstreamRanDev(&stream);
 			      notGood=0;
 			      for (ii=0;ii<inp;ii++)
 				{
@@ -3091,6 +3370,8 @@ void initialisePulsar(psrStruct *psr)
 
 }
 
+// Allocates the observation table for each pulsar. Every copy of control
+// that creates realisations needs its own table
 int getParams(char *line,char *label,paramStruct *p)
 {
   char *tok;
@@ -3130,12 +3411,60 @@ int getParams(char *line,char *label,paramStruct *p)
 
 void loadInputs(controlStruct *control,int argc,char *argv[])
 {
-  if (argc!=2)
+  int i;
+  int setScript=0;
+  char *exe;
+
+  // The scripts run this executable for 'compose: internal'
+  if (strchr(argv[0],'/') && (exe = realpath(argv[0],NULL)))
     {
-      printf("Usage: ptaSimulate scriptName\n");
+      snprintf(control->simExe,MAX_STRLEN,"%s",exe);
+      free(exe);
+    }
+  for (i=1;i<argc;i++)
+    {
+      if (strcmp(argv[i],"--threads")==0 && i+1 < argc)
+	{
+	  if (sscanf(argv[++i],"%d",&(control->nthreads))!=1 || control->nthreads < 1)
+	    {
+	      printf("Number of threads must be a positive integer: %s\n",argv[i]);
+	      finishOff(control);
+	    }
+	}
+      else if (strcmp(argv[i],"--compose")==0 && i+1 < argc)
+	{
+	  // Make the simulated tim files listed by makeRealScript and stop
+	  composeRealisations(argv[i+1]);
+	  free(control);
+	  exit(0);
+	}
+      else if (strcmp(argv[i],"--convert-cw")==0 && i+2 < argc)
+	{
+	  // Convert a text GW source list to a binary catalogue and stop
+	  cwCatalogueConvert(argv[i+1],argv[i+2]);
+	  free(control);
+	  exit(0);
+	}
+      else if (strcmp(argv[i],"--seed")==0 && i+1 < argc)
+	{
+	  sscanf(argv[++i],"%ld",&(control->seed));
+	  setExpressionStream(control,-1,RAN_SCRIPT);
+	}
+      else if (setScript==0)
+	{
+	  strcpy(control->inputScript,argv[i]);
+	  setScript=1;
+	}
+      else
+	setScript=-1;
+    }
+  if (setScript!=1)
+    {
+      printf("Usage: ptaSimulate [--threads N] [--seed S] scriptName\n");
+      printf("       ptaSimulate --convert-cw sourceList.txt catalogue.bin\n");
+      printf("       ptaSimulate --compose psr.compose\n");
       finishOff(control);
     }
-  strcpy(control->inputScript,argv[1]);
 }
 
 void finishOff(controlStruct *control)
@@ -3146,8 +3475,10 @@ void finishOff(controlStruct *control)
 
 void initialiseControl(controlStruct *control)
 {
-  int i;
+  memset(control,0,sizeof(controlStruct)); // The tables start empty
+  arenaInit(&(control->scratch),0);
   control->nCut=0;
+  GROW_TABLE(control,control->output,control->nOutputAlloc,0);
   control->nOutput=1;
   strcpy(control->output[0].label[0],"DEFAULT");
   control->output[0].nAdd=1;
@@ -3166,15 +3497,20 @@ void initialiseControl(controlStruct *control)
   control->nDMcovar=0;
   control->nDMfunc=0;
   control->nJitter=0;
-  control->seed = TKsetSeed();
+  control->seed = -TKsetSeed(); // Clock based unless set by the user
+  setExpressionStream(control,-1,RAN_SCRIPT);
   control->nreal = 1;
+  control->nthreads = 1;
+  control->nbatch = 1;
+  control->redNoisePad = REDNOISE_PAD;
+  control->fftPlanFlags = FFTW_ESTIMATE;
+  control->fftThreads = 1;
+  control->radiometerMode = RADIOMETER_ANALYTIC;
+  control->gwPrecision = GW_PRECISION_LONG;
+  control->dumpProfiles = 0;
+  control->widebandMode = WIDEBAND_OFF;
   control->minT = 99999;
   control->maxT = 0;
-  for (i=0;i<MAX_GWS;i++)
-    {
-      strcpy(control->gw[i].ap.inVal,"0");
-      strcpy(control->gw[i].ac.inVal,"0");
-    }
   strcpy(control->simEphem,"DE421");
   strcpy(control->useEphem,"DE421");
   control->simTypeEphem = 1;
@@ -3185,6 +3521,8 @@ void initialiseControl(controlStruct *control)
   strcpy(control->simEOP,"/earth/eopc04_IAU2000.62-now");
   strcpy(control->useEOP,"/earth/eopc04_IAU2000.62-now");
   strcpy(control->t2exe,"tempo2");
+  strcpy(control->simExe,"ptaSimulate");
+  control->composeMode = COMPOSE_TEMPO2;
   strcpy(control->shell,"tcsh");
   strcpy(control->shellPth,"/usr/bin/");
   strcpy(control->useSWM,"DEFAULT");
@@ -3293,7 +3631,8 @@ void createDirectoryStructure(controlStruct *control)
 {
   char resDir[MAX_STRLEN];
   char dir[MAX_STRLEN];
-  int i,j,k;
+  char realDir[MAX_STRLEN];
+  int i,j,k,b;
   FILE *fout;
 
   // Make filenames for output directories
@@ -3327,13 +3666,19 @@ void createDirectoryStructure(controlStruct *control)
   printf("Creating directory 2\n");
   for (i=0;i<control->nreal;i++)
     {
-      sprintf(dir,"%s/output/real_%d",resDir,i);
-      mkdir(dir,0700);
-      
-      for (j=1;j<control->nOutput;j++)
+      for (b=0;b<control->nbatch;b++)
 	{
-	  sprintf(dir,"%s/output/real_%d/%s",resDir,i,control->output[j].fname);
-	  mkdir(dir,0700);
+	  if (control->nbatch==1)
+	    sprintf(realDir,"%s/output/real_%d",resDir,i);
+	  else
+	    sprintf(realDir,"%s/output/real_%d_%d",resDir,i,b);
+	  mkdir(realDir,0700);
+      
+	  for (j=1;j<control->nOutput;j++)
+	    {
+	      sprintf(dir,"%s/%s",realDir,control->output[j].fname);
+	      mkdir(dir,0700);
+	    }
 	}
     }
   printf("Creating directory 3\n");
@@ -3362,6 +3707,7 @@ void createDirectoryStructure(controlStruct *control)
 void createDMvar(controlStruct *control,int r)
 {
   int i,nit,j,p;
+  TKstream stream;
   char fname[MAX_STRLEN];
   double globalParameter;
   long double result;
@@ -3383,8 +3729,9 @@ void createDMvar(controlStruct *control,int r)
   toasim_header_t* header;
   toasim_header_t* read_header;
   FILE* file;
-  double offsets[MAX_TOAS]; // Will change to doubles - should use malloc
-  double dms[MAX_TOAS]; // Will change to doubles - should use malloc
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  double *offsets = (double *)toaScratch(control,sizeof(double));
+  double *dms = (double *)toaScratch(control,sizeof(double));
   // Create a set of corrections.
   toasim_corrections_t* corr = (toasim_corrections_t*)malloc(sizeof(toasim_corrections_t));
   float beta=0;
@@ -3397,7 +3744,7 @@ void createDMvar(controlStruct *control,int r)
   corr->a1=0; // a1*x
   corr->a2=0; // a2*x*X
   
-  nit = 1;
+  nit = control->nbatch;
 
   for (dd=0;dd<control->nDMvar;dd++)
     {
@@ -3431,8 +3778,8 @@ void createDMvar(controlStruct *control,int r)
       double mjd_end=-10000000.0;
       for (j=0;j<control->psr[p].nToAs;j++){
 	// find the start and end times
-	if(control->psr[p].obs[j].sat < mjd_start)mjd_start=(double)control->psr[p].obs[j].sat;
-	if(control->psr[p].obs[j].sat > mjd_end)mjd_end=(double)control->psr[p].obs[j].sat;
+	if(epochMJD(control->psr[p].toa.sat[j]) < mjd_start)mjd_start=epochMJD(control->psr[p].toa.sat[j]);
+	if(epochMJD(control->psr[p].toa.sat[j]) > mjd_end)mjd_end=epochMJD(control->psr[p].toa.sat[j]);
       }
       
       
@@ -3461,8 +3808,11 @@ void createDMvar(controlStruct *control,int r)
       printf("\n");
       printf("Generating red noise...\n");
       
+      npts = redNoiseNpt(mjd_start,mjd_end,observationCadence(control,p));
       rednoisemodel_t* model = setupRedNoiseModel(mjd_start,mjd_end,npts,nit,pism,alpha,beta);
-      populateRedNoiseModel(model,&(control->seed));
+      model->pad = control->redNoisePad;
+      TKstreamInit(&stream,control->seed,r,p,RAN_DMVAR+dd,0);
+      populateRedNoiseModel(model,&stream);
             
       int itjmp=nit/50;
       if (itjmp<1)itjmp=1;
@@ -3488,7 +3838,7 @@ void createDMvar(controlStruct *control,int r)
 	  }
 	  
 	  for (j=0;j<control->psr[p].nToAs;j++){
-	    double t = (double)(control->psr[p].obs[j].sat);
+	    double t = epochMJD(control->psr[p].toa.sat[j]);
 	    if(t > lastMJD)t=lastMJD;
 	    dms[j]=getRedNoiseValue(model,t,i);
 	  }
@@ -3501,13 +3851,14 @@ void createDMvar(controlStruct *control,int r)
 	  int mm=-1;
 	  for (j=0;j<control->psr[p].nToAs;j++){
 	    dms[j]-=sum;
-	    double ofreq=control->psr[p].obs[j].freq.dval*1e6;
+	    double ofreq=control->psr[p].toa.freq[j]*1e6;
 	    offsets[j] = (double)(dms[j]/DM_CONST/ofreq/ofreq)*1e12;
 	  }
 	  toasim_write_corrections(corr,header,file);
 	}
       fclose(file);
     }
+  arenaRelease(&(control->scratch),mark);
   free(corr);
 }
 
@@ -3526,7 +3877,8 @@ void createBEoffsets(controlStruct *control,int r)
   toasim_header_t* header;
   toasim_header_t* read_header;
   FILE* file;
-  double *offsets; // Will change to doubles - should use malloc
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  double *offsets = (double *)toaScratch(control,sizeof(double));
   // Create a set of corrections.
   toasim_corrections_t* corr = (toasim_corrections_t*)malloc(sizeof(toasim_corrections_t));
 
@@ -3534,8 +3886,6 @@ void createBEoffsets(controlStruct *control,int r)
   int k;
   int beNum;
 
-  offsets = (double *)malloc(sizeof(double)*MAX_TOAS);
-
   corr->offsets=offsets;
   corr->params=""; // Normally leave as NULL. Can store this along with each realisation. 
   // Same length string in every iteration - defined in r_param_length see below
@@ -3543,7 +3893,7 @@ void createBEoffsets(controlStruct *control,int r)
   corr->a1=0; // a1*x
   corr->a2=0; // a2*x*X
   
-  nit = 1;
+  nit = control->nbatch;
   printf("ABC\n");
   for (p=0;p<control->npsr;p++)
     {
@@ -3571,27 +3921,31 @@ void createBEoffsets(controlStruct *control,int r)
       file = toasim_write_header(header,fname);
       printf("noffsets = %d\n",control->be[beNum].nOffset);
       for (j=0;j<control->psr[p].nToAs;j++){
-	beNum = control->psr[p].obs[j].beNum;
+	beNum = control->psr[p].toa.beNum[j];
 	offsets[j]=0.0;
 	for (k=0;k<control->be[beNum].nOffset;k++)
 	  {
-	    if (control->be[beNum].offsetMJD[k].dval < control->psr[p].obs[j].sat)
+	    if (control->be[beNum].offsetMJD[k].dval < epochMJD(control->psr[p].toa.sat[j]))
 	      offsets[j] = control->be[beNum].offsetVal[k].dval;
 	  }
       }
       printf("Writing corrections\n");
-      toasim_write_corrections(corr,header,file);
+      // The offsets are the same in every realisation
+      for (i=0;i<nit;i++)
+	toasim_write_corrections(corr,header,file);
     
       fclose(file);
     }
   printf("Complete create BE\n");
-  free(offsets);
+  arenaRelease(&(control->scratch),mark);
   free(corr);
 }
 
 void createDMcovar(controlStruct *control,int r)
 {
   int i,nit,j,p;
+  TKstream stream;
+  double *gauss;
   char fname[MAX_STRLEN];
   double globalParameter;
   long double result;
@@ -3610,21 +3964,20 @@ void createDMcovar(controlStruct *control,int r)
   toasim_header_t* header;
   toasim_header_t* read_header;
   FILE* file;
-  double offsets[MAX_TOAS]; // Will change to doubles - should use malloc
-  double dms[MAX_TOAS]; // Will change to doubles - should use malloc
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  double *offsets = (double *)toaScratch(control,sizeof(double));
+  double *dms = (double *)toaScratch(control,sizeof(double));
   // Create a set of corrections.
   toasim_corrections_t* corr = (toasim_corrections_t*)malloc(sizeof(toasim_corrections_t));
 
   int dd;
   //  double *covar,x;
   double x;
-  int ndays;
+  int ndays,nfft;
   fftwf_complex *covar;
   fftwf_complex *out;
   fftwf_complex *spectrum;
   fftwf_complex *data;
-  fftw_plan plan;
-  fftwf_plan planf;
   double scale;
 
   corr->offsets=offsets;
@@ -3634,7 +3987,7 @@ void createDMcovar(controlStruct *control,int r)
   corr->a1=0; // a1*x
   corr->a2=0; // a2*x*X
   
-  nit = 1;
+  nit = control->nbatch;
 
   for (dd=0;dd<control->nDMcovar;dd++)
     {
@@ -3668,16 +4021,20 @@ void createDMcovar(controlStruct *control,int r)
       double mjd_end=-10000000.0;
       for (j=0;j<control->psr[p].nToAs;j++){
 	// find the start and end times
-	if(control->psr[p].obs[j].sat < mjd_start)mjd_start=(double)control->psr[p].obs[j].sat;
-	if(control->psr[p].obs[j].sat > mjd_end)mjd_end=(double)control->psr[p].obs[j].sat;
+	if(epochMJD(control->psr[p].toa.sat[j]) < mjd_start)mjd_start=epochMJD(control->psr[p].toa.sat[j]);
+	if(epochMJD(control->psr[p].toa.sat[j]) > mjd_end)mjd_end=epochMJD(control->psr[p].toa.sat[j]);
       }
       
       ndays=ceil((mjd_end-mjd_start)+1e-10);
+      // The covariance is embedded in a circulant of length at least
+      // 2*ndays+1, rounded up to a length that FFTW transforms quickly
+      nfft=smoothFFTLength(2*ndays+1);
       //      covar=(double*)malloc(sizeof(double)*(ndays+1)*2);
-      covar = (fftwf_complex*) fftwf_malloc((2*ndays+1)*sizeof(fftwf_complex));
-      out = (fftwf_complex*) fftwf_malloc((2*ndays+1)*sizeof(fftwf_complex));
-      spectrum = (fftwf_complex*) fftwf_malloc((2*ndays+1)*sizeof(fftwf_complex));
-      data = (fftwf_complex*) fftwf_malloc((2*ndays+1)*sizeof(fftwf_complex));
+      covar = (fftwf_complex*) fftwf_malloc(nfft*sizeof(fftwf_complex));
+      out = (fftwf_complex*) fftwf_malloc(nfft*sizeof(fftwf_complex));
+      // One time series for each realisation in the file
+      spectrum = (fftwf_complex*) fftwf_malloc(nit*nfft*sizeof(fftwf_complex));
+      data = (fftwf_complex*) fftwf_malloc(nit*nfft*sizeof(fftwf_complex));
       //     out=fftw_malloc(sizeof(fftw_complex)*ndays);
       //      printf("start    = %f (mjd)\n",mjd_start);
       //      printf("end      = %f (mjd)\n",mjd_end  );
@@ -3688,24 +4045,17 @@ void createDMcovar(controlStruct *control,int r)
       
       
       // Form the covariance function
-      for (i=0; i <= ndays; i++){
-	x = (i+1e-10);
+      for (i=0; i < nfft; i++){
+	x = ((i <= nfft-i) ? i : nfft-i)+1e-10;
 	covar[i][0]=a*exp(-pow(x/b,alpha));
 	covar[i][1]=0;
       }
-      for (i=ndays+1;i<=2*ndays;i++)
-	{
-	  covar[i][0]=covar[2*ndays+1-i][0];
-	  covar[i][1]=0;
-	}
       //      plan = fftw_plan_dft_r2c_1d(ndays*2+1,covar,out,FFTW_ESTIMATE);
-      planf = fftwf_plan_dft_1d(ndays*2+1,covar,out,FFTW_FORWARD,FFTW_ESTIMATE);
-      fftwf_execute(planf);
-      for (i=0;i<ndays*2;i++)
+      fftCacheDFT_f(nfft,covar,out,FFTW_FORWARD);
+      for (i=0;i<nfft-1;i++)
 	{
 	  printf("fft: %d %g %g %g\n",i,out[i][0],out[i][1],covar[i][0]);
 	}
-      fftwf_destroy_plan(planf);
       //      exit(1);
       // Checking with an inverse
       //      planf=fftwf_plan_dft_1d(ndays*2+1,out,covar,FFTW_BACKWARD,FFTW_ESTIMATE);
@@ -3717,25 +4067,28 @@ void createDMcovar(controlStruct *control,int r)
       //      exit(1);
       spectrum[0][0]=0;
       spectrum[0][1]=0;
+      TKstreamInit(&stream,control->seed,r,p,RAN_DMCOVAR+dd,0);
+      gauss = (double *)malloc(sizeof(double)*2*nfft*nit);
+      TKgaussDevFill(&stream,gauss,2*nfft*nit);
 
-      for (i=0;i<2*ndays+1;i++)
+      for (i=0;i<nfft*nit;i++)
 	{
-	  scale = sqrt(fabs(out[i][0]))/(double)(sqrt(2*ndays+1));
+	  scale = sqrt(fabs(out[i%nfft][0]))/(double)(sqrt(nfft));
 	  //	  scale=1;
-	  spectrum[i][0] = (scale*TKgaussDev(&(control->seed)));
-      	  spectrum[i][1] = (scale*TKgaussDev(&(control->seed)));
-	  printf("spectrum %d %g %g\n",i,spectrum[i][0],spectrum[i][1]);
+	  spectrum[i][0] = (scale*gauss[2*i]);
+      	  spectrum[i][1] = (scale*gauss[2*i+1]);
+	  if (i<nfft)
+	    printf("spectrum %d %g %g\n",i,spectrum[i][0],spectrum[i][1]);
 	}
-      planf=fftwf_plan_dft_1d(2*ndays+1,spectrum,data,FFTW_BACKWARD,FFTW_ESTIMATE);
-      fftwf_execute(planf);
+      fftCacheDFT_many_f(nfft,nit,spectrum,data,FFTW_BACKWARD);
 
-      for (i=0;i<2*ndays+1;i++)
+      for (i=0;i<nfft;i++)
 	printf("tseries: %d %g %g\n",i,data[i][0],data[i][1]);
 
       printf("A\n");
-      fftwf_destroy_plan(planf);
       printf("B\n");
       fftwf_free(spectrum);
+      free(gauss);
       printf("C\n");
       //      free(data);
       printf("D\n");
@@ -3756,7 +4109,7 @@ void createDMcovar(controlStruct *control,int r)
 	      printf("Generating red noise...\n");
 	      
 	      rednoisemodel_t* model = setupRedNoiseModel(mjd_start,mjd_end,npts,nit,pism,alpha);
-	      populateRedNoiseModel(model,&(control->seed));
+	      populateRedNoiseModel(model,&stream);
 	      
 	      int itjmp=nit/50;
 	      if (itjmp<1)itjmp=1;
@@ -3772,10 +4125,10 @@ void createDMcovar(controlStruct *control,int r)
       for (i=0;i<nit;i++)
 	{ 	     	  
 	  for (j=0;j<control->psr[p].nToAs;j++){
-	    double t = (double)(control->psr[p].obs[j].sat);
+	    double t = epochMJD(control->psr[p].toa.sat[j]);
 	    if(t > lastMJD)t=lastMJD;
 	    //	    dms[j]=getRedNoiseValue(model,t,i);
-	    dms[j]=data[(int)(t-mjd_start)][0];
+	    dms[j]=data[i*nfft+(int)(t-mjd_start)][0];
 	  }
 	  FILE *log_ts;
 	  double sum=0;
@@ -3786,15 +4139,18 @@ void createDMcovar(controlStruct *control,int r)
 	  int mm=-1;
 	  for (j=0;j<control->psr[p].nToAs;j++){
 	    dms[j]-=sum;
-	    double ofreq=control->psr[p].obs[j].freq.dval*1e6;
+	    double ofreq=control->psr[p].toa.freq[j]*1e6;
 	    offsets[j] = (double)(dms[j]/DM_CONST/ofreq/ofreq)*1e12;
 	  }
 	  toasim_write_corrections(corr,header,file);
 	} 
-      free(covar);
+      fftwf_free(covar);
+      fftwf_free(out);
+      fftwf_free(data);
       
       fclose(file);
     }
+  arenaRelease(&(control->scratch),mark);
   free(corr);
 }
 
@@ -3805,9 +4161,6 @@ void createDMfunc(controlStruct *control,int r)
   double globalParameter;
   long double result;
   double res;
-  char expression[1024];
-  char expression1[1024];
-  int errorFlag=0;
 
   double secperyear=365*86400.0;
   double ofreq;
@@ -3818,8 +4171,9 @@ void createDMfunc(controlStruct *control,int r)
   toasim_header_t* header;
   toasim_header_t* read_header;
   FILE* file;
-  double offsets[MAX_TOAS]; // Will change to doubles - should use malloc
-  double dms[MAX_TOAS]; // Will change to doubles - should use malloc
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  double *offsets = (double *)toaScratch(control,sizeof(double));
+  double *epochs = (double *)toaScratch(control,sizeof(double));
   // Create a set of corrections.
   toasim_corrections_t* corr = (toasim_corrections_t*)malloc(sizeof(toasim_corrections_t));
   char name[1024];
@@ -3831,7 +4185,7 @@ void createDMfunc(controlStruct *control,int r)
   corr->a1=0; // a1*x
   corr->a2=0; // a2*x*X
   
-  nit = 1;
+  nit = control->nbatch;
 
   for (dd=0;dd<control->nDMfunc;dd++)
     {
@@ -3857,43 +4211,72 @@ void createDMfunc(controlStruct *control,int r)
       sprintf(fname,"%s/workFiles/real_%d/%s.dmfunc.%d",control->name,r,control->psr[control->dmFunc[dd].psrNum].name,dd);
       // First we write the header...
       file = toasim_write_header(header,fname);
+      for (j=0;j<control->psr[p].nToAs;j++)
+	epochs[j] = epochMJD(control->psr[p].toa.sat[j]);
       
       for (i=0;i<nit;i++)
 	{ 	     	  
-	  strcpy(expression1,control->dmFunc[dd].ddm.inVal);
-	  changeRandomOnce(expression1,control);
+	  // Any ranOnce() values are drawn afresh for each realisation
+	  evaluateValueArray(control->dmFunc[dd].ddm.inVal,epochs,offsets,control->psr[p].nToAs,&(control->expr));
 	  for (j=0;j<control->psr[p].nToAs;j++){
-	    sprintf(expression,"x=%g; v=%s;",(double)control->psr[p].obs[j].sat,expression1);
-	    errorFlag = runEvaluateExpression(expression,control);      
-	    res = variable[0].value;
-	    printf("dmfunc: %g %g\n",(double)control->psr[p].obs[j].sat,res);
-	    ofreq=control->psr[p].obs[j].freq.dval*1e6;
+	    res = offsets[j];
+	    ofreq=control->psr[p].toa.freq[j]*1e6;
 	    offsets[j] = (double)(res/DM_CONST/ofreq/ofreq)*1e12;
 	  }
 	  toasim_write_corrections(corr,header,file);
 	} 
       fclose(file);
     }
+  arenaRelease(&(control->scratch),mark);
   free(corr);
 }
 
+// Mean spacing (days) between the observations of pulsar p, or the
+// smallest such spacing over all the pulsars if p = -1. Returns 0 if there
+// are not enough observations
+double observationCadence(controlStruct *control,int p)
+{
+  int i,j,p0,p1;
+  toaEpoch first,last;
+  double cadence,best=0;
+
+  p0 = (p==-1) ? 0 : p;
+  p1 = (p==-1) ? control->npsr : p+1;
+  for (i=p0;i<p1;i++)
+    {
+      if (control->psr[i].nToAs < 2) continue;
+      first = last = control->psr[i].toa.sat[0];
+      for (j=1;j<control->psr[i].nToAs;j++)
+	{
+	  if (epochBefore(control->psr[i].toa.sat[j],first)) first = control->psr[i].toa.sat[j];
+	  if (epochBefore(last,control->psr[i].toa.sat[j])) last = control->psr[i].toa.sat[j];
+	}
+      cadence = epochSeconds(last,first)/86400.0/(control->psr[i].nToAs-1);
+      if (cadence > 0 && (best==0 || cadence < best))
+	best = cadence;
+    }
+  return best;
+}
+
 void createTnoise(controlStruct *control,int r)
 {
   int p,i,j;
+  TKstream stream;
   FILE *file;
   int npts=1024;
   char fname[MAX_STRLEN];
   toasim_header_t* header;
   toasim_header_t* read_header;
-  double offsets[MAX_TOAS]; // should use malloc
-  double mjds[MAX_TOAS]; //  should use malloc
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  double *offsets = (double *)toaScratch(control,sizeof(double));
+  double *mjds = (double *)toaScratch(control,sizeof(double));
   // Create a set of corrections.
   toasim_corrections_t* corr = (toasim_corrections_t*)malloc(sizeof(toasim_corrections_t));
   char name[MAX_STRLEN];
   float cnr_cut=0;
   float cnr_flat=0;
   float old_fc=-1;
-  int nit=1;
+  int nit=control->nbatch;
   double alpha,beta;
   float p_1yr=-1; // s^2 yr
   double secperyear = 86400.0*365.25;
@@ -3936,7 +4319,7 @@ void createTnoise(controlStruct *control,int r)
       header->seed = control->seed;
       
       header->ntoa = control->psr[p].nToAs;
-      header->nrealisations = 1;
+      header->nrealisations = nit;
       
       // First we write the header...
       sprintf(fname,"%s/workFiles/real_%d/%s.tnoise.%d",control->name,r,control->psr[control->tnoise[t].psrNum].name,t);
@@ -3946,12 +4329,15 @@ void createTnoise(controlStruct *control,int r)
       double mjd_end=(double)control->maxT;
       
       printf("Setting up the rednoise model %g %g\n",mjd_start,mjd_end);
+      npts = redNoiseNpt(mjd_start,mjd_end,observationCadence(control,control->tnoise[t].psrNum));
       model = setupRedNoiseModel(mjd_start,mjd_end,npts,nit,p_1yr,alpha,beta);
+      model->pad = control->redNoisePad;
       model->cutoff=cnr_cut;
       model->flatten=cnr_flat;
       if(old_fc>0)
 	model->mode=MODE_T2CHOL;
-      populateRedNoiseModel(model,&(control->seed));
+      TKstreamInit(&stream,control->seed,r,control->tnoise[t].psrNum,RAN_TNOISE+t,0);
+      populateRedNoiseModel(model,&stream);
       
       int itjmp=nit/50;
       if (itjmp<1)itjmp=1;
@@ -3977,8 +4363,8 @@ void createTnoise(controlStruct *control,int r)
 	  }
 	  
 	  for (j=0;j<control->psr[p].nToAs;j++){
-	    offsets[j]=getRedNoiseValue(model,control->psr[p].obs[j].sat,i);
-	    printf("rednoise1 offsets = %g %g\n",offsets[j],(double)control->psr[p].obs[j].sat);
+	    offsets[j]=getRedNoiseValue(model,epochMJD(control->psr[p].toa.sat[j]),i);
+	    printf("rednoise1 offsets = %g %g\n",offsets[j],epochMJD(control->psr[p].toa.sat[j]));
 	  }
 	  //	  exit(1);
 	  FILE *log_ts;
@@ -3988,7 +4374,7 @@ void createTnoise(controlStruct *control,int r)
 	  }
 	  sum/=control->psr[p].nToAs;
 	  for (j=0;j<control->psr[p].nToAs;j++){
-	    mjds[j]=(double)control->psr[p].obs[j].sat;
+	    mjds[j]=epochMJD(control->psr[p].toa.sat[j]);
 	    offsets[j]-=sum;
 	  }
 	  TKremovePoly_d(mjds,offsets,control->psr[p].nToAs,2); // remove a quadratic to reduce the chances of phase wraps
@@ -4012,19 +4398,21 @@ void createTnoise(controlStruct *control,int r)
       fclose(file);
     }
   fclose(fout);
+  arenaRelease(&(control->scratch),mark);
   free(corr);
 }
 
 void createPlanets(controlStruct *control,int r)
 {
-  int p,i,j,nit=1;
+  int p,i,j,nit=control->nbatch;
   FILE *file;
   int npts=1024;
   char fname[MAX_STRLEN];
   toasim_header_t* header;
   toasim_header_t* read_header;
-  double offsets[MAX_TOAS]; // should use malloc
-  double mjds[MAX_TOAS]; //  should use malloc
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  double *offsets = (double *)toaScratch(control,sizeof(double));
+  double *mjds = (double *)toaScratch(control,sizeof(double));
   // Create a set of corrections.
   toasim_corrections_t* corr = (toasim_corrections_t*)malloc(sizeof(toasim_corrections_t));
   char name[MAX_STRLEN];
@@ -4070,7 +4458,7 @@ void createPlanets(controlStruct *control,int r)
       header->seed = control->seed;
       
       header->ntoa = control->psr[p].nToAs;
-      header->nrealisations = 1;
+      header->nrealisations = nit;
       
       // First we write the header...
       sprintf(fname,"%s/workFiles/real_%d/%s.planets.%d",control->name,r,control->psr[control->planets[t].psrNum].name,t);
@@ -4101,7 +4489,7 @@ void createPlanets(controlStruct *control,int r)
 	  }
 	  printf("planets: number of toas = %d, psr = %d\n",control->psr[p].nToAs,p);
 	  for (j=0;j<control->psr[p].nToAs;j++){
-	    offsets[j]=-BTmodel(pb,ecc,a1,t0,om,control->psr[p].obs[j].sat);
+	    offsets[j]=-BTmodel(pb,ecc,a1,t0,om,control->psr[p].toa.sat[j]);
 	    printf("planets: offsets = %g\n",offsets[j]);
 	  }
 	  //	  exit(1);
@@ -4121,6 +4509,7 @@ void createPlanets(controlStruct *control,int r)
       fclose(file);
     }
   fclose(fout);
+  arenaRelease(&(control->scratch),mark);
   free(corr);
 }
 
@@ -4128,20 +4517,22 @@ void createPlanets(controlStruct *control,int r)
 void createClkNoise(controlStruct *control,int r)
 {
   int p,i,j;
+  TKstream stream;
   FILE *file;
   int npts=1024;
   char fname[MAX_STRLEN];
   toasim_header_t* header;
   toasim_header_t* read_header;
-  double offsets[MAX_TOAS]; // should use malloc
-  double mjds[MAX_TOAS]; //  should use malloc
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  double *offsets = (double *)toaScratch(control,sizeof(double));
+  double *mjds = (double *)toaScratch(control,sizeof(double));
   // Create a set of corrections.
   toasim_corrections_t* corr = (toasim_corrections_t*)malloc(sizeof(toasim_corrections_t));
   char name[MAX_STRLEN];
   float cnr_cut=0;
   float cnr_flat=0;
   float old_fc=-1;
-  int nit=1;
+  int nit=control->nbatch;
   double alpha,beta;
   float p_1yr=-1; // s^2 yr
   double secperyear = 86400.0*365.25;
@@ -4184,7 +4575,7 @@ void createClkNoise(controlStruct *control,int r)
 	  header->seed = control->seed;
 	  
 	  header->ntoa = control->psr[p].nToAs;
-	  header->nrealisations = 1;
+	  header->nrealisations = nit;
 	  
 	  // First we write the header...
 	  sprintf(fname,"%s/workFiles/real_%d/%s.clknoise.%d",control->name,r,control->psr[p].name,t);
@@ -4197,12 +4588,16 @@ void createClkNoise(controlStruct *control,int r)
 	      
 	      
 	      printf("Setting up the noise model %g %g\n",mjd_start,mjd_end);
+	      npts = redNoiseNpt(mjd_start,mjd_end,observationCadence(control,-1));
 	      model = setupRedNoiseModel(mjd_start,mjd_end,npts,nit,p_1yr,alpha,beta);
+	      model->pad = control->redNoisePad;
 	      model->cutoff=cnr_cut;
 	      model->flatten=cnr_flat;
 	      if(old_fc>0)
 		model->mode=MODE_T2CHOL;
-	      populateRedNoiseModel(model,&(control->seed));
+	      // The clock errors are common to all pulsars
+	      TKstreamInit(&stream,control->seed,r,-1,RAN_CLKNOISE+t,0);
+	      populateRedNoiseModel(model,&stream);
 	    }	      
 	  int itjmp=nit/50;
 	  if (itjmp<1)itjmp=1;
@@ -4228,7 +4623,7 @@ void createClkNoise(controlStruct *control,int r)
 	      }
 	      
 	      for (j=0;j<control->psr[p].nToAs;j++){
-		offsets[j]=getRedNoiseValue(model,control->psr[p].obs[j].sat,i);
+		offsets[j]=getRedNoiseValue(model,epochMJD(control->psr[p].toa.sat[j]),i);
 		//	    printf("offsets = %g\n",offsets[j]);
 	      }
 	      //	  exit(1);
@@ -4239,7 +4634,7 @@ void createClkNoise(controlStruct *control,int r)
 	      }
 	      sum/=control->psr[p].nToAs;
 	      for (j=0;j<control->psr[p].nToAs;j++){
-		mjds[j]=(double)control->psr[p].obs[j].sat;
+		mjds[j]=epochMJD(control->psr[p].toa.sat[j]);
 		offsets[j]-=sum;
 	      }
 	      TKremovePoly_d(mjds,offsets,control->psr[p].nToAs,2); // remove a quadratic to reduce the chances of phase wraps
@@ -4264,6 +4659,7 @@ void createClkNoise(controlStruct *control,int r)
 	}
     }
   fclose(fout);
+  arenaRelease(&(control->scratch),mark);
   free(corr);
 }
 
@@ -4273,12 +4669,16 @@ void createClkNoise(controlStruct *control,int r)
 void createRadiometerNoise(controlStruct *control, int r)
 {
   int i,p,j;
+  int nit=control->nbatch;
+  TKstream stream;
+  double *gauss;
   char fname[MAX_STRLEN];
   toasim_header_t* header;
   toasim_header_t* read_header;
   FILE* file;
   char name[MAX_STRLEN];
-  double offsets[MAX_TOAS];
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  double *offsets = (double *)toaScratch(control,sizeof(double));
   toasim_corrections_t* corr = (toasim_corrections_t*)malloc(sizeof(toasim_corrections_t));
   double err,efac,equad;
   corr->offsets=offsets;
@@ -4308,45 +4708,67 @@ void createRadiometerNoise(controlStruct *control, int r)
       header->seed = control->seed; // SHOULD SET THIS
       
       header->ntoa = control->psr[p].nToAs;
-      header->nrealisations = 1;
+      header->nrealisations = nit;
 
       sprintf(fname,"%s/workFiles/real_%d/%s.addGauss",control->name,r,control->psr[p].name);
       printf("... Opening file\n");
       file = toasim_write_header(header,fname);
       printf("... Creating offsets: %d\n",control->psr[p].nToAs);
+      // Deviate j of realisation i is always taken from the same place in
+      // the stream, so it remains keyed by the ToA number
+      if (!(gauss = (double *)malloc(sizeof(double)*nit*control->psr[p].nToAs)))
+	{
+	  printf("Unable to allocate memory for the radiometer noise\n");
+	  exit(1);
+	}
+      TKstreamInit(&stream,control->seed,r,p,RAN_RADIOMETER,0);
+      TKgaussDevFill(&stream,gauss,nit*control->psr[p].nToAs);
 
       // ADD IN EFAC/EQUAD
       // MUST DO
       for (j=0;j<control->psr[p].nToAs;j++)
 	{
-	  err = control->psr[p].obs[j].toaErr.dval;
-	  efac = control->psr[p].obs[j].efac.dval;
-	  equad = control->psr[p].obs[j].equad.dval;
-	  printf("have efac %g %g %g >%s<\n",err,efac,equad,control->psr[p].obs[j].efac.inVal);
+	  err = control->psr[p].toa.toaErr[j];
+	  efac = control->psr[p].toa.efac[j];
+	  equad = control->psr[p].toa.equad[j];
+	  printf("have efac %g %g %g\n",err,efac,equad);
 
-	  err = sqrt(pow(err,2)+pow(equad,2))*efac;
-	  offsets[j] = err*TKgaussDev(&(control->seed));
+	  offsets[j] = sqrt(pow(err,2)+pow(equad,2))*efac;
 	}
       printf(" ... Outputing file\n");
-      toasim_write_corrections(corr,header,file);
+      // Scale the errors in place, realisation by realisation
+      corr->offsets=gauss;
+      for (i=0;i<nit;i++)
+	{
+	  for (j=0;j<control->psr[p].nToAs;j++)
+	    corr->offsets[j] *= offsets[j];
+	  toasim_write_corrections(corr,header,file);
+	  corr->offsets += control->psr[p].nToAs;
+	}
       printf("... Closing file\n");
       fclose(file);
+      free(gauss);
     }
+  arenaRelease(&(control->scratch),mark);
   free(corr);
 }
 
 void createJitter(controlStruct *control, int r)
 {
   int i,p,j;
+  int nit=control->nbatch;
+  TKstream stream;
+  double *gauss;
   char fname[MAX_STRLEN];
   toasim_header_t* header;
   toasim_header_t* read_header;
   FILE* file;
   char name[MAX_STRLEN];
-  double offsets[MAX_TOAS];
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  double *offsets = (double *)toaScratch(control,sizeof(double));
   toasim_corrections_t* corr = (toasim_corrections_t*)malloc(sizeof(toasim_corrections_t));
   int dd;
-  double jLevel,tobs;
+  double tobs;
 
   corr->offsets=offsets;
   corr->params=""; // Normally leave as NULL. Can store this along with each realisation. 
@@ -4374,23 +4796,40 @@ void createJitter(controlStruct *control, int r)
       header->seed = control->seed; // SHOULD SET THIS
       
       header->ntoa = control->psr[p].nToAs;
-      header->nrealisations = 1;
+      header->nrealisations = nit;
 
       sprintf(fname,"%s/workFiles/real_%d/%s.jitter.%d",control->name,r,control->psr[control->jitter[dd].psrNum].name,dd);
       // First we write the header...
       file = toasim_write_header(header,fname);
 
+      if (!(gauss = (double *)malloc(sizeof(double)*nit*control->psr[p].nToAs)))
+	{
+	  printf("Unable to allocate memory for the jitter noise\n");
+	  exit(1);
+	}
+      TKstreamInit(&stream,control->seed,r,p,RAN_JITTER+dd,0);
+      TKgaussDevFill(&stream,gauss,nit*control->psr[p].nToAs);
       for (j=0;j<control->psr[p].nToAs;j++)
 	{
-	  tobs = control->psr[p].obs[j].tobs.dval;
-	  jLevel = control->jitter[dd].sigma_j.dval*sqrt(control->jitter[dd].t0.dval/tobs);
-	  offsets[j] = jLevel*TKgaussDev(&(control->seed));
-	  printf("Adding jitter: %g\n",offsets[j]);
+	  tobs = control->psr[p].toa.tobs[j];
+	  offsets[j] = control->jitter[dd].sigma_j.dval*sqrt(control->jitter[dd].t0.dval/tobs);
+	}
+      corr->offsets=gauss;
+      for (i=0;i<nit;i++)
+	{
+	  for (j=0;j<control->psr[p].nToAs;j++)
+	    {
+	      corr->offsets[j] *= offsets[j];
+	      printf("Adding jitter: %g\n",corr->offsets[j]);
+	    }
+	  toasim_write_corrections(corr,header,file);
+	  corr->offsets += control->psr[p].nToAs;
 	}
-      toasim_write_corrections(corr,header,file);
 
       fclose(file);
+      free(gauss);
     }
+  arenaRelease(&(control->scratch),mark);
   free(corr);
 }
 
@@ -4458,6 +4897,17 @@ double dms_turn(char *line){
   return turn;
 }
 
+// Grows one of the arrays of SMBHB source parameters to n entries
+static double *growSourceArray(double *a,int n)
+{
+  if (!(a = (double *)realloc(a,sizeof(double)*(n > 0 ? n : 1))))
+    {
+      printf("Error in allocating memory for %d GW sources\n",n);
+      exit(1);
+    }
+  return a;
+}
+
 void createGW(controlStruct *control, int r)
 {
   int i,p,j,k;
@@ -4465,15 +4915,14 @@ void createGW(controlStruct *control, int r)
   toasim_header_t* header;
   toasim_header_t* read_header;
   FILE* file;
-  char expression[MAX_STRLEN];
-  int errorFlag=0;
   char name[MAX_STRLEN];
-  double offsets[MAX_TOAS];
-  double epochs[MAX_TOAS]; // Will change to doubles - should use malloc
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  double *offsets = (double *)toaScratch(control,sizeof(double));
+  double *epochs = (double *)toaScratch(control,sizeof(double));
   toasim_corrections_t* corr = (toasim_corrections_t*)malloc(sizeof(toasim_corrections_t));
 
   gwSrc *gw;
-  long double timeOffset=0.0; 
+  toaEpoch timeOffset = {0,0};
   long double scale;
   long double alpha;
   long double gwAmp;
@@ -4481,30 +4930,32 @@ void createGW(controlStruct *control, int r)
   long double flo=0.0,fhi=0.0;
   long double kp[3];            /* Vector pointing to pulsar           */
   long double tspan = (control->maxT - control->minT)*86400.0L;
-  long double time;
-  long double gwRes[MAX_TOAS];
-  double gwRes_p[MAX_TOAS];
-  double gwRes_c[MAX_TOAS];
-  long double dist[control->npsr];
+  double time;
+  long double *gwRes = (long double *)toaScratch(control,sizeof(long double));
+  double *gwRes_p = (double *)toaScratch(control,sizeof(double));
+  double *gwRes_c = (double *)toaScratch(control,sizeof(double));
+  long double *dist = (long double *)arenaAlloc(&(control->scratch),sizeof(long double)*control->npsr);
   long double mean;
   int distNum=0;
   int logspacing=1;
   int ngw=1000;
-  char readGW=0;
-  char writeGW=0;
-  char gwFileName[MAX_STRLEN];
-  FILE *gwFile;
   int kk;
   int nCW=0;
+  int nit=control->nbatch;
+  int b,cw0=0,deterministic;
 
   double resp,resc;
+  gwResponse response;
   double lambda_p,beta_p,lambda,beta;
-  double *h0_g,*omega_g,*angpol_g,*lambda_g,*beta_g,*skyInc_g;
-  long sSeed = TKsetSeed();
+  double *angpol_g=NULL,*lambda_g=NULL,*beta_g=NULL;
+  const cwCatalogue *cat=NULL;
+  double *coeffs=NULL,period=0;
+  TKstream stream;
 
   
   for (kk=0;kk<control->nGW;kk++)
     {
+      TKstreamInit(&stream,control->seed,r,-1,RAN_GW+kk,0);
       alpha = control->gw[kk].alpha.dval;
       gwAmp = control->gw[kk].amp.dval;
 
@@ -4512,9 +4963,9 @@ void createGW(controlStruct *control, int r)
 	{
 	  scale = pow(86400.0*365.25,alpha);
 	  gwAmp *= scale;
-	  if ((gw = (gwSrc *)malloc(sizeof(gwSrc)*ngw))==NULL)
+	  if ((gw = (gwSrc *)malloc(sizeof(gwSrc)*ngw*nit))==NULL)
 	    {
-	      printf("Unable to allocate memory for %d GW sources\n",ngw);
+	      printf("Unable to allocate memory for %d GW sources\n",ngw*nit);
 	      exit(1);
 	    }
 	  
@@ -4523,71 +4974,46 @@ void createGW(controlStruct *control, int r)
 	  if (fhi==0)
 	    fhi = 1.0/(long double)86400.0L;
 	  
-	  timeOffset = 0.5*(control->maxT + control->minT);
+	  timeOffset = epochFromMJD(0.5*(control->maxT + control->minT));
 	  
 	  
-	  GWbackground(gw,ngw,&(control->seed),flo,fhi,gwAmp,alpha,logspacing);
-	  for (i=0;i<ngw;i++)
-	    setupGW(&gw[i]);
+	  // A separate background for each realisation in the file
+	  if (strlen(control->gw[kk].fname)>0)
+	    gwbCacheSources(control,control->gw[kk].fname,r,gw,ngw,&stream,flo,fhi,gwAmp,alpha,logspacing);
+	  else
+	    {
+	      for (b=0;b<nit;b++)
+		GWbackground(gw+b*ngw,ngw,&stream,flo,fhi,gwAmp,alpha,logspacing);
+	      for (i=0;i<ngw*nit;i++)
+		setupGW(&gw[i]);
+	    }
+	}
+
+      if (control->gw[kk].type==7)
+	{
+	  scale = pow(86400.0*365.25,alpha);
+	  gwAmp *= scale;
+	  timeOffset = epochFromMJD(0.5*(control->maxT + control->minT));
+	  // The coefficients of every realisation in the file, for all the pulsars
+	  period = control->gw[kk].nspan*(double)(control->maxT - control->minT);
+	  coeffs = gwbFourierCoeffs(control,&stream,control->gw[kk].nfreq,period,(double)gwAmp,(double)alpha,nit);
 	}
 
       if (control->gw[kk].type==5)
 	{
-	  double res_r,res_i;
-	  double SPEED_LIGHT = 299792458.0; /*!< Speed of light (m/s)                       */
-	  double GM = 1.3271243999e20;      /*!< Gravitational constant * mass sun          */
-	  double n1,n2,n3;
-	  double B1,B2,deltaPhi,res;
-	  double cosTheta;
-	  double redshift,skyPhi,skyTheta,logfgw,polaris_ang,cm_dist_mpc,cw_phase,log_ch_mass,cosinc,mc,angpol;
-	  double massRatio,logObsFreq,temp,distance;
-	  double H0=70;
-	  FILE *fin;
-
-
-	  h0_g = (double *)malloc(sizeof(double)*MAX_CWS);
-	  omega_g = (double *)malloc(sizeof(double)*MAX_CWS);
-	  if (!(angpol_g = (double *)malloc(sizeof(double)*MAX_CWS)))
-	    {printf("Error in allocating memory\n"); exit(1);}
-       
-	  lambda_g = (double *)malloc(sizeof(double)*MAX_CWS);
-	  beta_g = (double *)malloc(sizeof(double)*MAX_CWS);
-	  if (!(skyInc_g = (double *)malloc(sizeof(double)*MAX_CWS)))
-	    {printf("Error in allocating memory\n"); exit(1);}
-	
-	  if (!(fin = fopen(control->gw[kk].fname,"r")))
-	    {
-	      printf("Unable to open file >%s< to read the GW soure parameters\n",control->gw[kk].fname);
-	      exit(1);
-	    }		 
-	  
-	  // Read all the sources for this pulsar	  
-	  while (!feof(fin))
+	  // The catalogue is loaded once and shared by all the realisations
+	  cat = cwCatalogueGet(control->gw[kk].fname);
+	  nCW = (int)cat->nsrc;
+	  // The random orientations are drawn for each realisation in the file
+	  angpol_g = growSourceArray(NULL,nCW*nit);
+	  lambda_g = growSourceArray(NULL,nCW*nit);
+	  beta_g = growSourceArray(NULL,nCW*nit);
+	  for (j=0;j<nCW*nit;j++)
 	    {
-	      if (fscanf(fin,"%lf %lf %lf %lf %lf %lf %lf %lf %lf %lf",&log_ch_mass,&massRatio,&redshift,&distance,&logObsFreq,
-			 &temp,&temp,&temp,&temp,&(skyInc_g[nCW]))==10)
-		//		  if (fscanf(fin,"%lf %lf %lf %lf %lf %lf %lf %lf %lf",&redshift,&skyPhi,&skyTheta,
-		//			     &skyInc,&logfgw,&polaris_ang,&cm_dist_mpc,&cw_phase,&log_ch_mass)==9)
-		
-		{
-		  cosinc = cos(skyInc_g[nCW]);
-		  mc = pow(10,log_ch_mass);
-		  cm_dist_mpc = distance*1000.0; // Now read this from the input file		 		  
-		  h0_g[nCW] = pow(GM*mc*(1+redshift),(5.0/3.0))/pow(SPEED_LIGHT,4)/(cm_dist_mpc*1e6*3.08568025e16)*pow((M_PI*pow(10,logObsFreq)),(2.0/3.0));		 
-		  //		      omega_g = 2*M_PI*pow(10,logfgw);
-		  omega_g[nCW] = 2*M_PI*pow(10,logObsFreq);		  
-		  angpol_g[nCW] = 2*M_PI*TKranDev(&sSeed);
-		  lambda_g[nCW] = acos((TKranDev(&sSeed)-0.5)*2);  
-		  beta_g[nCW]   = TKranDev(&sSeed)*2*M_PI;  
-		  nCW++;
-		  if (nCW == MAX_CWS)
-		    {
-		      printf("ERROR: Must increase number of CW sources in ptaSimulate.h\n");
-		      exit(1);
-		    }		  
-		}
+	      angpol_g[j] = 2*M_PI*TKstreamRanDev(&stream);
+	      lambda_g[j] = acos((TKstreamRanDev(&stream)-0.5)*2);
+	      beta_g[j]   = TKstreamRanDev(&stream)*2*M_PI;
 	    }
-	  fclose(fin);
 	}
 		  
       for (p=0;p<control->npsr;p++)
@@ -4616,7 +5042,7 @@ void createGW(controlStruct *control, int r)
 	  header->seed = 0; // SHOULD SET THIS
 	  
 	  header->ntoa = control->psr[p].nToAs;
-	  header->nrealisations = 1;
+	  header->nrealisations = nit;
 	  
 	  sprintf(fname,"%s/workFiles/real_%d/%s.addGW.%d",control->name,r,control->psr[p].name,kk);
 	  file = toasim_write_header(header,fname);
@@ -4627,495 +5053,291 @@ void createGW(controlStruct *control, int r)
 	  dec_p = control->psr[p].decjd*M_PI/180.0;
 	  if (control->gw[kk].type==1)
 	    setupPulsar_GWsim(ra_p,dec_p,kp);
-	  else if (control->gw[kk].type==2)
+	  else if (control->gw[kk].type==2 || control->gw[kk].type==4 || control->gw[kk].type==6)
 	    {
-	      double n1,n2,n3;
-	      double e11p,e21p,e31p,e12p,e22p,e32p,e13p,e23p,e33p;
-	      double e11c,e21c,e31c,e12c,e22c,e32c,e13c,e23c,e33c;
-	      double cosTheta;
-
 	      lambda_p = (double)ra_p;
 	      beta_p   = (double)dec_p;
-	      lambda   = control->gw[kk].ra.dval;
-	      beta   = control->gw[kk].dec.dval;
-	      // Pulsar vector
-	      n1 = cosl(lambda_p)*cosl(beta_p);
-	      n2 = sinl(lambda_p)*cosl(beta_p);
-	      n3 = sinl(beta_p);
-	      
-	      cosTheta = cosl(beta)*cosl(beta_p)*cosl(lambda-lambda_p)+
-		sinl(beta)*sinl(beta_p);
-	      
-	      // From KJ's paper
-	      // Gravitational wave matrix
-	      
-	      // NOTE: This is for the plus terms.  For cross should use different terms
-	      e11p = pow(sinl(lambda),2)-pow(cosl(lambda),2)*pow(sinl(beta),2);
-	      e21p = -sinl(lambda)*cosl(lambda)*(pow(sinl(beta),2)+1);
-	      e31p = cosl(lambda)*sinl(beta)*cosl(beta);
-	      
-	      e12p = -sinl(lambda)*cosl(lambda)*(pow(sinl(beta),2)+1);
-	      e22p = pow(cosl(lambda),2)-pow(sinl(lambda),2)*pow(sinl(beta),2);
-	      e32p = sinl(lambda)*sinl(beta)*cosl(beta);
-	      
-	      e13p = cosl(lambda)*sinl(beta)*cosl(beta);
-	      e23p = sinl(lambda)*sinl(beta)*cosl(beta);
-	      e33p = -powl(cosl(beta),2);
-	      
-	      resp = (n1*(n1*e11p+n2*e12p+n3*e13p)+
-		      n2*(n1*e21p+n2*e22p+n3*e23p)+
-		      n3*(n1*e31p+n2*e32p+n3*e33p));
-	      
-	      if ((1-cosTheta)==0.0)
-		resp = 0.0;  // Check if this is sensible
-	      else
-		resp = 1.0L/(2.0L*(1.0L-cosTheta))*(resp); 
-
-	      e11c = sin(2*lambda)*sin(beta);
-	      e21c = -cos(2*lambda)*sin(beta);
-	      e31c = -sin(lambda)*cos(beta);
-	      
-	      e12c = -cos(2*lambda)*sin(beta);
-	      e22c = -sin(2*lambda)*sin(beta);
-	      e32c = cos(lambda)*cos(beta);
-	      
-	      e13c = -sin(lambda)*cos(beta);
-	      e23c = cos(lambda)*cos(beta);
-	      e33c  = 0;
-	      
-	      resc = (n1*(n1*e11c+n2*e12c+n3*e13c)+
-		      n2*(n1*e21c+n2*e22c+n3*e23c)+
-		      n3*(n1*e31c+n2*e32c+n3*e33c));
-	      
-	      if ((1-cosTheta)==0.0)
-		resc = 0.0;  // Check if this is sensible
-	      else
-		resc = 1.0L/(2.0L*(1.0L-cosTheta))*(resc); 
+	      gwResponseGet(lambda_p,beta_p,control->gw[kk].ra.dval,control->gw[kk].dec.dval,
+			    control->gw[kk].ra.constant && control->gw[kk].dec.constant,&response);
+	      resp = response.resp;
+	      resc = response.resc;
+	      if (control->gw[kk].type==2)
+		{
+		  // The waveforms are the same for each realisation in the batch
+		  for (i=0;i<control->psr[p].nToAs;i++)
+		    epochs[i] = epochMJD(control->psr[p].toa.sat[i]);
+		  evaluateValueArray(control->gw[kk].ap.inVal,epochs,gwRes_p,control->psr[p].nToAs,&(control->expr));
+		  evaluateValueArray(control->gw[kk].ac.inVal,epochs,gwRes_c,control->psr[p].nToAs,&(control->expr));
+		}
 	    }
 	    
-	  if (control->gw[kk].type==5)
-	    {
-	      double res_r,res_i;
-	      double SPEED_LIGHT = 299792458.0; /*!< Speed of light (m/s)                       */
-	      double GM = 1.3271243999e20;      /*!< Gravitational constant * mass sun          */
-	      double n1,n2,n3;
-	      double B1,B2,deltaPhi,res;
-	      double cosTheta;
-	      double redshift,skyPhi,skyTheta,logfgw,polaris_ang,cm_dist_mpc,cw_phase,log_ch_mass,h0,cosinc,mc,angpol;
-	      double massRatio,logObsFreq,temp,distance;
-	      double H0=70;
-
-	      mean=0;
-	      for (i=0;i<control->psr[p].nToAs;i++)
-		gwRes[i]=0.0;
+	  // The single sources (types 2, 3, 4 and 6) give the same offsets in every
+	  // realisation in the file, so they are made once and written nit times
+	  deterministic = (control->gw[kk].type==2 || control->gw[kk].type==3 ||
+			   control->gw[kk].type==4 || control->gw[kk].type==6);
 
-	      // Read all the sources for this pulsar
-	    	      
-	      for (j=0;j<nCW;j++)
+	  // Each realisation in the file uses its own set of GW sources
+	  for (b=0;b<nit;b++)
+	    {
+	      if (b > 0 && deterministic)
 		{
-		  lambda_p = (double)ra_p;
-		  beta_p   = (double)(dec_p); 
-		  
-		  // Lee et al. (2011) equation 12
-		  B1 = (1+pow(sin(beta_g[j]),2))*pow(cos(beta_p),2)*cos(2*(lambda_g[j]-lambda_p))-
-		    sin(2*beta_g[j])*sin(2*beta_p)*cos(lambda_g[j]-lambda_p)+(2.0-3.0*pow(cos(beta_p),2))*pow(cos(beta_g[j]),2);
-		  // Lee et al. (2011) equation 13
-		  B2 = 2*cos(beta_g[j])*sin(beta_p)*sin(lambda_g[j]-lambda_p)-2*sin(beta_g[j])*pow(cos(beta_p),2)*sin(2*(lambda_g[j]-lambda_p));
-		  // Lee et al. (2011) equation 14
-		  cosTheta = -(cosl(beta_g[j])*cosl(beta_p)*cosl(lambda_g[j]-lambda_p) + sinl(beta_g[j])*sinl(beta_p));
-		  deltaPhi = omega_g[j]*dist[p]*(1.0-cosTheta);
-		  
-		  // NOTE THAT h0 IS NOT THE SAME AS THE GW AMPLITUDE GIVEN IN LEE ET AL. UNDER EQUATION 14
-		  
-		  // Now loop through all the residuals for this pulsar
-		  mean = 0.0;
+		  toasim_write_corrections(corr,header,file);
+		  continue;
+		}
+	      cw0 = b*nCW;
+	      if (control->gw[kk].type==5)
+		{
+		  cwPopulationResiduals(control,p,nCW,cat->h0,cat->omega,angpol_g+cw0,lambda_g+cw0,beta_g+cw0,
+					cat->skyInc,dist[p],timeOffset,gwRes);
+		  mean=0;
 		  for (i=0;i<control->psr[p].nToAs;i++)
-		    {
-		      time = (control->psr[p].obs[i].sat - timeOffset)*86400.0L;
-		      // Equation 11 in Lee et al. (2011)
-		      res = h0_g[j]/2.0/omega_g[j]*sin(deltaPhi/2.0)/(1.0-cosTheta)*
-			((B1*cos(2*angpol_g[j])+B2*sin(2*angpol_g[j]))*cos(omega_g[j]*time-deltaPhi/2.0)*(1+pow(cos(skyInc_g[j]),2))
-			 + 2*(B2*cos(2*angpol_g[j])-B1*sin(2*angpol_g[j]))*sin(omega_g[j]*time-deltaPhi/2.0)*cos(skyInc_g[j]));
-		      
-		      gwRes[i] += (res);
-		      mean+=gwRes[i];
-		    }
+		    mean+=gwRes[i];
 		}
-	    }
-	  else
-	    {
-	      mean = 0.0;
-	      for (i=0;i<control->psr[p].nToAs;i++)
+	      else
 		{
-		  time = (control->psr[p].obs[i].sat - timeOffset)*86400.0L;
-		  
+		  mean = 0.0;
 		  if (control->gw[kk].type==1)
+		    gwbResiduals(control,p,kp,dist[p],gw+b*ngw,ngw,timeOffset,gwRes);
+		  else if (control->gw[kk].type==7)
+		    gwbFourierResiduals(control,p,coeffs+(size_t)b*control->gw[kk].nfreq*2*control->npsr,
+					control->gw[kk].nfreq,period,timeOffset,gwRes);
+		  for (i=0;i<control->psr[p].nToAs;i++)
 		    {
-		      gwRes[i] = 0.0;	      
-		      for (k=0;k<ngw;k++)
+		      time = epochSeconds(control->psr[p].toa.sat[i],timeOffset);
+		  
+		      if (control->gw[kk].type==1 || control->gw[kk].type==7)
+			mean += gwRes[i];
+		      else if (control->gw[kk].type==2)
 			{
-			  gwRes[i]+=calculateResidualGW(kp,&gw[k],time,dist[p]);
-			  //	      printf("Have: %d %g %g %g %g %g\n",k,(double)gwRes[i],(double)kp[0],(double)kp[1],(double)kp[2],(double)dist[p]);
+			  gwRes[i] = gwRes_p[i]*resp+gwRes_c[i]*resc;
+			  mean+=gwRes[i];
 			}
-		      mean += gwRes[i];
-		    }
-		  else if (control->gw[kk].type==2)
-		    {
-		      // Must process Ap and Ac at this time
-		      sprintf(expression,"x=%g; v=%s;",(double)control->psr[p].obs[i].sat,control->gw[kk].ap.inVal);
-		      errorFlag = runEvaluateExpression(expression,control);      
-		      gwRes_p[i] = variable[0].value;
-		      printf("Results = %g %g %g\n",(double)control->psr[p].obs[i].sat, variable[0].value,variable[1].value);
-		      
-		      sprintf(expression,"x=%g; v=%s;",(double)control->psr[p].obs[i].sat,control->gw[kk].ac.inVal);
-		      errorFlag = runEvaluateExpression(expression,control);      
-		      gwRes_c[i] = variable[0].value;
-		      
-		      gwRes[i] = gwRes_p[i]*resp+gwRes_c[i]*resc;
-		      mean+=gwRes[i];
-		    }
-		  else if (control->gw[kk].type==3) // GWM
-		    {
-		      // Equations here from Wang et al.
-		      long double dt,scale;
-		      double cos2Phi;
-		      double cosPhi;
-		      double l1,l2,l3,m1,m2,m3;
-		      //double beta_m;
-		      double d1,d2,d3,md;
-		      double a1,a2,a3,ma;
-		      long double time;
-		      double g1,g2,g3;
-		      double n1,n2,n3;
-		      double cosTheta;
+		      else if (control->gw[kk].type==3) // GWM
+			{
+			  // Equations here from Wang et al.
+			  double scale;
+			  double cos2Phi;
+			  double cosPhi;
+			  double l1,l2,l3,m1,m2,m3;
+			  //double beta_m;
+			  double d1,d2,d3,md;
+			  double a1,a2,a3,ma;
+			  double time;
+			  double g1,g2,g3;
+			  double n1,n2,n3;
+			  double cosTheta;
 		      
-		      /* define the GW coordinate system see Hobbs,G. (2009)*/
-		      /* the d vector point to north pole or south pole*/ 
+			  /* define the GW coordinate system see Hobbs,G. (2009)*/
+			  /* the d vector point to north pole or south pole*/ 
 		      
-		      time    = (control->psr[p].obs[i].sat - control->gw[kk].gwmEpoch.dval)*86400.0L;
-		      if (time > 0)
-			{
-			  lambda_p = (double)ra_p;
-			  beta_p   = (double)dec_p;
-			  lambda   = control->gw[kk].ra.dval;
-			  beta   = control->gw[kk].dec.dval;
+			  time    = epochSeconds(control->psr[p].toa.sat[i],epochFromMJD(control->gw[kk].gwmEpoch.dval));
+			  if (time > 0)
+			    {
+			      lambda_p = (double)ra_p;
+			      beta_p   = (double)dec_p;
+			      lambda   = control->gw[kk].ra.dval;
+			      beta   = control->gw[kk].dec.dval;
 			  
-			  // GW vector
-			  g1 = -cosl(lambda)*cosl(beta);
-			  g2 = -sinl(lambda)*cosl(beta);
-			  g3 = -sinl(beta);
+			      // GW vector
+			      g1 = -cosl(lambda)*cosl(beta);
+			      g2 = -sinl(lambda)*cosl(beta);
+			      g3 = -sinl(beta);
 			  
-			  // Pulsar vector
-			  n1 = cosl(lambda_p)*cosl(beta_p);
-			  n2 = sinl(lambda_p)*cosl(beta_p);
-			  n3 = sinl(beta_p);
-			  //	       printf("n = %g %g %g\n",n1,n2,n3);
-			  cosTheta = -(cosl(beta)*cosl(beta_p)*cosl(lambda-lambda_p) + sinl(beta)*sinl(beta_p));
+			      // Pulsar vector
+			      n1 = cosl(lambda_p)*cosl(beta_p);
+			      n2 = sinl(lambda_p)*cosl(beta_p);
+			      n3 = sinl(beta_p);
+			      //	       printf("n = %g %g %g\n",n1,n2,n3);
+			      cosTheta = -(cosl(beta)*cosl(beta_p)*cosl(lambda-lambda_p) + sinl(beta)*sinl(beta_p));
 			  
-			  if (beta == 0.0 )
-			    {
-			      d1 = 0.0;
-			      d2 = 0.0;
-			      d3 = 1.0;
-			    }
+			      if (beta == 0.0 )
+				{
+				  d1 = 0.0;
+				  d2 = 0.0;
+				  d3 = 1.0;
+				}
 			  
-			  if ( beta > 0)
-			    {
-			      d1 = g1*cosl(0.5*M_PI - beta);
-			      d2 = g2*cosl(0.5*M_PI - beta);
-			      d3 = 1.0 + g3*cos(0.5*M_PI - beta);
-			      md = sqrt(d1*d1 + d2*d2 + d3*d3);
-			      d1 = d1/md;
-			      d2 = d2/md;
-			      d3 = d3/md;
-			      /*covert d to unit vector */
-			    } 
-			  else if (beta < 0)
-			    {
-			      d1 = g1*cosl(-0.5*M_PI - beta);
-			      d2 = g2*cosl(-0.5*M_PI - beta);
-			      d3 = -1.0 + g3*cos(-0.5*M_PI - beta);
-			      md = sqrt(d1*d1 + d2*d2 + d3*d3);
-			      d1 = d1/md;
-			      d2 = d2/md;
-			      d3 = d3/md;
-			    } 
+			      if ( beta > 0)
+				{
+				  d1 = g1*cosl(0.5*M_PI - beta);
+				  d2 = g2*cosl(0.5*M_PI - beta);
+				  d3 = 1.0 + g3*cos(0.5*M_PI - beta);
+				  md = sqrt(d1*d1 + d2*d2 + d3*d3);
+				  d1 = d1/md;
+				  d2 = d2/md;
+				  d3 = d3/md;
+				  /*covert d to unit vector */
+				} 
+			      else if (beta < 0)
+				{
+				  d1 = g1*cosl(-0.5*M_PI - beta);
+				  d2 = g2*cosl(-0.5*M_PI - beta);
+				  d3 = -1.0 + g3*cos(-0.5*M_PI - beta);
+				  md = sqrt(d1*d1 + d2*d2 + d3*d3);
+				  d1 = d1/md;
+				  d2 = d2/md;
+				  d3 = d3/md;
+				} 
 		      
-			  a1 =  (d2*g3-d3*g2);
-			  a2 =  (d3*g1-d1*g3);
-			  a3 =  (d1*g2-d2*g1);
-			  /* conver it to unit vector */
-			  ma = sqrt(a1*a1 +a2*a2 + a3*a3);
-			  a1 = a1/ma;
-			  a2 = a2/ma;
-			  a3 = a3/ma;
+			      a1 =  (d2*g3-d3*g2);
+			      a2 =  (d3*g1-d1*g3);
+			      a3 =  (d1*g2-d2*g1);
+			      /* conver it to unit vector */
+			      ma = sqrt(a1*a1 +a2*a2 + a3*a3);
+			      a1 = a1/ma;
+			      a2 = a2/ma;
+			      a3 = a3/ma;
 			  
-			  /* polarisation vector of GW source */
-			  m1 = d1*cosl(control->gw[kk].gwmPhi.dval)	+ a1*sinl(control->gw[kk].gwmPhi.dval);   
-			  m2 = d2*cosl(control->gw[kk].gwmPhi.dval)	+ a2*sinl(control->gw[kk].gwmPhi.dval);
-			  m3 = d3*cosl(control->gw[kk].gwmPhi.dval)	+ a3*sinl(control->gw[kk].gwmPhi.dval);
+			      /* polarisation vector of GW source */
+			      m1 = d1*cosl(control->gw[kk].gwmPhi.dval)	+ a1*sinl(control->gw[kk].gwmPhi.dval);   
+			      m2 = d2*cosl(control->gw[kk].gwmPhi.dval)	+ a2*sinl(control->gw[kk].gwmPhi.dval);
+			      m3 = d3*cosl(control->gw[kk].gwmPhi.dval)	+ a3*sinl(control->gw[kk].gwmPhi.dval);
 			  
-			  if  (cosTheta != 1.0 && cosTheta != -1.0)
-			    {g1 = g1*cosTheta; 
-			      g2 = g2*cosTheta;
-			      g3 = g3*cosTheta;
+			      if  (cosTheta != 1.0 && cosTheta != -1.0)
+				{g1 = g1*cosTheta; 
+				  g2 = g2*cosTheta;
+				  g3 = g3*cosTheta;
 			      
-			      /*l is  the projection of pulsar vector on the plane which pependicular to the GW source direction */
-			      l1 = n1 - g1;
-			      l2 = n2 - g2;
-			      l3 = n3 - g3;
-			      cosPhi = (l1*m1 + l2*m2 + l3*m3)/sqrt(l1*l1 + l2*l2 + l3*l3);
-			      //		        if  (cosPhi >= 1.0/sqrt(2.0))
-			      cos2Phi = 2*cosPhi*cosPhi - 1.0;
-			      //		       else
-			      //		      	   cos2Phi = 2*sqrt(1.0 - cosPhi*cosPhi)*sqrt(1.0 - cosPhi*cosPhi) - 1.0;
-			    }
-			  else 
-			    {cos2Phi = 0;}
+				  /*l is  the projection of pulsar vector on the plane which pependicular to the GW source direction */
+				  l1 = n1 - g1;
+				  l2 = n2 - g2;
+				  l3 = n3 - g3;
+				  cosPhi = (l1*m1 + l2*m2 + l3*m3)/sqrt(l1*l1 + l2*l2 + l3*l3);
+				  //		        if  (cosPhi >= 1.0/sqrt(2.0))
+				  cos2Phi = 2*cosPhi*cosPhi - 1.0;
+				  //		       else
+				  //		      	   cos2Phi = 2*sqrt(1.0 - cosPhi*cosPhi)*sqrt(1.0 - cosPhi*cosPhi) - 1.0;
+				}
+			      else 
+				{cos2Phi = 0;}
 			  
-			  scale = -0.5*cos2Phi*(1-cosTheta);
-			  //		   scale=1.0;
-			  gwRes[i] = scale*time*control->gw[kk].gwmAmp.dval;
-			  mean+=gwRes[i];
-			} 
-		      else 
-			{
-			  gwRes[i] =0.0;
-			  mean+=gwRes[i];
+			      scale = -0.5*cos2Phi*(1-cosTheta);
+			      //		   scale=1.0;
+			      gwRes[i] = scale*time*control->gw[kk].gwmAmp.dval;
+			      mean+=gwRes[i];
+			    } 
+			  else 
+			    {
+			      gwRes[i] =0.0;
+			      mean+=gwRes[i];
+			    }
 			}
-		    }
-		  else if (control->gw[kk].type==4) // CW source
-		    {
-		      double res_r,res_i;
-		      double SPEED_LIGHT = 299792458.0; /*!< Speed of light (m/s)                       */
-		      double GM = 1.3271243999e20;      /*!< Gravitational constant * mass sun          */
-		      double n1,n2,n3;
-		      double e11p,e21p,e31p,e12p,e22p,e32p,e13p,e23p,e33p;
-		      double e11c,e21c,e31c,e12c,e22c,e32c,e13c,e23c,e33c;
-		      double cosTheta;
-		      double omega_g;
-		      
-		      omega_g = 2*M_PI*control->gw[kk].cgw_freq.dval;
-		      lambda_p = (double)ra_p;
-		      beta_p   = (double)dec_p;
-		      lambda   = control->gw[kk].ra.dval;
-		      beta   = control->gw[kk].dec.dval;
-		      // Pulsar vector
-		      n1 = cosl(lambda_p)*cosl(beta_p);
-		      n2 = sinl(lambda_p)*cosl(beta_p);
-		      n3 = sinl(beta_p);
-		      
-		      cosTheta = cosl(beta)*cosl(beta_p)*cosl(lambda-lambda_p)+
-			sinl(beta)*sinl(beta_p);
-		      
-		      // From KJ's paper
-		      // Gravitational wave matrix
-		      
-		      // NOTE: This is for the plus terms.  For cross should use different terms
-		      e11p = pow(sinl(lambda),2)-pow(cosl(lambda),2)*pow(sinl(beta),2);
-		      e21p = -sinl(lambda)*cosl(lambda)*(pow(sinl(beta),2)+1);
-		      e31p = cosl(lambda)*sinl(beta)*cosl(beta);
-		      
-		      e12p = -sinl(lambda)*cosl(lambda)*(pow(sinl(beta),2)+1);
-		      e22p = pow(cosl(lambda),2)-pow(sinl(lambda),2)*pow(sinl(beta),2);
-		      e32p = sinl(lambda)*sinl(beta)*cosl(beta);
-		      
-		      e13p = cosl(lambda)*sinl(beta)*cosl(beta);
-		      e23p = sinl(lambda)*sinl(beta)*cosl(beta);
-		      e33p = -powl(cosl(beta),2);
-		      
-		      resp = (n1*(n1*e11p+n2*e12p+n3*e13p)+
-			      n2*(n1*e21p+n2*e22p+n3*e23p)+
-			      n3*(n1*e31p+n2*e32p+n3*e33p));
-		      
-		      if ((1-cosTheta)==0.0)
-			resp = 0.0;  // Check if this is sensible
-		      else
-			resp = 1.0L/(2.0L*(1.0L-cosTheta))*(resp); 
-		      
-		      e11c = sin(2*lambda)*sin(beta);
-		      e21c = -cos(2*lambda)*sin(beta);
-		      e31c = -sin(lambda)*cos(beta);
-		      
-		      e12c = -cos(2*lambda)*sin(beta);
-		      e22c = -sin(2*lambda)*sin(beta);
-		      e32c = cos(lambda)*cos(beta);
-		      
-		      e13c = -sin(lambda)*cos(beta);
-		      e23c = cos(lambda)*cos(beta);
-		      e33c  = 0;
-		      
-		      resc = (n1*(n1*e11c+n2*e12c+n3*e13c)+
-			      n2*(n1*e21c+n2*e22c+n3*e23c)+
-			      n3*(n1*e31c+n2*e32c+n3*e33c));
+		      else if (control->gw[kk].type==4) // CW source
+			{
+			  double res_r,res_i;
+			  double SPEED_LIGHT = 299792458.0; /*!< Speed of light (m/s)                       */
+			  double GM = 1.3271243999e20;      /*!< Gravitational constant * mass sun          */
+			  double cosTheta;
+			  double omega_g;
 		      
-		      if ((1-cosTheta)==0.0)
-			resc = 0.0;  // Check if this is sensible
-		      else
-			resc = 1.0L/(2.0L*(1.0L-cosTheta))*(resc); 
+			  omega_g = 2*M_PI*control->gw[kk].cgw_freq.dval;
+			  cosTheta = response.cosTheta;
 		      
-		      res_r = (control->gw[kk].cgw_h0.dval/omega_g*((1+pow(control->gw[kk].cgw_cosinc.dval,2))*cos(2*control->gw[kk].cgw_angpol.dval)*sin(omega_g*time)+2*control->gw[kk].cgw_cosinc.dval*sin(2*control->gw[kk].cgw_angpol.dval)*cos(omega_g*time)))*resp + (control->gw[kk].cgw_h0.dval/omega_g*((1+pow(control->gw[kk].cgw_cosinc.dval,2))*sin(2*control->gw[kk].cgw_angpol.dval)*sin(omega_g*time)-2*control->gw[kk].cgw_cosinc.dval*cos(2*control->gw[kk].cgw_angpol.dval)*cos(omega_g*time)))*resc; 
-		      res_i = 0.0;
-		      if (dist[p]>0) // Add in the pulsar term  (NOTE: using subtraction here)
-			{
-			  double omega_prime_g;
-			  double h0_prime;
+			  res_r = (control->gw[kk].cgw_h0.dval/omega_g*((1+pow(control->gw[kk].cgw_cosinc.dval,2))*cos(2*control->gw[kk].cgw_angpol.dval)*sin(omega_g*time)+2*control->gw[kk].cgw_cosinc.dval*sin(2*control->gw[kk].cgw_angpol.dval)*cos(omega_g*time)))*resp + (control->gw[kk].cgw_h0.dval/omega_g*((1+pow(control->gw[kk].cgw_cosinc.dval,2))*sin(2*control->gw[kk].cgw_angpol.dval)*sin(omega_g*time)-2*control->gw[kk].cgw_cosinc.dval*cos(2*control->gw[kk].cgw_angpol.dval)*cos(omega_g*time)))*resc; 
+			  res_i = 0.0;
+			  if (dist[p]>0) // Add in the pulsar term  (NOTE: using subtraction here)
+			    {
+			      double omega_prime_g;
+			      double h0_prime;
 			  
-			  if (control->gw[kk].cgw_mc.dval == 0) {omega_prime_g = omega_g; h0_prime = control->gw[kk].cgw_h0.dval;}
-			  else {
-			    //			 omega_prime_g = omega_g - 2*M_PI*2.77e-8*pow(psr[p].cgw_mc/1e8,5.0/3.0)*pow(omega_g/2.0/M_PI/1e-7,11.0/3.0)*(psr[p].gwsrc_psrdist/PCM/1000.0)*(1-cosTheta);
+			      if (control->gw[kk].cgw_mc.dval == 0) {omega_prime_g = omega_g; h0_prime = control->gw[kk].cgw_h0.dval;}
+			      else {
+				//			 omega_prime_g = omega_g - 2*M_PI*2.77e-8*pow(psr[p].cgw_mc/1e8,5.0/3.0)*pow(omega_g/2.0/M_PI/1e-7,11.0/3.0)*(psr[p].gwsrc_psrdist/PCM/1000.0)*(1-cosTheta);
 			    
-			    omega_prime_g = 2*M_PI*pow((1-cosTheta)*dist[p]/SPEED_LIGHT*256.0/5.0/pow(SPEED_LIGHT,5)*pow(M_PI,8.0/3.0)*pow(GM*control->gw[kk].cgw_mc.dval,5.0/3.0)+pow(omega_g/2.0/M_PI,-8.0/3.0),-3.0/8.0);
+				omega_prime_g = 2*M_PI*pow((1-cosTheta)*dist[p]/SPEED_LIGHT*256.0/5.0/pow(SPEED_LIGHT,5)*pow(M_PI,8.0/3.0)*pow(GM*control->gw[kk].cgw_mc.dval,5.0/3.0)+pow(omega_g/2.0/M_PI,-8.0/3.0),-3.0/8.0);
 			    
-			    h0_prime = control->gw[kk].cgw_h0.dval*pow(omega_prime_g/omega_g,2.0/3.0);
-			    //			  printf("Using: omega_prime_g = %g, omega_g = %g, h0_prime = %g, h0 = %g\n",omega_prime_g,omega_g,h0_prime,psr[p].cgw_h0);
-			  }
-			  res_r -= ((h0_prime/omega_prime_g*((1+pow(control->gw[kk].cgw_cosinc.dval,2))*cos(2*control->gw[kk].cgw_angpol.dval)*sin(omega_prime_g*time-(1-cosTheta)*dist[p]/SPEED_LIGHT*omega_prime_g)+2*control->gw[kk].cgw_cosinc.dval*sin(2*control->gw[kk].cgw_angpol.dval)*cos(omega_prime_g*time-(1-cosTheta)*dist[p]/SPEED_LIGHT*omega_prime_g)))*resp 
-				    + (h0_prime/omega_prime_g*((1+pow(control->gw[kk].cgw_cosinc.dval,2))*sin(2*control->gw[kk].cgw_angpol.dval)*sin(omega_prime_g*time-(1-cosTheta)*dist[p]/SPEED_LIGHT*omega_prime_g)-2*control->gw[kk].cgw_cosinc.dval*cos(2*control->gw[kk].cgw_angpol.dval)*cos(omega_prime_g*time-(1-cosTheta)*dist[p]/SPEED_LIGHT*omega_prime_g)))*resc); 
-			}
-		      if ((1-cosTheta)==0.0)
-			{
-			  res_r = 0.0;
-			  res_i = 0.0;
+				h0_prime = control->gw[kk].cgw_h0.dval*pow(omega_prime_g/omega_g,2.0/3.0);
+				//			  printf("Using: omega_prime_g = %g, omega_g = %g, h0_prime = %g, h0 = %g\n",omega_prime_g,omega_g,h0_prime,psr[p].cgw_h0);
+			      }
+			      res_r -= ((h0_prime/omega_prime_g*((1+pow(control->gw[kk].cgw_cosinc.dval,2))*cos(2*control->gw[kk].cgw_angpol.dval)*sin(omega_prime_g*time-(1-cosTheta)*dist[p]/SPEED_LIGHT*omega_prime_g)+2*control->gw[kk].cgw_cosinc.dval*sin(2*control->gw[kk].cgw_angpol.dval)*cos(omega_prime_g*time-(1-cosTheta)*dist[p]/SPEED_LIGHT*omega_prime_g)))*resp 
+					+ (h0_prime/omega_prime_g*((1+pow(control->gw[kk].cgw_cosinc.dval,2))*sin(2*control->gw[kk].cgw_angpol.dval)*sin(omega_prime_g*time-(1-cosTheta)*dist[p]/SPEED_LIGHT*omega_prime_g)-2*control->gw[kk].cgw_cosinc.dval*cos(2*control->gw[kk].cgw_angpol.dval)*cos(omega_prime_g*time-(1-cosTheta)*dist[p]/SPEED_LIGHT*omega_prime_g)))*resc); 
+			    }
+			  if ((1-cosTheta)==0.0)
+			    {
+			      res_r = 0.0;
+			      res_i = 0.0;
+			    }
+			  else
+			    {
+			      res_r = -(1.0)/((2.0)*((1.0)-cosTheta))*(res_r); 
+			      res_i = -(1.0)/((2.0)*((1.0)-cosTheta))*(res_i); 
+			    }
+			  gwRes[i] = (res_r+res_i);
+			  mean+=gwRes[i];
 			}
-		      else
+		      else if (control->gw[kk].type==6)  // Cosmic string burst
 			{
-			  res_r = -(1.0)/((2.0)*((1.0)-cosTheta))*(res_r); 
-			  res_i = -(1.0)/((2.0)*((1.0)-cosTheta))*(res_i); 
-			}
-		      gwRes[i] = (res_r+res_i);
-		      mean+=gwRes[i];
-		    }
-		  else if (control->gw[kk].type==6)  // Cosmic string burst
-		    {
-		      long double dt,width,width_day;
-		      double res_r,res_i;
-		      double SPEED_LIGHT = 299792458.0; /*!< Speed of light (m/s)                       */
-		      double GM = 1.3271243999e20;      /*!< Gravitational constant * mass sun          */
-		      double n1,n2,n3;
-		      double e11p,e21p,e31p,e12p,e22p,e32p,e13p,e23p,e33p;
-		      double e11c,e21c,e31c,e12c,e22c,e32c,e13c,e23c,e33c;
-		      double cosTheta;
-		      double omega_g;
-		      
-		      omega_g = 2*M_PI*control->gw[kk].cgw_freq.dval;
-		      lambda_p = (double)ra_p;
-		      beta_p   = (double)dec_p;
-		      lambda   = control->gw[kk].ra.dval;
-		      beta   = control->gw[kk].dec.dval;
-		      // Pulsar vector
-		      n1 = cosl(lambda_p)*cosl(beta_p);
-		      n2 = sinl(lambda_p)*cosl(beta_p);
-		      n3 = sinl(beta_p);
-		      
-		      cosTheta = cosl(beta)*cosl(beta_p)*cosl(lambda-lambda_p)+
-			sinl(beta)*sinl(beta_p);
-		      
-		      // From KJ's paper
-		      // Gravitational wave matrix
-		      
-		      // NOTE: This is for the plus terms.  For cross should use different terms
-		      e11p = pow(sinl(lambda),2)-pow(cosl(lambda),2)*pow(sinl(beta),2);
-		      e21p = -sinl(lambda)*cosl(lambda)*(pow(sinl(beta),2)+1);
-		      e31p = cosl(lambda)*sinl(beta)*cosl(beta);
-		      
-		      e12p = -sinl(lambda)*cosl(lambda)*(pow(sinl(beta),2)+1);
-		      e22p = pow(cosl(lambda),2)-pow(sinl(lambda),2)*pow(sinl(beta),2);
-		      e32p = sinl(lambda)*sinl(beta)*cosl(beta);
-		      
-		      e13p = cosl(lambda)*sinl(beta)*cosl(beta);
-		      e23p = sinl(lambda)*sinl(beta)*cosl(beta);
-		      e33p = -powl(cosl(beta),2);
-		      
-		      resp = (n1*(n1*e11p+n2*e12p+n3*e13p)+
-			      n2*(n1*e21p+n2*e22p+n3*e23p)+
-			      n3*(n1*e31p+n2*e32p+n3*e33p));
-		      
-		      if ((1-cosTheta)==0.0)
-			resp = 0.0;  // Check if this is sensible
-		      else
-			resp = 1.0L/(2.0L*(1.0L-cosTheta))*(resp); 
-		      
-		      e11c = sin(2*lambda)*sin(beta);
-		      e21c = -cos(2*lambda)*sin(beta);
-		      e31c = -sin(lambda)*cos(beta);
-		      
-		      e12c = -cos(2*lambda)*sin(beta);
-		      e22c = -sin(2*lambda)*sin(beta);
-		      e32c = cos(lambda)*cos(beta);
-		      
-		      e13c = -sin(lambda)*cos(beta);
-		      e23c = cos(lambda)*cos(beta);
-		      e33c  = 0;
+			  double dt,width,width_day;
+			  double res_r,res_i;
+			  double SPEED_LIGHT = 299792458.0; /*!< Speed of light (m/s)                       */
+			  double GM = 1.3271243999e20;      /*!< Gravitational constant * mass sun          */
+			  double omega_g;
 		      
-		      resc = (n1*(n1*e11c+n2*e12c+n3*e13c)+
-			      n2*(n1*e21c+n2*e22c+n3*e23c)+
-			      n3*(n1*e31c+n2*e32c+n3*e33c));
-		      
-		      if ((1-cosTheta)==0.0)
-			resc = 0.0;  // Check if this is sensible
-		      else
-			resc = 1.0L/(2.0L*(1.0L-cosTheta))*(resc); 
+			  omega_g = 2*M_PI*control->gw[kk].cgw_freq.dval;
 
 		      
-		      dt = (control->psr[p].obs[i].sat - control->gw[kk].gwcsEpoch.dval)*86400.0L;
-		      width = control->gw[kk].gwcsWidth.dval*86400.0;
-		      width_day = control->gw[kk].gwcsWidth.dval;
+			  dt = epochSeconds(control->psr[p].toa.sat[i],epochFromMJD(control->gw[kk].gwcsEpoch.dval));
+			  width = control->gw[kk].gwcsWidth.dval*86400.0;
+			  width_day = control->gw[kk].gwcsWidth.dval;
 
-		      if (control->psr[p].obs[i].sat < control->gw[kk].gwcsEpoch.dval-width_day/2.0)
-			gwRes_p[i] = gwRes_c[i] = 0;
-		      else if (control->psr[p].obs[i].sat <= control->gw[kk].gwcsEpoch.dval)
-			{
-			  gwRes_p[i] = control->gw[kk].gwcsAmp1.dval*(3.0/4.0*(pow(0.5*width,4.0/3.0)-pow(fabs(dt),4.0/3.0))-pow(0.5*width,1.0/3.0)*(dt+0.5*width));
-			  gwRes_c[i] = control->gw[kk].gwcsAmp2.dval*(3.0/4.0*(pow(0.5*width,4.0/3.0)-pow(fabs(dt),4.0/3.0))-pow(0.5*width,1.0/3.0)*(dt+0.5*width));
-			}
-		      else if (control->psr[p].obs[i].sat <= control->gw[kk].gwcsEpoch.dval+width_day/2.0)
-			{
-			  gwRes_p[i] = control->gw[kk].gwcsAmp1.dval*(3.0/4.0*(pow(0.5*width,4.0/3.0)+pow(fabs(dt),4.0/3.0))-pow(0.5*width,1.0/3.0)*(dt+0.5*width));
-			  gwRes_c[i] = control->gw[kk].gwcsAmp2.dval*(3.0/4.0*(pow(0.5*width,4.0/3.0)+pow(fabs(dt),4.0/3.0))-pow(0.5*width,1.0/3.0)*(dt+0.5*width));
-			}
-		      else
-			{
-			  gwRes_p[i]=-0.25*(pow(0.5,1.0/3.0)*control->gw[kk].gwcsAmp1.dval*pow(width,4.0/3.0));
-			  gwRes_c[i]=-0.25*(pow(0.5,1.0/3.0)*control->gw[kk].gwcsAmp2.dval*pow(width,4.0/3.0));
+			  if (epochMJD(control->psr[p].toa.sat[i]) < control->gw[kk].gwcsEpoch.dval-width_day/2.0)
+			    gwRes_p[i] = gwRes_c[i] = 0;
+			  else if (epochMJD(control->psr[p].toa.sat[i]) <= control->gw[kk].gwcsEpoch.dval)
+			    {
+			      gwRes_p[i] = control->gw[kk].gwcsAmp1.dval*(3.0/4.0*(pow(0.5*width,4.0/3.0)-pow(fabs(dt),4.0/3.0))-pow(0.5*width,1.0/3.0)*(dt+0.5*width));
+			      gwRes_c[i] = control->gw[kk].gwcsAmp2.dval*(3.0/4.0*(pow(0.5*width,4.0/3.0)-pow(fabs(dt),4.0/3.0))-pow(0.5*width,1.0/3.0)*(dt+0.5*width));
+			    }
+			  else if (epochMJD(control->psr[p].toa.sat[i]) <= control->gw[kk].gwcsEpoch.dval+width_day/2.0)
+			    {
+			      gwRes_p[i] = control->gw[kk].gwcsAmp1.dval*(3.0/4.0*(pow(0.5*width,4.0/3.0)+pow(fabs(dt),4.0/3.0))-pow(0.5*width,1.0/3.0)*(dt+0.5*width));
+			      gwRes_c[i] = control->gw[kk].gwcsAmp2.dval*(3.0/4.0*(pow(0.5*width,4.0/3.0)+pow(fabs(dt),4.0/3.0))-pow(0.5*width,1.0/3.0)*(dt+0.5*width));
+			    }
+			  else
+			    {
+			      gwRes_p[i]=-0.25*(pow(0.5,1.0/3.0)*control->gw[kk].gwcsAmp1.dval*pow(width,4.0/3.0));
+			      gwRes_c[i]=-0.25*(pow(0.5,1.0/3.0)*control->gw[kk].gwcsAmp2.dval*pow(width,4.0/3.0));
+			    }
+			  printf("Have gwcs %g %g %g %g %g %g\n",gwRes_p[i],resp,gwRes_c[i],resc,epochMJD(control->psr[p].toa.sat[i]),(double)control->gw[kk].gwcsEpoch.dval);
+			  gwRes[i] = gwRes_p[i]*resp+gwRes_c[i]*resc;
+			  mean+=gwRes[i];
 			}
-		      printf("Have gwcs %g %g %g %g %g %g\n",gwRes_p[i],resp,gwRes_c[i],resc,(double)control->psr[p].obs[i].sat,(double)control->gw[kk].gwcsEpoch.dval);
-		      gwRes[i] = gwRes_p[i]*resp+gwRes_c[i]*resc;
-		      mean+=gwRes[i];
-		    }
 
-		}
+		    }
 		
-	    }
+		}
 	
-	  mean /= (double)control->psr[p].nToAs;
-	  for (i=0;i<control->psr[p].nToAs;i++)
-	    {
-	      epochs[i]=(double)control->psr[p].obs[i].sat;
-	      offsets[i] = (double)((gwRes[i]-mean));
-	      printf("offsetsGW = %g\n",offsets[i]);
+	      mean /= (double)control->psr[p].nToAs;
+	      for (i=0;i<control->psr[p].nToAs;i++)
+		{
+		  epochs[i]=epochMJD(control->psr[p].toa.sat[i]);
+		  offsets[i] = (double)((gwRes[i]-mean));
+		  printf("offsetsGW = %g\n",offsets[i]);
+		}
+	      //      exit(1);
+	      // remove quadratic to make the total variation smaller.
+	      TKremovePoly_d(epochs,offsets,control->psr[p].nToAs,2);
+	      printf("Writing corr\n");
+	      toasim_write_corrections(corr,header,file);
+	      printf("Done\n");
 	    }
-	  //      exit(1);
-	  // remove quadratic to make the total variation smaller.
-	  TKremovePoly_d(epochs,offsets,control->psr[p].nToAs,2);
-	  printf("Writing corr\n");
-	  toasim_write_corrections(corr,header,file);
-	  printf("Done\n");
 	  fclose(file);
 	}
+      if (control->gw[kk].type==1)
+	free(gw);
+      if (control->gw[kk].type==7)
+	free(coeffs);
+      if (control->gw[kk].type==5)
+	{
+	  free(angpol_g);
+	  free(lambda_g);
+	  free(beta_g);
+	}
     }
-  if (control->gw[kk].type==5)
-    {
-      free(h0_g);
-      free(omega_g);
-      free(angpol_g);
-      free(lambda_g);
-      free(beta_g);
-      free(skyInc_g);
-    }
+  arenaRelease(&(control->scratch),mark);
+  free(corr);
 }
 
-double calcDiffractiveScint(controlStruct *control,int s0,int j,int sys)
+double calcDiffractiveScint(controlStruct *control,int s0,int j,int sys,int realisation)
 {
   double nScintD;
   int nScint;
@@ -5135,14 +5357,15 @@ double calcDiffractiveScint(controlStruct *control,int s0,int j,int sys)
   int s;
   double flux;
   int fClosest;
+  TKstream stream;
 
   if (s0==-1)
     {
       p=sys;
       s=-1;
-      freq=control->psr[p].obs[j].freq.dval;
-      r=control->psr[p].obs[j].rcvrNum;
-      b=control->psr[p].obs[j].beNum;      
+      freq=control->psr[p].toa.freq[j];
+      r=control->psr[p].toa.rcvrNum[j];
+      b=control->psr[p].toa.beNum[j];      
     }
   else
     {
@@ -5163,8 +5386,10 @@ double calcDiffractiveScint(controlStruct *control,int s0,int j,int sys)
 
     }
 
-  tobs = control->psr[p].obs[control->psr[p].nToAs].tobs.dval;
+  tobs = control->psr[p].toa.tobs[control->psr[p].nToAs];
   printf("Calc scint: tobs = %g ntoas = %d p=%d j=%d freq=%g\n",tobs,control->psr[p].nToAs,p,j,freq);
+  // Keyed by the ToA that is being created
+  TKstreamInit(&stream,control->seed,realisation,p,RAN_SCINT,(s0==-1) ? j : control->psr[p].nToAs);
 
   bw = control->be[b].bw.dval*1e6;
 
@@ -5201,7 +5426,7 @@ double calcDiffractiveScint(controlStruct *control,int s0,int j,int sys)
 
   expon=0;
   for (jj=0;jj<nScint;jj++)
-    expon += -flux*log(TKranDev(&control->seed));  
+    expon += -flux*log(TKstreamRanDev(&stream));  
   expon/=(double)nScint;
   printf("Expon = %g %g\n",expon,expon/flux);
   return expon/flux;
@@ -5209,7 +5434,7 @@ double calcDiffractiveScint(controlStruct *control,int s0,int j,int sys)
 
 double calculateToaErrRadiometer(controlStruct *control,int s0,int j,int sys,double scale,int realisation)
 {
-  static int counter=0;
+  static __thread int counter=0; // One counter per realisation worker
   double flux;
   double freq;
   double tsys=20; // Recevier parameter
@@ -5218,14 +5443,12 @@ double calculateToaErrRadiometer(controlStruct *control,int s0,int j,int sys,dou
   // AND RECORDED IN THE PSR OBSERVATION VALUE!
   double deltaf; // Observation parameter
   double tsky=0; // External information
-  int nbin=4096; // Backend parameter
-  double prof[nbin];
-  double templ[nbin];
-  double phase;
+  int nbin; // Backend parameter
+  double *prof,*templ,*noise,*phase;
+  const double *storedProf,*storedTempl;
+  arenaMark mark;
   int i;
-  char expression[MAX_STRLEN];
   double radNoise;
-  int errorFlag=0;
   double sum=0.0;
   double toaErr;
   int p;
@@ -5238,6 +5461,7 @@ double calculateToaErrRadiometer(controlStruct *control,int s0,int j,int sys,dou
   double diff;
   int closestProf=-1;
   int tskyClosest;
+  TKstream stream;
 
   if (s0!=-1)
     {
@@ -5248,12 +5472,13 @@ double calculateToaErrRadiometer(controlStruct *control,int s0,int j,int sys,dou
     {
       p = sys;
     }
-  tobs = control->psr[p].obs[control->psr[p].nToAs].tobs.dval;
+  tobs = control->psr[p].toa.tobs[control->psr[p].nToAs];
+  TKstreamInit(&stream,control->seed,realisation,p,RAN_PROFILE,(s0==-1) ? j : control->psr[p].nToAs);
   if (s0 == -1)
     {
-      freq = control->psr[p].obs[j].freq.dval;
-      r=control->psr[p].obs[j].rcvrNum;
-      b=control->psr[p].obs[j].beNum;
+      freq = control->psr[p].toa.freq[j];
+      r=control->psr[p].toa.rcvrNum[j];
+      b=control->psr[p].toa.beNum[j];
       printf("Using: %g %d %d\n",freq,r,b);
     }
   else
@@ -5327,35 +5552,57 @@ double calculateToaErrRadiometer(controlStruct *control,int s0,int j,int sys,dou
   printf("Trying: %d %d %d %d %d %g %g %d %g %g\n",p,r,b,s0,j,tsys,gain,nbin,deltaf,flux);
   radNoise = (tsys+tsky)/(gain)/sqrt(2.0*(tobs/nbin)*deltaf);
   printf("radNoise = %s %g %g %d %d\n",control->psr[p].name,radNoise,tobs,p,j);
-  
+
+  // The expected error follows from the S/N, unless a noisy profile should
+  // be simulated and fitted
+  if (control->radiometerMode == RADIOMETER_ANALYTIC && control->dumpProfiles == 0)
+    return radiometerToaErr(control,p,closestProf,nbin,flux,radNoise);
+
+  mark = arenaGetMark(&(control->scratch));
+  prof = (double *)arenaAlloc(&(control->scratch),sizeof(double)*nbin*4);
+  templ = prof+nbin;
+  noise = prof+2*nbin;
+  phase = prof+3*nbin;
   if (control->psr[p].nProfileFile==0)
     {      
       for (i=0;i<nbin;i++)
-	{
-	  sprintf(expression,"x=%g; v=%s;",i/(double)nbin,control->psr[p].profileEqn);
-	  errorFlag = runEvaluateExpression(expression,control);      
-	  prof[i] = variable[0].value;
-	}
+	phase[i] = i/(double)nbin;
+      evaluateValueArray(control->psr[p].profileEqn,phase,prof,nbin,&(control->expr));
+      memcpy(templ,prof,sizeof(double)*nbin); // The noise-free profile is the template
     }
   else
-    loadProfileFromFile(prof,templ,nbin,control->psr[p].profileFile[closestProf]);
+    {
+      profileStoreGet(control->psr[p].profileFile[closestProf],nbin,&storedProf,&storedTempl);
+      memcpy(prof,storedProf,sizeof(double)*nbin);
+      memcpy(templ,storedTempl,sizeof(double)*nbin);
+    }
 
   for (i=0;i<nbin;i++)
     {
       sum+=prof[i];
     }
+  TKgaussDevFill(&stream,noise,nbin);
   for (i=0;i<nbin;i++)
     {
       //      templ[i]=prof[i]; //*(flux/sum)*nbin;
 
-      prof[i] = prof[i]*(flux/sum)*nbin + TKgaussDev(&(control->seed))*radNoise;
+      prof[i] = prof[i]*(flux/sum)*nbin + noise[i]*radNoise;
       //       printf("prof = %d %g %g\n",i,variable[0].value,prof[i]);
     }
-  sprintf(fileOut,"%s.%g.%g.%d.%d.%d.%d.%d.prof",control->psr[p].name,freq,tobs,s0,j,sys,realisation,counter);
-  fout = fopen(fileOut,"w");
-  for (i=0;i<nbin;i++)
-    fprintf(fout,"%d %g\n",i,prof[i]);
-  fclose(fout);
+  if (control->dumpProfiles)
+    {
+      sprintf(fileOut,"%s.%g.%g.%d.%d.%d.%d.%d.prof",control->psr[p].name,freq,tobs,s0,j,sys,realisation,counter);
+      fout = fopen(fileOut,"w");
+      for (i=0;i<nbin;i++)
+	fprintf(fout,"%d %g\n",i,prof[i]);
+      fclose(fout);
+    }
+  if (control->radiometerMode == RADIOMETER_ANALYTIC)
+    {
+      arenaRelease(&(control->scratch),mark);
+      counter++;
+      return radiometerToaErr(control,p,closestProf,nbin,flux,radNoise);
+    }
 
 
   //
@@ -5366,6 +5613,7 @@ double calculateToaErrRadiometer(controlStruct *control,int s0,int j,int sys,dou
   toaErr = getToaErr(prof,templ,nbin)*control->psr[p].p0;
   //  printf("toaErr = %g\n",toaErr);
   //  exit(1);
+  arenaRelease(&(control->scratch),mark);
   counter++;
   return toaErr;
 }
@@ -5384,387 +5632,6 @@ double getToaErr(double *prof,double *templ,int nbin)
 }
 
 
-
-
-void fftfit(double *prof,double *standard,int nmax,double *shift,double *eshift,
-	    double *snr,double *esnr,double *b,double *errb,int *ngood)
-{
-  int nh,i,j,k;
-  double sum,ave,errtau;
-  double s[10000],phi[10000];   /* Transform of template */
-  double p[10000],theta[10000]; /* Transform of profile  */
-  double tmp[10000],r[10000],fac;
-  double tau,s1,s2,s3,cosfac,sq,rms;
-  int isum;
-  int nsum,ntries;
-  double edtau,ftau,a,fa,dtau,fb;
-  int low,high;
-
-  /* Obtain Fourier transform of template */
-  fft(standard,nmax,s,phi);
-
-  nh = nmax/2;
-  sum=0.0;
-  for (i=nh/2+1;i<=nh;i++)
-    sum+=s[i];
-  ave=2.0*sum/nh;
-
-  for (i=1;i<=nh;i++)
-    if (s[i] < ave) break;
-  *ngood=i-1;
-  //  printf("Test 1: %g %d\n",ave,*ngood);
-
-  /*  *ngood = 89; */ /* SET IT EQUAL TO FORTRAN VERSION __ WHAT IS WRONG ? */
-
-  //  printf("Ngood = %d %d %f %f\n",*ngood,nmax,ave,sum);
-
-  /* Obtain Fourier transform of profile */
-  fft(prof,nmax,p,theta);
-
-  for (k=0;k<nh;k++)
-    {
-      tmp[k]=p[k]*s[k];
-      r[k]=theta[k]-phi[k];
-    }
-
-  fac = nmax/(2.0*M_PI);
-  //  printf("Test 2: %g\n",fac);
-  //  printf("fac = %f\n",fac);
-  fccf(tmp,r,shift,nmax);
-  //  printf("From fccf, shift = %f\n",*shift);
-  //  printf("Test 3: %g\n",*shift);
-  tau = *shift;
-  for (isum=5;isum<99;isum++)
-    {
-      nsum=(int)pow(2,isum);
-      if (nsum>nh) break;
-      dtau = (2.0*M_PI)/(nsum*5);
-      edtau = 1.0/(2.0*nsum+1.0);
-      if (nsum > (nh/2.+0.5)) edtau = 1.0e-4;
-
-      ntries = 0;
-      low = -1;
-      high = -1;
-      do {
-	ftau = dchisqr(tau,tmp,r,nsum);
-	ntries++;
-	if (ftau < 0)
-	  {
-	    a=tau;
-	    fa=ftau;
-	    tau+=dtau;
-	    low=1;
-	  }
-	else
-	  {
-	    *b=tau;
-	    fb=ftau;
-	    tau=tau-dtau;
-	    high = 1;	  
-	  }
-	if (ntries>10)
-	  {
-	    *shift=0.0;
-	    *eshift=999.0;
-	    *snr=0.0;
-	    *esnr=0.0;
-	    return;
-	  }
-      }	while (low!=high);
-      tau = zbrent(a,*b,fa,fb,edtau,tmp,r,nsum);
-    }
-  s1=0.0;
-  s2=0.0;
-  s3=0.0;
-  for (k=1;k<=nh;k++)  /* SHOULD THIS START FROM 0 */
-    {
-      cosfac = cos(-r[k]+k*tau);
-      s1=s1+tmp[k]*cosfac;
-      s2=s2+s[k]*s[k];
-      s3=s3+k*k*tmp[k]*cosfac;
-    }
-
-  *b=s1/s2;
-  //  printf("b= %g\n",*b);
-  s1=0.0;
-  
-  for (k=1;k<=nh;k++)
-    {
-      sq = p[k]*p[k]-2.0*(*b)*p[k]*s[k]*cos(r[k]-k*tau)+pow((*b)*s[k],2);
-      s1+=sq;
-    }
-  rms =sqrt(s1/nh);
-  *errb = rms/sqrt(2.0*s2);
-  errtau = rms/sqrt(2.0*(*b)*s3);
-  *snr = 2.0*sqrt(2.0*nh)*(*b)/rms;
-  *shift = fac*tau;
-  *eshift = fac*(errtau);
-  *esnr = *snr*(*errb)/(*b);
-  
-  return;
-}
-
-double dchisqr(double tau,double *tmp,double *r,int nsum)
-{
-  int k;
-  double s;
-
-  s=0.0;
-  for (k=1;k<=nsum;k++)
-    s+=k*tmp[k]*sin(-r[k]+k*tau);
-
-  return s;
-
-}
-
-
-void fccf(double *amp,double *pha,double *shift,int nprof)
-{
-  /* nprof = 64 in the fccf.f program ??? */
-  int nh,i;
-  double ccf[5000];
-  double cmax,rc,fb,fa,fc;
-  double cReal[5000],cImag[5000];
-  int imax,ia,ic;
-
-  nprof = 64;
-
-  nh = nprof/2;
-  ccf[0]=0;
-  ccf[1]=0;
-  for (i=1;i<=nh/2;i++)
-    {
-      ccf[2*i] = amp[i]*cos(pha[i]);
-      ccf[2*i+1] = amp[i]*sin(pha[i]);
-      ccf[2*nprof-(2*i)] = amp[i]*cos(pha[i]);
-      ccf[2*nprof-(2*i-1)] = -amp[i]*sin(pha[i]);
-    }
-  for (i=nh/2+1;i<=nh;i++)
-    {
-      ccf[2*i]=0.0;
-      ccf[2*i+1]=0.0;
-      ccf[2*nprof-(2*i)]=0.0;
-      ccf[2*nprof-(2*i-1)]=0.0;
-    }
-
-  four1(ccf-1,nprof,-1);
-
-  for (i=0;i<=nprof;i++)
-    {
-      cReal[i]=ccf[2*i];
-      cImag[i]=ccf[2*i+1];
-    }
-  
-  cmax = -1.0e30;
-  for (i=0;i<nprof;i++)
-    {
-      rc = ccf[2*i];
-      if (rc>cmax)
-	{
-	  cmax= rc;
-	  imax = i;
-	}
-    }
-  fb = cmax;
-  //  printf("fb = %f\n",fb);
-  ia = imax-1;
-  if (ia==-1) ia=nprof-1;
-  fa=ccf[ia*2];
-  ic=imax+1;
-  if (ic==nprof) ic=0;
-  fc=ccf[ic*2];
-  if ((2*fb-fc-fa)!=0.0)
-    *shift=imax+0.5*(fa-fc)/(2*fb-fc-fa);
-  else
-    *shift=imax;
-  if (*shift>nh) *shift-=nprof;
-  *shift=*shift*(2.0*M_PI)/nprof;
-
-}
-
-void fft(double *y,int nmax,double *amp,double *pha)
-{
-  double temp[5000];
-  int i;
-
-  for (i=0;i<nmax;i++)
-    {
-      temp[2*i]  =y[i];
-      temp[2*i+1]=0.0;  /* profile is real */
-    }
-  four1(temp-1,nmax,1);
-  for (i=0;i<nmax/2;i++)
-    {
-      amp[i] = 2*sqrt(pow(temp[2*i],2)+pow(temp[2*i+1],2));
-      pha[i] = atan2(temp[2*i+1],temp[2*i]);
-      /*      printf("%d %f\n",i,temp[2*i]);*/
-    }
-  /*  exit(1); */
-}
-
-
-void four1(double data[], unsigned long nn, int isign)
-{
-  unsigned long n,mmax,m,j,istep,i;
-  double wtemp,wr,wpr,wpi,wi,theta;
-  double tempr,tempi;
-  
-  n=nn << 1;
-  j=1;
-  for (i=1;i<n;i+=2) {
-    if (j > i) {
-      SWAP(data[j],data[i]);
-      SWAP(data[j+1],data[i+1]);
-    }
-    m=n >> 1;
-    while (m >= 2 && j > m) {
-      j -= m;
-      m >>= 1;
-    }
-    j += m;
-  }
-  mmax=2;
-  while (n > mmax) {
-    istep=mmax << 1;
-    theta=isign*(6.28318530717959/mmax);
-    wtemp=sin(0.5*theta);
-    wpr = -2.0*wtemp*wtemp;
-    wpi=sin(theta);
-    wr=1.0;
-    wi=0.0;
-    for (m=1;m<mmax;m+=2) {
-      for (i=m;i<=n;i+=istep) {
-	j=i+mmax;
-	tempr=wr*data[j]-wi*data[j+1];
-	tempi=wr*data[j+1]+wi*data[j];
-	data[j]=data[i]-tempr;
-	data[j+1]=data[i+1]-tempi;
-	data[i] += tempr;
-	data[i+1] += tempi;
-      }
-      wr=(wtemp=wr)*wpr-wi*wpi+wr;
-      wi=wi*wpr+wtemp*wpi+wi;
-    }
-    mmax=istep;
-  }
-}
-
-double zbrent(double x1,double x2,double f1,double f2,double tol,double *tmp,
-	      double *pha,int nsum)
-{
-  double a,b,c,d,e,fa,fb,fc,tol1,xm,p,q,r;
-  int iter;
-  int itmax=100;
-  double eps=6.0e-8,s;
-
-  a=x1;
-  b=x2;
-  fa=f1;
-  fb=f2;
-  fc=fb;
-
-  for (iter=1;iter<=itmax;iter++)
-    {
-      if (fb*fc>0)
-	{
-	  c=a;
-	  fc=fa;
-	  d=b-a;
-	  e=d;
-	}
-      if (fabs(fc)<fabs(fb))
-	{
-	  a=b;
-	  b=c;
-	  c=a;
-	  fa=fb;
-	  fb=fc;
-	  fc=fa;
-	}
-      tol1 = 2.0*eps*fabs(b)+0.5*tol;
-      xm=0.5*(c-b);
-      if (fabs(xm)<=tol1 || fb==0)
-	return b;
-      
-      if (fabs(e)>=tol1 && fabs(fa)>fabs(fb))
-	{
-	  s=fb/fa;
-	  if (a==c)
-	    {
-	      p=2.0*xm*s;
-	      q=1.0-s;
-	    }
-	  else
-	    {
-	      q=fa/fc;
-	      r=fb/fc;
-	      p=s*(2.0*xm*q*(q-r)-(b-a)*(r-1.0));
-	      q=(q-1.0)*(r-1.0)*(s-1.0);     
-	    }
-	  if (p>0.0)q=-q;
-	  p=fabs(p);
-	  if (2.0*p < min(3.0*xm*q-fabs(tol1*q),fabs(e*q)))
-	    {
-	      e=d;
-	      d=p/q;
-	    }
-	  else
-	    {
-	      d=xm;
-	      e=d;
-	    }
-	}
-      else
-	{
-	  d=xm;
-	  e=d;
-	}
-      a=b;
-      fa=fb;
-      if (fabs(d) > tol1)
-	b=b+d;
-      else
-	b=b+sign(tol1,xm);
-
-      fb=dchisqr(b,tmp,pha,nsum);
-    }
-  return b;
-}
-
-double sign(double a,double b)
-{
-  if (b>0)
-    return fabs(a);
-  else
-    return -fabs(a);
-}
-
-double min(double a,double b)
-{
-  if (a<b)
-    return a;
-  else
-    return b;
-}
-
-void loadProfileFromFile(double *prof,double *templ,int nbin,char *fname)
-{
-  tmplStruct template;
-  int i;
-
-  initialiseTemplate(&template);
-  readTemplate(fname,&template);
-  
-  for (i=0;i<nbin;i++)
-    prof[i] = evaluateTemplateChannel(&template,(double)i/(double)nbin,0,0,0);
-
-  //  template.channel[0].pol[0].comp[0].concentration = 500;
-  for (i=0;i<nbin;i++)
-    templ[i] = evaluateTemplateChannel(&template,(double)i/(double)nbin,0,0,0.2);
-
-
-}
-
 void readT2TimFile(controlStruct *control,int or,int t2Num,int r)
 {
   FILE *fin;
@@ -5807,6 +5674,7 @@ void readT2TimFile(controlStruct *control,int or,int t2Num,int r)
 		  char temp[1024];
 		  int nobs;
 		  nobs = control->psr[p].nToAs;
+		  reserveToAs(control,p,nobs+1);
 
 		  if (sscanf(line,"%s %lf %Lf %lf %s",temp,&freq,&sat,&toaErr,telCode)==5)
 		    {
@@ -5816,24 +5684,25 @@ void readT2TimFile(controlStruct *control,int or,int t2Num,int r)
 			control->minT = (double)sat;
 
 		      // Now look for flags
+		      control->psr[p].toa.rcvrNum[nobs] = 0;
+		      control->psr[p].toa.beNum[nobs] = 0;
 		      if (strstr(line,"-tobs")!=NULL)
 			{
-			  char *tok;
+			  char *tok,*save;
 			  char tt[1024];
 			  strcpy(tt,strstr(line,"-tobs"));
-			  tok = strtok(tt," \n");
-			  tok = strtok(NULL," \n");
-			  sscanf(tok,"%lf",&(control->psr[p].obs[nobs].tobs.dval));
-			  control->psr[p].obs[nobs].tobs.set = 1;
+			  tok = strtok_r(tt," \n",&save);
+			  tok = strtok_r(NULL," \n",&save);
+			  sscanf(tok,"%lf",&(control->psr[p].toa.tobs[nobs]));
 			}
 		      if (strstr(line,"-rcvr")!=NULL)
 			{
-			  char *tok;
+			  char *tok,*save;
 			  char tt[1024];
 			  int k,r0=-1;
 			  strcpy(tt,strstr(line,"-rcvr"));
-			  tok = strtok(tt," \n");
-			  tok = strtok(NULL," \n");
+			  tok = strtok_r(tt," \n",&save);
+			  tok = strtok_r(NULL," \n",&save);
 			  printf("Got recevier : %s\n",tok);
 			  for (k=0;k<control->nRCVR;k++)
 			    {
@@ -5845,16 +5714,16 @@ void readT2TimFile(controlStruct *control,int or,int t2Num,int r)
 			      printf("Unable to find receiver with name %s\n",tok);
 			      finishOff(control);
 			    }
-			  control->psr[p].obs[nobs].rcvrNum = r0;
+			  control->psr[p].toa.rcvrNum[nobs] = r0;
 			}
 		      if (strstr(line,"-ptaSimbe")!=NULL)
 			{
-			  char *tok;
+			  char *tok,*save;
 			  char tt[1024];
 			  int k,b0=-1;
 			  strcpy(tt,strstr(line,"-ptaSimbe"));
-			  tok = strtok(tt," \n");
-			  tok = strtok(NULL," \n");
+			  tok = strtok_r(tt," \n",&save);
+			  tok = strtok_r(NULL," \n",&save);
 			  printf("Got recevier : %s\n",tok);
 			  for (k=0;k<control->nBE;k++)
 			    {
@@ -5866,23 +5735,25 @@ void readT2TimFile(controlStruct *control,int or,int t2Num,int r)
 			      printf("Unable to find backend with name %s\n",tok);
 			      finishOff(control);
 			    }
-			  control->psr[p].obs[nobs].beNum = b0;
+			  control->psr[p].toa.beNum[nobs] = b0;
 			}
 
-		      strcpy(control->psr[p].obs[nobs].tel,telCode);
-		      control->psr[p].obs[nobs].freq.dval = freq;
-		      control->psr[p].obs[nobs].freq.set = 1;
-		      control->psr[p].obs[nobs].sat = sat;
-		      control->psr[p].obs[nobs].satSet = 1;
+		      control->psr[p].toa.tel[nobs] = toaTelescopeId(&(control->psr[p].toa),telCode);
+		      control->psr[p].toa.obsRun[nobs] = or;
+		      control->psr[p].toa.sched[nobs] = -1;
+		      control->psr[p].toa.schedObs[nobs] = -1;
+		      control->psr[p].toa.obsSysNum[nobs] = -1;
+		      control->psr[p].toa.freq[nobs] = freq;
+		      control->psr[p].toa.sat[nobs] = epochFromMJD(sat);
 		      fillDval(&(control->obsRun[or].T2Tim[t2Num].efac),control);
 		      fillDval(&(control->obsRun[or].T2Tim[t2Num].equad),control);
-		      control->psr[p].obs[nobs].efac.dval = control->obsRun[or].T2Tim[t2Num].efac.dval;
-		      control->psr[p].obs[nobs].equad.dval = control->obsRun[or].T2Tim[t2Num].equad.dval;
+		      control->psr[p].toa.efac[nobs] = control->obsRun[or].T2Tim[t2Num].efac.dval;
+		      control->psr[p].toa.equad[nobs] = control->obsRun[or].T2Tim[t2Num].equad.dval;
+		      control->psr[p].toa.dmErr[nobs] = 0;
 
 		      if (control->obsRun[or].T2Tim[t2Num].toaErr.set==0)
 			{
-			  control->psr[p].obs[nobs].toaErr.dval = toaErr/1e6;
-			  control->psr[p].obs[nobs].toaErr.set = 1;
+			  control->psr[p].toa.toaErr[nobs] = toaErr/1e6;
 			}
 		      else
 			{
@@ -5897,19 +5768,18 @@ void readT2TimFile(controlStruct *control,int or,int t2Num,int r)
 			      if (control->psr[p].setDiff_df==1
 				  && control->psr[p].setDiff_ts==1)
 				//				scale = calcDiffractiveScint(control,s0,j,sys);
-				scale = calcDiffractiveScint(control,-1,nobs,p);
+				scale = calcDiffractiveScint(control,-1,nobs,p,r);
 			      else
 				scale=1;
 
 			      
-			      control->psr[p].obs[nobs].toaErr.dval = calculateToaErrRadiometer(control,-1,nobs,p,scale,r);
+			      control->psr[p].toa.toaErr[nobs] = calculateToaErrRadiometer(control,-1,nobs,p,scale,r);
 			    }
 			  else
 			    {
 			      fillDval(&(control->obsRun[or].T2Tim[t2Num].toaErr),control);
-			      control->psr[p].obs[nobs].toaErr.dval = control->obsRun[or].T2Tim[t2Num].toaErr.dval;
+			      control->psr[p].toa.toaErr[nobs] = control->obsRun[or].T2Tim[t2Num].toaErr.dval;
 			    }
-			  control->psr[p].obs[nobs].toaErr.set = 1;
 			}
 		      (control->psr[p].nToAs)++;
 		    }
@@ -5943,6 +5813,7 @@ void readObservatoryPositions(controlStruct *control)
 	{
 	  if (line[0]!='#')
 	    {
+	      GROW_TABLE(control,control->observatory,control->nObservatoryAlloc,n);
 	      if (sscanf(line,"%lf %lf %lf %s %s",&(control->observatory[n].posX),
 			 &(control->observatory[n].posY),&(control->observatory[n].posZ),
 			 control->observatory[n].name1,control->observatory[n].name2)==5)
@@ -5988,9 +5859,9 @@ long double fortran_mod(long double a,long double p)
   return ret;
 }
 
-double BTmodel(double pb,double ecc,double a1,double t0,double om,long double t)
+double BTmodel(double pb,double ecc,double a1,double t0,double om,toaEpoch t)
 {
-  long double tt0;
+  double tt0;
   double edot=0;
   double pbdot=0;
   double xpbdot=0;
@@ -6004,7 +5875,7 @@ double BTmodel(double pb,double ecc,double a1,double t0,double om,long double t)
   double ep,dep,bige,som,com,alpha,beta,sbe,cbe,q,r,s,tt;
   int norbits;
 
-  tt0 = (t - t0)*SECDAY;
+  tt0 = epochSeconds(t,epochFromMJD(t0));
 
   pb     = pb*SECDAY;
   ecc    = ecc + edot*tt0;
@@ -1,40 +1,65 @@
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include "T2toolkit.h"
+#include "arena.h"
+#include "epoch.h"
+#include "evalcomp.h"
 
 #define MAX_STRLEN 1024
 #define MAX_CUTS 10 // Number of cuts that can be made to a data set
-#define MAX_OUTPUT 10 // Maximum number of output definitions
 #define MAX_LABELS 50 // Maximum number of labels for output definitions
 #define MAX_PARAMS 40 // Maximum number of parameters in an ephemeris
-#define MAX_PSRS 50 // Maximum number of pulsars
 #define MAX_LINE_PARAMS 20 // Maximum number of parameters on a script line
-#define MAX_OBSRUN 30 // Maximum number of observation runs
-#define MAX_SCHED 100 // Maximum number of schedules
-#define MAX_OBS_SCHED 100 // Maximum number of observations in schedule
-#define MAX_TOAS 2000 // Maximum number of ToAs per pulsar
-#define MAX_TNOISE 50 // Maximum number of timing noise definitions
-#define MAX_PLANETS 50 // Maximum number of planets
-#define MAX_RCVR 20 // Maximum number of receivers
-#define MAX_BE 20 // Maximum number of backends
 #define MAX_FLUX 10 // Maximum flux density values per pulsar
 #define MAX_TSKY 10 // Maximum tsky values per pulsar
 #define MAX_PROF_FILE 10 // Maximum number of profiles per pulsar
-#define MAX_DMVAR 50 // Maximum number of DM variations definitions
-#define MAX_DMCOVAR 50 // Maximum number of DM covariance definitions
-#define MAX_DMFUNC 50 // Maximum number of DM function definitions
-#define MAX_JITTER 50 // Maximum number of jitter definitions
 #define MAX_SYS 5 // Maximum number of simultaneous systems in a given obsSys
 #define MAX_BEOFFSETS 10 // Maximum number of backend offsets
-#define MAX_OBS_SYS 10 
-#define MAX_FDIST_VALS 5000
-#define MAX_T2TIM 50 // Maximum number of tempo2 tim files
-#define MAX_GLITCHES 10 // Maximum number of glitches in total
-#define MAX_OBSERVATORIES 100 // Maximum number of observatories in observatories.dat file
 #define DM_CONST    2.41e-4
+#define RADIOMETER_ANALYTIC 0 // Radiometer ToA errors from the S/N and the template
+#define RADIOMETER_FFTFIT   1 // Fit a simulated noisy profile for each ToA
+
+#define WIDEBAND_OFF      0 // One radiometer ToA per observation, from the whole band
+#define WIDEBAND_CHANNELS 1 // One ToA for each backend channel
+#define WIDEBAND_FIT      2 // One ToA and DM from a fit across the channels
+
+#define GW_PRECISION_LONG  0 // GW background source coefficients in long double
+#define GW_PRECISION_FAST  1 // In double, with a double-double pulsar term phase
+#define GW_PRECISION_CHECK 2 // As fast, and compared with the long double sum
+
+#define COMPOSE_TEMPO2   0 // Realisations made by tempo2 -gr createRealisation
+#define COMPOSE_INTERNAL 1 // Made by ptaSimulate --compose
+
 #define SECDAY 86400
-#define MAX_GWS 10 // Maximum number of GWs
-#define MAX_CWS 100000 // Maximum number of individual SMBH sources to simulate
+
+// Effect identifiers for the random number streams (see TKstreamInit). Each
+// effect has its own key, so enabling or disabling one effect does not change
+// the random numbers used by the others. Where an effect can be defined more
+// than once its index is added to the identifier
+#define RAN_SCRIPT     (1<<16)  // Expressions evaluated whilst reading the script
+#define RAN_POSITION   (2<<16)  // Isotropic pulsar positions
+#define RAN_BE         (3<<16)
+#define RAN_RCVR       (4<<16)
+#define RAN_PSR        (5<<16)
+#define RAN_GLITCH     (6<<16)
+#define RAN_OBSRUN     (7<<16)
+#define RAN_SCHED      (8<<16)
+#define RAN_OBSSYS     (9<<16)
+#define RAN_TOAS       (10<<16) // Ideal arrival times
+#define RAN_SCINT      (11<<16) // Diffractive scintillation
+#define RAN_PROFILE    (12<<16) // Noise added to simulated profiles
+#define RAN_RADIOMETER (13<<16)
+#define RAN_TNOISE     (14<<16)
+#define RAN_PLANETS    (15<<16)
+#define RAN_CLKNOISE   (16<<16)
+#define RAN_EPHEMNOISE (17<<16)
+#define RAN_DMVAR      (18<<16)
+#define RAN_DMCOVAR    (19<<16)
+#define RAN_DMFUNC     (20<<16)
+#define RAN_JITTER     (21<<16)
+#define RAN_GW         (22<<16)
+#define RAN_OUTLIERS   (23<<16)
 
 typedef struct paramStruct {
   char l[MAX_STRLEN]; // Label
@@ -71,6 +96,7 @@ typedef struct beStruct {
   char name[MAX_STRLEN];
   valStruct bw;
   valStruct nbin;
+  valStruct nchan; // Number of frequency channels across bw (for wideband ToAs)
   int nOffset;
   valStruct offsetMJD[MAX_BEOFFSETS];
   valStruct offsetVal[MAX_BEOFFSETS];
@@ -96,10 +122,8 @@ typedef struct obsSysStruct {
   valStruct freq[MAX_SYS];
 } obsSysStruct;
 
+// An observation in a schedule
 typedef struct obsStruct {
-  char tel[MAX_STRLEN];
-  char sched[MAX_STRLEN];
-  char or[MAX_STRLEN];
   int psrNum;
   valStruct start;
   valStruct finish;
@@ -111,13 +135,34 @@ typedef struct obsStruct {
   valStruct ha;
   valStruct outlierAmp;
   valStruct outlierProb;
-  long double sat;
-  int satSet;
   int rcvrNum;
   int beNum;
   int obsSysNum;
 } obsStruct;
 
+// The ToAs of one pulsar in the current realisation, stored column by column
+// so that the create* routines only stream through the values they use.
+// Each column holds nalloc entries; see reserveToAs
+typedef struct toaTable {
+  int nalloc;
+  toaEpoch *sat;    // Site arrival time (MJD)
+  double *freq;     // Observing frequency (MHz)
+  double *toaErr;   // ToA uncertainty (s)
+  double *dmErr;    // Wideband DM uncertainty (cm^-3 pc), 0 if not measured
+  double *efac;
+  double *equad;
+  double *tobs;     // Observation length (s)
+  int *rcvrNum;
+  int *beNum;
+  int *obsSysNum;   // -1 if not observed with an observing system
+  int *tel;         // Index into telName
+  int *obsRun;      // Observing run that gave the ToA
+  int *sched;       // Schedule that gave the ToA, -1 if read from a tim file
+  int *schedObs;    // Observation within that schedule (e.g. for outliers)
+  int ntel;
+  char **telName;   // Telescope names used by these ToAs
+} toaTable;
+
 typedef struct psrStruct {
   char name[MAX_STRLEN]; int setName;
   char label[MAX_STRLEN]; int setLabel;
@@ -130,7 +175,7 @@ typedef struct psrStruct {
   char setParamName[MAX_PARAMS][MAX_STRLEN];
   valStruct paramVal[MAX_PARAMS];
   int nToAs;
-  obsStruct obs[MAX_TOAS];
+  toaTable toa; // Owned by each realisation worker (see allocateObservations)
   double rajd; // Position in degrees
   double decjd; // Position in degrees
   double dm; // dispersion measure
@@ -155,15 +200,15 @@ typedef struct obsrunStruct {
   valStruct finish;
   valStruct cadence;
   valStruct probFailure;
-  t2TimStruct T2Tim[MAX_T2TIM];
-  int nT2Tim;
+  t2TimStruct *T2Tim;
+  int nT2Tim; int nT2TimAlloc;
 } obsrunStruct;
 
 
 typedef struct scheduleStruct {
   char name[MAX_STRLEN];
-  obsStruct obs[MAX_OBS_SCHED];
-  int nObsSched;
+  obsStruct *obs;
+  int nObsSched; int nObsSchedAlloc;
 } scheduleStruct;
 
 typedef struct observatoryStruct {
@@ -196,10 +241,27 @@ typedef struct gwStruct {
   valStruct cgw_cosinc;
   valStruct cgw_angpol;
   valStruct cgw_mc;
-  int type; // 1 = GWB, 2 = single defined by A+ and Ax, 3 = GWM, 4 = CW source
-  char fname[1024]; // File name for GW source listing
+  int type; // 1 = GWB, 2 = single defined by A+ and Ax, 3 = GWM, 4 = CW source, 7 = GWB in a Fourier basis
+  int nfreq;    // Number of frequencies for type 7
+  double nspan; // Period of the type 7 Fourier basis in units of the data span
+  char fname[1024]; // File name for GW source listing (type 5) or source cache (type 1)
 } gwStruct;
 
+// Continuous-wave source catalogue (createGW type 5), nsrc entries in each column
+typedef struct cwCatalogue {
+  long nsrc;
+  const double *h0;     // Strain amplitude
+  const double *omega;  // Angular frequency (rad/s)
+  const double *skyInc; // Inclination (rad)
+} cwCatalogue;
+
+// Antenna response of a pulsar to a single GW source
+typedef struct gwResponse {
+  double resp;     // Plus polarisation
+  double resc;     // Cross polarisation
+  double cosTheta; // Cosine of the angle between the pulsar and the source
+} gwResponse;
+
 typedef struct tnoiseStruct {
   int psrNum;
   valStruct alpha;
@@ -270,31 +332,54 @@ typedef struct outputStruct {
   char fname[MAX_STRLEN];
 } outputStruct;
 
+// Everything that changes while the expressions in the script are being
+// evaluated (the compiled programs themselves are shared and read-only), so
+// each realisation worker can evaluate expressions with its own context
+typedef struct exprContext {
+  TKstream ranStream; // Stream used by ran(), fdist and ranOnce
+  double *vars;       // Variable values for the program being run
+  int nVarsAlloc;
+} exprContext;
+
 typedef struct controlStruct {
   char name[MAX_STRLEN];
   int nproc;
+  int nthreads; // Number of realisations created concurrently in this process (--threads)
 
   int nCut;
   float mjdCut[MAX_CUTS];
   char  cutName[MAX_CUTS][512];
   
-  long seed; // Random number seed
-  psrStruct psr[MAX_PSRS];
+  int nbatch; // Noise realisations stored in each toasim file ('nbatch:')
+  int redNoisePad; // Padding factor for the red noise FFTs ('redNoisePad:')
+  unsigned fftPlanFlags; // FFTW planning rigour for the plan cache ('fftPlan:')
+  int fftThreads; // FFTW threads used for very long transforms ('fftThreads:')
+  int radiometerMode; // How radiometer ToA errors are found ('radiometer:')
+  int gwPrecision; // Arithmetic for the GW background sums ('gwPrecision:')
+  int dumpProfiles; // Write each simulated profile to a .prof file ('dumpProfiles:')
+  int widebandMode; // Radiometer ToAs across the backend channels ('wideband:')
+  arena scratch; // Per-realisation scratch arrays (see arena.h)
+  long seed; // Master random number seed (script 'seed:' or --seed)
+  exprContext expr; // State for evaluating the expressions in the script
+  psrStruct *psr;
   int npsr; // Number of pulsars
+  int npsrAlloc;
   char inputScript[MAX_STRLEN];
   int nreal; // Number of realisations
 
-  obsrunStruct obsRun[MAX_OBSRUN];
+  obsrunStruct *obsRun;
   int nObsRun; // Number of observation runs
+  int nObsRunAlloc;
 
-  scheduleStruct sched[MAX_SCHED];
+  scheduleStruct *sched;
   int nSched; // Number of available schedules
+  int nSchedAlloc;
 
-  tnoiseStruct tnoise[MAX_TNOISE];
-  int nTnoise;
+  tnoiseStruct *tnoise;
+  int nTnoise; int nTnoiseAlloc;
 
-  planetStruct planets[MAX_PLANETS];
-  int nPlanets;
+  planetStruct *planets;
+  int nPlanets; int nPlanetsAlloc;
 
   clkNoiseStruct clkNoise;
   int nClkNoise;
@@ -302,29 +387,29 @@ typedef struct controlStruct {
   ephemNoiseStruct ephemNoise;
   int nEphemNoise;
 
-  dmVarStruct dmVar[MAX_DMVAR];
-  int nDMvar;
+  dmVarStruct *dmVar;
+  int nDMvar; int nDMvarAlloc;
 
-  dmCovarStruct dmCovar[MAX_DMCOVAR];
-  int nDMcovar;
+  dmCovarStruct *dmCovar;
+  int nDMcovar; int nDMcovarAlloc;
 
-  dmFuncStruct dmFunc[MAX_DMFUNC];
-  int nDMfunc;
+  dmFuncStruct *dmFunc;
+  int nDMfunc; int nDMfuncAlloc;
 
-  jitterStruct jitter[MAX_DMVAR];
-  int nJitter;
+  jitterStruct *jitter;
+  int nJitter; int nJitterAlloc;
   
   long double minT;
   long double maxT;
 
-  gwStruct gw[MAX_GWS];
-  int nGW;
+  gwStruct *gw;
+  int nGW; int nGWAlloc;
 
-  rcvrStruct rcvr[MAX_RCVR];
-  int nRCVR;
+  rcvrStruct *rcvr;
+  int nRCVR; int nRCVRAlloc;
 
-  beStruct be[MAX_BE];
-  int nBE;
+  beStruct *be;
+  int nBE; int nBEAlloc;
 
   char simEphem[MAX_STRLEN]; int simTypeEphem;
   char simClock[MAX_STRLEN];
@@ -337,27 +422,78 @@ typedef struct controlStruct {
   char useNE_SW[MAX_STRLEN];
   char simNE_SW[MAX_STRLEN];
 
-  obsSysStruct obsSys[MAX_OBS_SYS];
-  int nObsSys;
+  obsSysStruct *obsSys;
+  int nObsSys; int nObsSysAlloc;
 
-  glitchStruct glitches[MAX_GLITCHES];
-  int nGlitches;
+  glitchStruct *glitches;
+  int nGlitches; int nGlitchesAlloc;
 
   char t2exe[MAX_STRLEN];
+  char simExe[MAX_STRLEN]; // ptaSimulate as run by the scripts ('simExe:')
+  int composeMode; // How the tim files are made from the ideal ToAs ('compose:')
   char shell[MAX_STRLEN];
   char shellPth[MAX_STRLEN];
 
-  observatoryStruct observatory[MAX_OBSERVATORIES];
-  int nObservatory;
+  observatoryStruct *observatory;
+  int nObservatory; int nObservatoryAlloc;
 
-  outputStruct output[MAX_OUTPUT];
-  int nOutput;
+  outputStruct *output;
+  int nOutput; int nOutputAlloc;
 
 } controlStruct;
 
-int runEvaluateExpression(char *expression,controlStruct *control);
-int changeRandomOnce(char *expression,controlStruct *control);
-int checkProbability(valStruct in,controlStruct *control);
+// The tables in controlStruct grow as the script is read. GROW_TABLE makes
+// sure that entry n of table exists, zeroing any new entries
+#define GROW_TABLE(control,table,nalloc,n) ((table) = growTable((control),(table),&(nalloc),(n),sizeof(*(table))))
+
+double runEvaluateExpression(char *expression,double x,exprContext *ctx);
+double runValueProgram(evalProgram *prog,double x,exprContext *ctx);
+evalProgram *valueProgram(char *inVal);
+int constantValue(char *inVal);
+double evaluateValue(char *inVal,double x,exprContext *ctx);
+void evaluateValueArray(char *inVal,const double *x,double *out,int n,exprContext *ctx);
+int checkProbability(valStruct in,exprContext *ctx);
+void setExpressionStream(controlStruct *control,int r,int effect);
+double observationCadence(controlStruct *control,int p);
 void createOutliers(controlStruct *control,int r);
 void processEphemNoise(controlStruct *control,int r);
 void createEphemNoise(controlStruct *control,int r);
+void runRealisation(controlStruct *control,int r,char *dir0);
+void allocateObservations(controlStruct *control);
+void freeObservations(controlStruct *control);
+void reserveToAs(controlStruct *control,int p,int n);
+void *growTable(controlStruct *control,void *table,int *nalloc,int n,size_t size);
+void copyControlTables(controlStruct *dest,controlStruct *src);
+void freeControlTables(controlStruct *control);
+int toaTelescopeId(toaTable *toa,const char *tel);
+int maxToAs(controlStruct *control);
+void *toaScratch(controlStruct *control,size_t size);
+void runRealisationsThreaded(controlStruct *control,char *dir0);
+double radiometerToaErr(controlStruct *control,int p,int closestProf,int nbin,double flux,double radNoise);
+void radiometerCacheCleanup(void);
+void profileStoreGet(const char *fname,int nbin,const double **prof,const double **templ);
+const struct tmplStruct *profileStoreTemplate(const char *fname);
+void profileStoreCleanup(void);
+struct gwSrc;
+void gwbResiduals(controlStruct *control,int p,long double *kp,long double dist,
+		  struct gwSrc *gw,int ngw,toaEpoch timeOffset,long double *gwRes);
+void gwbPrecisionReport(void);
+double *gwbFourierCoeffs(controlStruct *control,TKstream *stream,int nfreq,double period,
+			 double amp,double alpha,int nbatch);
+void gwbFourierResiduals(controlStruct *control,int p,const double *coeffs,int nfreq,double period,
+			 toaEpoch timeOffset,long double *gwRes);
+void gwbFourierCleanup(void);
+void cwPopulationResiduals(controlStruct *control,int p,int nCW,const double *h0,const double *omega,
+			   const double *angpol,const double *lambda,const double *beta,const double *skyInc,
+			   long double dist,toaEpoch timeOffset,long double *gwRes);
+void gwResponseGet(double lambda_p,double beta_p,double lambda,double beta,int store,gwResponse *out);
+void gwResponseCleanup(void);
+const cwCatalogue *cwCatalogueGet(const char *fname);
+void cwCatalogueConvert(const char *in,const char *out);
+void cwCatalogueCleanup(void);
+void composeRealisations(const char *fname);
+void gwbCacheSources(controlStruct *control,const char *fname,int r,struct gwSrc *gw,int ngw,TKstream *stream,
+		     long double flo,long double fhi,double gwAmp,double alpha,int logspacing);
+void gwbCacheCleanup(void);
+int widebandToaErrs(controlStruct *control,int s0,int j,int sys,double scale,int realisation,
+		    double **freq,double **toaErr,double *dmErr);
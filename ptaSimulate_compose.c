@@ -0,0 +1,295 @@
+// Forms the simulated tim files without tempo2 ('compose: internal')
+//
+// Normally each realisation is made by running tempo2's createRealisation
+// plugin for every pulsar, output and batch, each run reading the ideal
+// ToAs and all of the correction files again. With 'compose: internal'
+// makeRealScript instead lists, for each pulsar, every tim file to be made
+// (the ideal ToAs, the batch and the correction files, as they would be
+// given to createRealisation) in a .compose file, and the processing script
+// runs 'ptaSimulate --compose' on it once. The ideal ToAs are then read once
+// and the offsets of each realisation are summed in memory (as
+// toasim_apply_corrections) and added to the site arrival times, which are
+// written directly to the output directories.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "ptaSimulate.h"
+#include "toasim.h"
+
+#define COMPOSE_MAX_TOKENS 512 // Words on one line of a .compose file
+
+typedef struct timLine {
+  char *text;   // The line as read
+  int isToa;    // 1 if the line is a ToA
+  int satStart; // Position of the arrival time in text (ToAs only)
+  int satEnd;
+  toaEpoch sat;
+} timLine;
+
+typedef struct timFile {
+  timLine *line;
+  int nline;
+  int ntoa;
+} timFile;
+
+// Parses an MJD such as 53005.123456789012345 without rounding it through
+// a long double. Returns 0 if str is not a number of that form
+static int parseEpoch(const char *str,int len,toaEpoch *e)
+{
+  char buf[64];
+  int i,dot=len;
+
+  if (len <= 0 || len >= (int)sizeof(buf)-1) return 0;
+  for (i=0;i<len;i++)
+    {
+      if (str[i]=='.' && dot==len)
+	dot = i;
+      else if (!isdigit((unsigned char)str[i]))
+	return 0;
+    }
+  memcpy(buf,str,dot);
+  buf[dot] = '\0';
+  e->day = strtoll(buf,NULL,10);
+  // The fraction as 0.xxx
+  buf[0] = '0';
+  memcpy(buf+1,str+dot,len-dot);
+  buf[1+len-dot] = '\0';
+  e->frac = (dot < len) ? strtod(buf,NULL) : 0;
+  if (e->frac >= 1) // Rounded up to the next day
+    {
+      e->day++;
+      e->frac -= 1;
+    }
+  return 1;
+}
+
+static int isNumber(const char *str,int len)
+{
+  char buf[64],*end;
+
+  if (len <= 0 || len >= (int)sizeof(buf)) return 0;
+  memcpy(buf,str,len);
+  buf[len] = '\0';
+  strtod(buf,&end);
+  return *end == '\0';
+}
+
+// Reads a tempo2 tim file, recognising the ToAs (file, frequency, arrival
+// time, uncertainty and site, then any flags) and keeping everything else
+static void readTimFile(const char *fname,timFile *tim)
+{
+  FILE *fin;
+  char line[4096];
+  int start[5],end[5],nw,i,nalloc=0;
+  timLine *l;
+
+  if (!(fin = fopen(fname,"r")))
+    {
+      printf("Unable to open the ideal ToAs %s\n",fname);
+      exit(1);
+    }
+  tim->line = NULL;
+  tim->nline = tim->ntoa = 0;
+  while (fgets(line,sizeof(line),fin))
+    {
+      if (tim->nline == nalloc)
+	{
+	  nalloc = (nalloc > 0) ? 2*nalloc : 1024;
+	  if (!(tim->line = (timLine *)realloc(tim->line,sizeof(timLine)*nalloc)))
+	    {
+	      printf("Unable to allocate memory for the ToAs in %s\n",fname);
+	      exit(1);
+	    }
+	}
+      l = &(tim->line[tim->nline++]);
+      if (!(l->text = strdup(line)))
+	{
+	  printf("Unable to allocate memory for the ToAs in %s\n",fname);
+	  exit(1);
+	}
+      l->isToa = 0;
+      // The first five words
+      for (i=0,nw=0;nw<5 && line[i]!='\0';nw++)
+	{
+	  while (line[i]==' ' || line[i]=='\t') i++;
+	  if (line[i]=='\0' || line[i]=='\n') break;
+	  start[nw] = i;
+	  while (line[i]!='\0' && line[i]!=' ' && line[i]!='\t' && line[i]!='\n') i++;
+	  end[nw] = i;
+	}
+      if (nw == 5 && line[start[0]]!='#' && !(end[0]-start[0]==1 && line[start[0]]=='C') &&
+	  isNumber(line+start[1],end[1]-start[1]) && isNumber(line+start[3],end[3]-start[3]) &&
+	  parseEpoch(line+start[2],end[2]-start[2],&(l->sat)))
+	{
+	  l->isToa = 1;
+	  l->satStart = start[2];
+	  l->satEnd = end[2];
+	  tim->ntoa++;
+	}
+    }
+  fclose(fin);
+}
+
+static void freeTimFile(timFile *tim)
+{
+  int i;
+
+  for (i=0;i<tim->nline;i++)
+    free(tim->line[i].text);
+  free(tim->line);
+  tim->line = NULL;
+  tim->nline = tim->ntoa = 0;
+}
+
+static void freeHeader(toasim_header_t *header)
+{
+  free(header->description);
+  free(header->idealised_toas);
+  free(header->orig_parfile);
+  free(header->gparam_desc);
+  free(header->gparam_vals);
+  free(header->rparam_desc);
+  free(header);
+}
+
+// Adds the offsets (s) of realisation k in the correction file fname
+static void addCorrections(const char *fname,int k,int ntoa,double *offsets)
+{
+  toasim_header_t *header;
+  toasim_corrections_t *corr;
+  FILE *fin;
+
+  if (!(fin = fopen(fname,"rb")) || !(header = toasim_read_header(fin)))
+    {
+      printf("Unable to read the corrections in %s\n",fname);
+      exit(1);
+    }
+  if ((int)header->ntoa != ntoa || k >= (int)header->nrealisations)
+    {
+      printf("%s has %d ToAs and %d realisations, but realisation %d of %d ToAs is needed\n",
+	     fname,(int)header->ntoa,(int)header->nrealisations,k,ntoa);
+      exit(1);
+    }
+  if (!(corr = toasim_read_corrections(header,k,fin)))
+    {
+      printf("Unable to read realisation %d from %s\n",k,fname);
+      exit(1);
+    }
+  if (header->rparam_len == 0)
+    corr->params = NULL;
+  toasim_apply_corrections(header,corr,offsets);
+  toasim_free_corrections(corr);
+  freeHeader(header);
+  fclose(fin);
+}
+
+// Writes tim with the offsets (s) added to the arrival times
+static void writeRealisation(const char *fname,timFile *tim,const double *offsets)
+{
+  FILE *fout;
+  char mjd[64];
+  timLine *l;
+  toaEpoch sat;
+  double frac;
+  int i,j=0;
+
+  if (!(fout = fopen(fname,"w")))
+    {
+      printf("Unable to open %s to write the simulated ToAs\n",fname);
+      exit(1);
+    }
+  for (i=0;i<tim->nline;i++)
+    {
+      l = &(tim->line[i]);
+      if (!l->isToa)
+	{
+	  fputs(l->text,fout);
+	  continue;
+	}
+      sat = l->sat;
+      frac = sat.frac + offsets[j++]/86400.0;
+      sat.day += (int64_t)floor(frac);
+      sat.frac = frac - floor(frac);
+      epochFormat(mjd,sizeof(mjd),sat,15);
+      fprintf(fout,"%.*s%s%s",l->satStart,l->text,mjd,l->text+l->satEnd);
+    }
+  fclose(fout);
+}
+
+// Makes the tim files listed in the .compose file fname. Each line gives
+// the ideal tim file, the realisation (batch) in the correction files, the
+// tim file to write and then the correction files, each after -corr
+void composeRealisations(const char *fname)
+{
+  FILE *fin;
+  char line[16384],simName[MAX_STRLEN]="",*word[COMPOSE_MAX_TOKENS],*tok,*save;
+  timFile tim;
+  double *offsets=NULL;
+  int nw,i,k,n=0,nline=0;
+
+  if (!(fin = fopen(fname,"r")))
+    {
+      printf("Unable to open the list of realisations %s\n",fname);
+      exit(1);
+    }
+  tim.line = NULL;
+  tim.nline = tim.ntoa = 0;
+  while (fgets(line,sizeof(line),fin))
+    {
+      nline++;
+      // A line that is cut short or has too many words would lose corrections
+      if (strlen(line) == sizeof(line)-1 && line[sizeof(line)-2] != '\n')
+	{
+	  printf("Line %d of %s is too long (more than %d characters)\n",nline,fname,(int)sizeof(line)-2);
+	  exit(1);
+	}
+      nw = 0;
+      for (tok=strtok_r(line," \t\n",&save);tok!=NULL;tok=strtok_r(NULL," \t\n",&save))
+	{
+	  if (nw == COMPOSE_MAX_TOKENS)
+	    {
+	      printf("Line %d of %s has more than %d words\n",nline,fname,COMPOSE_MAX_TOKENS);
+	      exit(1);
+	    }
+	  word[nw++] = tok;
+	  if (word[0][0]=='#')
+	    break;
+	}
+      if (nw == 0 || word[0][0]=='#')
+	continue;
+      if (nw < 3 || sscanf(word[1],"%d",&k)!=1)
+	{
+	  printf("Unable to understand line %d of %s, starting %s\n",nline,fname,word[0]);
+	  exit(1);
+	}
+      // The ideal ToAs are kept for the following lines
+      if (strcmp(word[0],simName)!=0)
+	{
+	  freeTimFile(&tim);
+	  readTimFile(word[0],&tim);
+	  strcpy(simName,word[0]);
+	  free(offsets);
+	  if (!(offsets = (double *)malloc(sizeof(double)*(tim.ntoa > 0 ? tim.ntoa : 1))))
+	    {
+	      printf("Unable to allocate memory for the ToAs in %s\n",simName);
+	      exit(1);
+	    }
+	}
+      for (i=0;i<tim.ntoa;i++)
+	offsets[i] = 0;
+      for (i=3;i<nw;i++)
+	{
+	  if (strcmp(word[i],"-corr")==0 && i+1 < nw)
+	    addCorrections(word[++i],k,tim.ntoa,offsets);
+	}
+      writeRealisation(word[2],&tim,offsets);
+      n++;
+    }
+  fclose(fin);
+  freeTimFile(&tim);
+  free(offsets);
+  printf("Made %d simulated tim files from %s\n",n,fname);
+}
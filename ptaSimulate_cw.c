@@ -0,0 +1,200 @@
+// Residuals from a population of continuous-wave sources (createGW type 5)
+//
+// The Lee et al. (2011) residual of each source in a given pulsar is
+//   res(t) = a sin(omega t) + b cos(omega t) = Re[c exp(i omega t)]
+// with a, b (and c = b - i a) only depending on the source and the pulsar,
+// so they are found once. For a large population the sum over the sources
+// is made by binning the sources in frequency. Measuring the time from the
+// centre tc of the ToAs and the frequency from the centre omega_b of a bin,
+//   exp(i omega t) = exp(i omega tc) exp(i omega_b (t-tc)) exp(i d (t-tc))
+// and the last factor is expanded as a Taylor series in d (t-tc), which is
+// no larger than CW_MAXPHASE in size. The sources in a bin then combine
+// into one polynomial in (t-tc), so the cost per ToA depends on the number
+// of bins rather than on the number of sources.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ptaSimulate.h"
+
+#define CW_MAXPHASE 0.5 // Largest phase (rad) of a source relative to the centre of its bin
+#define CW_TAYLOR   16  // Number of terms in the expansion (error ~ CW_MAXPHASE^CW_TAYLOR/CW_TAYLOR!)
+#define CW_BLOCK    256 // ToAs evaluated together
+#define CW_RESEED   64  // Bins between recalculations of exp(i omega_b (t-tc))
+
+// Residuals (s) in pulsar p from the nCW sources, at times
+// (sat - timeOffset) days. angpol, lambda and beta are the orientations and
+// positions of the sources for this realisation, h0, omega and skyInc are
+// shared by all of the realisations
+void cwPopulationResiduals(controlStruct *control,int p,int nCW,const double *h0,const double *omega,
+			   const double *angpol,const double *lambda,const double *beta,const double *skyInc,
+			   long double dist,toaEpoch timeOffset,long double *gwRes)
+{
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  arena *scratch = &(control->scratch);
+  int ntoa = control->psr[p].nToAs;
+  const toaEpoch *sat = control->psr[p].toa.sat;
+  double lambda_p = control->psr[p].rajd*M_PI/180.0;
+  double beta_p = control->psr[p].decjd*M_PI/180.0;
+  double *a,*b,*t;
+  double B1,B2,cosTheta,deltaPhi,amp,P,Q,cosi;
+  double tmin,tmax,tc,tscale,w,omegaMin,omegaMax,x,xm,cr,ci,pr,pi,zr,sn;
+  double *C,*u,*zre,*zim,*sr,*si,*polr,*poli,*sum;
+  long double phase,tcl;
+  char *occupied;
+  int i,i0,n,j,k,m,nbin;
+
+  a = (double *)arenaAlloc(scratch,sizeof(double)*(2*nCW+ntoa));
+  b = a+nCW;
+  t = b+nCW;
+
+  // Coefficients of each source in this pulsar
+  for (j=0;j<nCW;j++)
+    {
+      // Lee et al. (2011) equations 12, 13 and 14
+      B1 = (1+pow(sin(beta[j]),2))*pow(cos(beta_p),2)*cos(2*(lambda[j]-lambda_p))-
+	sin(2*beta[j])*sin(2*beta_p)*cos(lambda[j]-lambda_p)+(2.0-3.0*pow(cos(beta_p),2))*pow(cos(beta[j]),2);
+      B2 = 2*cos(beta[j])*sin(beta_p)*sin(lambda[j]-lambda_p)-2*sin(beta[j])*pow(cos(beta_p),2)*sin(2*(lambda[j]-lambda_p));
+      cosTheta = -(cos(beta[j])*cos(beta_p)*cos(lambda[j]-lambda_p) + sin(beta[j])*sin(beta_p));
+      if ((1.0-cosTheta)==0)
+	{
+	  a[j] = b[j] = 0;
+	  continue;
+	}
+      deltaPhi = omega[j]*dist*(1.0-cosTheta);
+      // Equation 11: amp*(P cos(omega t - deltaPhi/2) + Q sin(omega t - deltaPhi/2))
+      cosi = cos(skyInc[j]);
+      amp = h0[j]/2.0/omega[j]*sin(deltaPhi/2.0)/(1.0-cosTheta);
+      P = (B1*cos(2*angpol[j])+B2*sin(2*angpol[j]))*(1+cosi*cosi);
+      Q = 2*(B2*cos(2*angpol[j])-B1*sin(2*angpol[j]))*cosi;
+      a[j] = amp*(P*sin(deltaPhi/2.0) + Q*cos(deltaPhi/2.0));
+      b[j] = amp*(P*cos(deltaPhi/2.0) - Q*sin(deltaPhi/2.0));
+    }
+
+  tmin = tmax = 0;
+  omegaMin = omegaMax = (nCW > 0) ? omega[0] : 0;
+  for (i=0;i<ntoa;i++)
+    {
+      t[i] = epochSeconds(sat[i],timeOffset);
+      if (i==0 || t[i] < tmin) tmin = t[i];
+      if (i==0 || t[i] > tmax) tmax = t[i];
+    }
+  for (j=1;j<nCW;j++)
+    {
+      if (omega[j] < omegaMin) omegaMin = omega[j];
+      if (omega[j] > omegaMax) omegaMax = omega[j];
+    }
+  tc = 0.5*(tmin+tmax);
+  tscale = 0.5*(tmax-tmin);
+  w = (tscale > 0) ? 2*CW_MAXPHASE/tscale : 0;
+  nbin = (w > 0) ? (int)floor((omegaMax-omegaMin)/w+0.5)+1 : 0;
+
+  if (nbin == 0 || (double)nbin*CW_TAYLOR >= nCW)
+    {
+      // Few sources: sum them directly
+      for (i=0;i<ntoa;i++)
+	{
+	  gwRes[i] = 0;
+	  for (j=0;j<nCW;j++)
+	    gwRes[i] += a[j]*sin(omega[j]*t[i]) + b[j]*cos(omega[j]*t[i]);
+	}
+      arenaRelease(scratch,mark);
+      return;
+    }
+
+  // Taylor coefficients of the sources in each bin, as polynomials in
+  // u = (t-tc)/tscale
+  C = (double *)arenaAlloc(scratch,sizeof(double)*2*CW_TAYLOR*nbin);
+  occupied = (char *)arenaAlloc(scratch,nbin);
+  for (k=0;k<2*CW_TAYLOR*nbin;k++)
+    C[k] = 0;
+  for (k=0;k<nbin;k++)
+    occupied[k] = 0;
+  tcl = (long double)tc;
+  for (j=0;j<nCW;j++)
+    {
+      k = (int)floor((omega[j]-omegaMin)/w+0.5);
+      occupied[k] = 1;
+      // c exp(i omega tc), then multiplied by (i x)^m/m!
+      phase = fmodl((long double)omega[j]*tcl,2*M_PI);
+      cr = b[j]*(double)cosl(phase) + a[j]*(double)sinl(phase);
+      ci = b[j]*(double)sinl(phase) - a[j]*(double)cosl(phase);
+      x = (omega[j]-(omegaMin+k*w))*tscale;
+      for (m=0;m<CW_TAYLOR;m++)
+	{
+	  C[2*(k*CW_TAYLOR+m)] += cr;
+	  C[2*(k*CW_TAYLOR+m)+1] += ci;
+	  // Multiply by i x/(m+1)
+	  xm = x/(m+1);
+	  sn = cr;
+	  cr = -ci*xm;
+	  ci = sn*xm;
+	}
+    }
+
+  u = (double *)arenaAlloc(scratch,sizeof(double)*8*CW_BLOCK);
+  zre = u+CW_BLOCK;
+  zim = u+2*CW_BLOCK;
+  sr = u+3*CW_BLOCK;
+  si = u+4*CW_BLOCK;
+  polr = u+5*CW_BLOCK;
+  poli = u+6*CW_BLOCK;
+  sum = u+7*CW_BLOCK;
+  for (i0=0;i0<ntoa;i0+=CW_BLOCK)
+    {
+      n = (ntoa-i0 < CW_BLOCK) ? ntoa-i0 : CW_BLOCK;
+      // exp(i omega_b (t-tc)) for the first bin and the step between bins
+      for (i=0;i<n;i++)
+	{
+	  u[i] = (t[i0+i]-tc)/tscale;
+	  zre[i] = cos(omegaMin*(t[i0+i]-tc));
+	  zim[i] = sin(omegaMin*(t[i0+i]-tc));
+	  sr[i] = cos(w*(t[i0+i]-tc));
+	  si[i] = sin(w*(t[i0+i]-tc));
+	  sum[i] = 0;
+	}
+      for (k=0;k<nbin;k++)
+	{
+	  if (occupied[k])
+	    {
+	      for (i=0;i<n;i++)
+		{
+		  polr[i] = C[2*(k*CW_TAYLOR+CW_TAYLOR-1)];
+		  poli[i] = C[2*(k*CW_TAYLOR+CW_TAYLOR-1)+1];
+		}
+	      for (m=CW_TAYLOR-2;m>=0;m--)
+		{
+		  pr = C[2*(k*CW_TAYLOR+m)];
+		  pi = C[2*(k*CW_TAYLOR+m)+1];
+		  for (i=0;i<n;i++)
+		    {
+		      polr[i] = polr[i]*u[i] + pr;
+		      poli[i] = poli[i]*u[i] + pi;
+		    }
+		}
+	      for (i=0;i<n;i++)
+		sum[i] += zre[i]*polr[i] - zim[i]*poli[i];
+	    }
+	  if ((k+1)%CW_RESEED == 0)
+	    {
+	      for (i=0;i<n;i++)
+		{
+		  zre[i] = cos((omegaMin+(k+1)*w)*(t[i0+i]-tc));
+		  zim[i] = sin((omegaMin+(k+1)*w)*(t[i0+i]-tc));
+		}
+	    }
+	  else
+	    {
+	      for (i=0;i<n;i++)
+		{
+		  zr = zre[i]*sr[i] - zim[i]*si[i];
+		  zim[i] = zre[i]*si[i] + zim[i]*sr[i];
+		  zre[i] = zr;
+		}
+	    }
+	}
+      for (i=0;i<n;i++)
+	gwRes[i0+i] = sum[i];
+    }
+  arenaRelease(scratch,mark);
+}
@@ -0,0 +1,221 @@
+// Process-wide store of continuous-wave source catalogues (createGW type 5)
+//
+// A catalogue is either the text listing (one source per line: log10 chirp
+// mass, mass ratio, redshift, distance (Gpc), log10 observed frequency, four
+// unused columns and the inclination) or a binary catalogue made from it
+// with 'ptaSimulate --convert-cw text binary'. The binary form holds the
+// columns that the simulation uses (h0, omega and the inclination) as
+// native doubles after a short header, and is memory-mapped. Either way a
+// catalogue is loaded once per run and shared, read-only, by all of the
+// realisations and threads until cwCatalogueCleanup().
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ptaSimulate.h"
+
+#define CW_CATALOGUE_MAGIC   "PTACWCAT"
+#define CW_CATALOGUE_VERSION 1
+
+typedef struct cwCatalogueHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t ncol;  // Columns that follow: h0, omega, skyInc
+  uint64_t nsrc;
+} cwCatalogueHeader;
+
+typedef struct catalogueEntry {
+  char *fname;
+  cwCatalogue cat;
+  void *map;     // Mapped binary catalogue, or NULL
+  size_t mapLen;
+  double *buf;   // Columns read from a text catalogue, or NULL
+  struct catalogueEntry *next;
+} catalogueEntry;
+
+static catalogueEntry *catalogues = NULL;
+static pthread_mutex_t catalogueLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Reads a text catalogue into *buf (h0, omega and skyInc columns, one after
+// another) and returns the number of sources
+static long readTextCatalogue(const char *fname,double **buf)
+{
+  double SPEED_LIGHT = 299792458.0; /*!< Speed of light (m/s)                       */
+  double GM = 1.3271243999e20;      /*!< Gravitational constant * mass sun          */
+  double log_ch_mass,massRatio,redshift,distance,logObsFreq,temp,skyInc,mc,cm_dist_mpc;
+  double *h0,*omega,*inc;
+  long n=0,nalloc=0,j;
+  FILE *fin;
+
+  if (!(fin = fopen(fname,"r")))
+    {
+      printf("Unable to open file >%s< to read the GW soure parameters\n",fname);
+      exit(1);
+    }
+  h0 = omega = inc = NULL;
+  while (fscanf(fin,"%lf %lf %lf %lf %lf %lf %lf %lf %lf %lf",&log_ch_mass,&massRatio,&redshift,&distance,&logObsFreq,
+		&temp,&temp,&temp,&temp,&skyInc)==10)
+    {
+      if (n == nalloc)
+	{
+	  nalloc = (nalloc > 0) ? 2*nalloc : 1024;
+	  if (!(h0 = (double *)realloc(h0,sizeof(double)*nalloc)) ||
+	      !(omega = (double *)realloc(omega,sizeof(double)*nalloc)) ||
+	      !(inc = (double *)realloc(inc,sizeof(double)*nalloc)))
+	    {
+	      printf("Unable to allocate memory for %ld GW sources\n",nalloc);
+	      exit(1);
+	    }
+	}
+      mc = pow(10,log_ch_mass);
+      cm_dist_mpc = distance*1000.0;
+      h0[n] = pow(GM*mc*(1+redshift),(5.0/3.0))/pow(SPEED_LIGHT,4)/(cm_dist_mpc*1e6*3.08568025e16)*pow((M_PI*pow(10,logObsFreq)),(2.0/3.0));
+      omega[n] = 2*M_PI*pow(10,logObsFreq);
+      inc[n] = skyInc;
+      n++;
+    }
+  if (!feof(fin))
+    printf("WARNING: stopped reading >%s< at an unreadable line after %ld sources\n",fname,n);
+  fclose(fin);
+
+  if (!(*buf = (double *)malloc(sizeof(double)*3*(n > 0 ? n : 1))))
+    {
+      printf("Unable to allocate memory for %ld GW sources\n",n);
+      exit(1);
+    }
+  for (j=0;j<n;j++)
+    {
+      (*buf)[j] = h0[j];
+      (*buf)[n+j] = omega[j];
+      (*buf)[2*n+j] = inc[j];
+    }
+  free(h0);
+  free(omega);
+  free(inc);
+  return n;
+}
+
+// Maps fname if it is a binary catalogue. Returns 0 if it is not one
+static int mapBinaryCatalogue(catalogueEntry *e)
+{
+  cwCatalogueHeader header;
+  struct stat st;
+  int fd;
+
+  if ((fd = open(e->fname,O_RDONLY)) < 0)
+    return 0;
+  if (read(fd,&header,sizeof(header)) != sizeof(header) ||
+      memcmp(header.magic,CW_CATALOGUE_MAGIC,sizeof(header.magic))!=0)
+    {
+      close(fd);
+      return 0;
+    }
+  if (header.version != CW_CATALOGUE_VERSION || header.ncol != 3 || fstat(fd,&st)!=0 ||
+      (uint64_t)st.st_size != sizeof(header)+3*header.nsrc*sizeof(double))
+    {
+      printf("The GW source catalogue >%s< is damaged or from an incompatible version\n",e->fname);
+      exit(1);
+    }
+  e->mapLen = st.st_size;
+  if ((e->map = mmap(NULL,e->mapLen,PROT_READ,MAP_SHARED,fd,0)) == MAP_FAILED)
+    {
+      printf("Unable to map the GW source catalogue >%s<\n",e->fname);
+      exit(1);
+    }
+  close(fd);
+  e->cat.nsrc = (long)header.nsrc;
+  e->cat.h0 = (const double *)((const char *)e->map+sizeof(header));
+  e->cat.omega = e->cat.h0+e->cat.nsrc;
+  e->cat.skyInc = e->cat.omega+e->cat.nsrc;
+  return 1;
+}
+
+// The catalogue in file fname (text or binary), loaded on first use
+const cwCatalogue *cwCatalogueGet(const char *fname)
+{
+  catalogueEntry *e;
+
+  pthread_mutex_lock(&catalogueLock);
+  for (e=catalogues;e!=NULL;e=e->next)
+    {
+      if (strcmp(e->fname,fname)==0)
+	break;
+    }
+  if (e == NULL)
+    {
+      if (!(e = (catalogueEntry *)malloc(sizeof(catalogueEntry))) || !(e->fname = strdup(fname)))
+	{
+	  printf("Unable to allocate memory for the GW source catalogue %s\n",fname);
+	  exit(1);
+	}
+      e->map = NULL;
+      e->buf = NULL;
+      if (mapBinaryCatalogue(e))
+	printf("Mapped %ld GW sources from %s\n",e->cat.nsrc,fname);
+      else
+	{
+	  e->cat.nsrc = readTextCatalogue(fname,&(e->buf));
+	  e->cat.h0 = e->buf;
+	  e->cat.omega = e->buf+e->cat.nsrc;
+	  e->cat.skyInc = e->buf+2*e->cat.nsrc;
+	  printf("Read %ld GW sources from %s\n",e->cat.nsrc,fname);
+	}
+      e->next = catalogues;
+      catalogues = e;
+    }
+  pthread_mutex_unlock(&catalogueLock);
+  return &(e->cat);
+}
+
+// Writes the text catalogue in as a binary catalogue out
+void cwCatalogueConvert(const char *in,const char *out)
+{
+  cwCatalogueHeader header;
+  double *buf;
+  long n = readTextCatalogue(in,&buf);
+  FILE *fout;
+
+  memset(&header,0,sizeof(header));
+  memcpy(header.magic,CW_CATALOGUE_MAGIC,sizeof(header.magic));
+  header.version = CW_CATALOGUE_VERSION;
+  header.ncol = 3;
+  header.nsrc = n;
+  if (!(fout = fopen(out,"wb")))
+    {
+      printf("Unable to open file >%s< to write the GW source catalogue\n",out);
+      exit(1);
+    }
+  if (fwrite(&header,sizeof(header),1,fout)!=1 || fwrite(buf,sizeof(double),3*n,fout)!=(size_t)(3*n) ||
+      fclose(fout)!=0)
+    {
+      printf("Unable to write the GW source catalogue >%s<\n",out);
+      exit(1);
+    }
+  free(buf);
+  printf("Converted %ld GW sources from %s to %s\n",n,in,out);
+}
+
+void cwCatalogueCleanup(void)
+{
+  catalogueEntry *e,*next;
+
+  pthread_mutex_lock(&catalogueLock);
+  for (e=catalogues;e!=NULL;e=next)
+    {
+      next = e->next;
+      if (e->map)
+	munmap(e->map,e->mapLen);
+      free(e->buf);
+      free(e->fname);
+      free(e);
+    }
+  catalogues = NULL;
+  pthread_mutex_unlock(&catalogueLock);
+}
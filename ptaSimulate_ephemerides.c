@@ -38,21 +38,23 @@ void processEphemNoise(controlStruct *control,int r)
 void createEphemNoise(controlStruct *control,int r)
 {
   int p,i,j;
+  TKstream stream;
   FILE *file;
   int npts=1024;
   char fname[MAX_STRLEN];
   toasim_header_t* header;
   toasim_header_t* read_header;
-  double offsets[MAX_TOAS]; // should use malloc
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  double *offsets = (double *)toaScratch(control,sizeof(double));
   double dx,dy,dz;
-  double mjds[MAX_TOAS]; //  should use malloc
+  double *mjds = (double *)toaScratch(control,sizeof(double));
   // Create a set of corrections.
   toasim_corrections_t* corr = (toasim_corrections_t*)malloc(sizeof(toasim_corrections_t));
   char name[MAX_STRLEN];
   float cnr_cut=0;
   float cnr_flat=0;
   float old_fc=-1;
-  int nit=1;
+  int nit=control->nbatch;
   double alpha,beta;
   float p_1yr=-1; // s^2 yr
   double secperyear = 86400.0*365.25;
@@ -98,7 +100,7 @@ void createEphemNoise(controlStruct *control,int r)
 	  header->seed = control->seed;
 	  
 	  header->ntoa = control->psr[p].nToAs;
-	  header->nrealisations = 1;
+	  header->nrealisations = nit;
 	  
 	  // First we write the header...
 	  sprintf(fname,"%s/workFiles/real_%d/%s.ephemnoise.%d",control->name,r,control->psr[p].name,t);
@@ -111,27 +113,32 @@ void createEphemNoise(controlStruct *control,int r)
 	      
 	      
 	      printf("Setting up the noise model %g %g\n",mjd_start,mjd_end);
+	      npts = redNoiseNpt(mjd_start,mjd_end,observationCadence(control,-1));
 	      modelx = setupRedNoiseModel(mjd_start,mjd_end,npts,nit,p_1yr,alpha,beta);
 	      modely = setupRedNoiseModel(mjd_start,mjd_end,npts,nit,p_1yr,alpha,beta);
 	      modelz = setupRedNoiseModel(mjd_start,mjd_end,npts,nit,p_1yr,alpha,beta);
 
+	      modelx->pad = modely->pad = modelz->pad = control->redNoisePad;
 	      modelx->cutoff=cnr_cut;
 	      modelx->flatten=cnr_flat;
 	      if(old_fc>0)
 		modelx->mode=MODE_T2CHOL;
-	      populateRedNoiseModel(modelx,&(control->seed));
+	      TKstreamInit(&stream,control->seed,r,-1,RAN_EPHEMNOISE,0);
+	      populateRedNoiseModel(modelx,&stream);
 
 	      modely->cutoff=cnr_cut;
 	      modely->flatten=cnr_flat;
 	      if(old_fc>0)
 		modely->mode=MODE_T2CHOL;
-	      populateRedNoiseModel(modely,&(control->seed));
+	      TKstreamInit(&stream,control->seed,r,-1,RAN_EPHEMNOISE,1);
+	      populateRedNoiseModel(modely,&stream);
 
 	      modelz->cutoff=cnr_cut;
 	      modelz->flatten=cnr_flat;
 	      if(old_fc>0)
 		modelz->mode=MODE_T2CHOL;
-	      populateRedNoiseModel(modelz,&(control->seed));
+	      TKstreamInit(&stream,control->seed,r,-1,RAN_EPHEMNOISE,2);
+	      populateRedNoiseModel(modelz,&stream);
 	    }	      
 	  int itjmp=nit/50;
 	  if (itjmp<1)itjmp=1;
@@ -161,9 +168,9 @@ void createEphemNoise(controlStruct *control,int r)
 	      setupPulsar_GWsim(ra_p,dec_p,kp);
 
 	      for (j=0;j<control->psr[p].nToAs;j++){
-		dx = getRedNoiseValue(modelx,control->psr[p].obs[j].sat,i);
-		dy = getRedNoiseValue(modely,control->psr[p].obs[j].sat,i);
-		dz = getRedNoiseValue(modelz,control->psr[p].obs[j].sat,i);
+		dx = getRedNoiseValue(modelx,epochMJD(control->psr[p].toa.sat[j]),i);
+		dy = getRedNoiseValue(modely,epochMJD(control->psr[p].toa.sat[j]),i);
+		dz = getRedNoiseValue(modelz,epochMJD(control->psr[p].toa.sat[j]),i);
 
 		offsets[j]=dx*kp[0] + dy*kp[1] + dz*kp[2]; // Assume equatorial coordinates
 		//	    printf("offsets = %g\n",offsets[j]);
@@ -176,7 +183,7 @@ void createEphemNoise(controlStruct *control,int r)
 	      }
 	      sum/=control->psr[p].nToAs;
 	      for (j=0;j<control->psr[p].nToAs;j++){
-		mjds[j]=(double)control->psr[p].obs[j].sat;
+		mjds[j]=epochMJD(control->psr[p].toa.sat[j]);
 		offsets[j]-=sum;
 	      }
 	      TKremovePoly_d(mjds,offsets,control->psr[p].nToAs,2); // remove a quadratic to reduce the chances of phase wraps
@@ -201,4 +208,5 @@ void createEphemNoise(controlStruct *control,int r)
 	}
     }
   fclose(fout);
+  arenaRelease(&(control->scratch),mark);
 }
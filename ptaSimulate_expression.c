@@ -1,196 +1,116 @@
 #include <stdio.h>
-#include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #include "ptaSimulate.h"
-#include "evaldefs.h"
+#include "evalcomp.h"
 #include "T2toolkit.h"
 
-int runEvaluateExpression(char *expression,controlStruct *control)
+// Variable values for a program with n variables, all starting from zero
+static double *contextVars(exprContext *ctx,int n)
 {
-  int result;
-  char express2[1024];
-  char temp[1024],temp2[1024];
-  char *tok,*tok2,*e;
-  int add;
-  double change;
-  char changeStr[1024];
-  printf("Evaluating expression: %s\n",expression);
-  if (strstr(expression,"ran(")!=NULL)
+  if (n > ctx->nVarsAlloc)
     {
-      //      printf("Must process\n");
-      strcpy(express2,expression);
-      while (strstr(express2,"ran(")!=NULL)
+      if (!(ctx->vars = (double *)realloc(ctx->vars,sizeof(double)*n)))
 	{
-	  strcpy(temp,express2);
-	  tok = strstr(temp,"ran(");
-	  express2[tok-temp]='\0';
-	  // Now split between brackets to get the information
-	  tok2 = strtok(tok,"(");
-	  tok2 = strtok(NULL,";)");
-	  // Should check to see the type of random variable
-	  if (strcmp(tok2,"gaussian")==0)
-	    {
-	      double v;
-	      char param[1024];
-	      strcpy(param,tok2);
-	      change = TKgaussDev(&(control->seed));
-	      sprintf(changeStr,"%20.20g",change);  // THIS IS A BIG PROBLEM!! HOW TO SET THIS CORRECTLY???
-	    }
-	  else if (strcmp(tok2,"linear")==0)
-	    {
-	      char param[1024];
-	      strcpy(param,tok2);
-	      change = TKranDev(&(control->seed));
-	      sprintf(changeStr,"%20.20g",change);  // THIS IS A BIG PROBLEM!! HOW TO SET THIS CORRECTLY???
-	    }
-	  else
-	    {
-	      printf("Unknown random parameter: %s\n",tok2);
-	      finishOff(control);
-	    }
-
-	  add = tok2+strlen(tok2)+1-temp;
-	  strcpy(temp2,temp + add);
-
-	  strcat(express2,changeStr);
-	  strcat(express2,temp2);
+	  printf("Unable to allocate memory for evaluating an expression\n");
+	  exit(1);
 	}
-      strcpy(expression,express2);
-    }
-
-  if (strstr(expression,"fdist(")!=NULL)
-    {
-      FILE *fin;
-      int n,r;
-      double v[MAX_FDIST_VALS];
-      printf("Must process fdist\n");
-      strcpy(express2,expression);
-      while (strstr(express2,"fdist(")!=NULL)
-	{
-	  strcpy(temp,express2);
-	  tok = strstr(temp,"fdist(");
-	  express2[tok-temp]='\0';
-	  // Now split between brackets to get the information
-	  tok2 = strtok(tok,"(");
-	  tok2 = strtok(NULL,";)");
-	  // Should check to see the type of random variable
-	  if (!(fin = fopen(tok2,"r")))
-	    {
-	      printf("Unable to open file: %s in fdist\n",tok2);
-	      finishOff(control);
-	    }
-	  n=0;
-	  while (!feof(fin))
-	    {
-	      if (fscanf(fin,"%lf",&v[n])==1)
-		{
-		  n++;
-		  if (n > MAX_FDIST_VALS)
-		    {
-		      printf("Too many fdist values in %s\n",tok2);
-		      finishOff(control);
-		    }
-		}
-	    }
-	  fclose(fin);
-	  r = TKranDev(&(control->seed))*n;
-	  printf("Random value from %s = %d %g\n",tok2,r,v[r]);
-	  sprintf(changeStr,"%20.20g",v[r]);  // THIS IS A BIG PROBLEM!! HOW TO SET 
-	  add = tok2+strlen(tok2)+1-temp;
-	  strcpy(temp2,temp + add);
-
-	  strcat(express2,changeStr);
-	  strcat(express2,temp2);
-	}
-      strcpy(expression,express2);
+      ctx->nVarsAlloc = n;
     }
+  memset(ctx->vars,0,sizeof(double)*n);
+  return ctx->vars;
+}
 
+static double streamUniform(void *stream) {return TKstreamRanDev((TKstream *)stream);}
+static double streamGauss(void *stream) {return TKstreamGaussDev((TKstream *)stream);}
 
+// The random values in expressions come from the context's stream
+static evalRandom contextRandom(exprContext *ctx)
+{
+  evalRandom ran;
 
-  strcpy(express2,expression);
+  ran.uniform = streamUniform;
+  ran.gauss = streamGauss;
+  ran.state = &(ctx->ranStream);
+  return ran;
+}
 
+// Evaluates expression with the variable x set to x, and returns the value
+// of the variable v. Each expression is compiled once and then taken from
+// the cache. Returns 0 if the expression cannot be evaluated
+double runEvaluateExpression(char *expression,double x,exprContext *ctx)
+{
+  return runValueProgram(evalCached(expression),x,ctx);
+}
 
-  printf("Evaluated to: %s\n",express2);
-  //      printf("Evalulating expression: %s\n",express2);
-  result = evaluateExpression(express2);
-  return result;
+// Runs a compiled expression with the variable x set to x and returns the
+// value of the variable v (0 if prog is NULL or the evaluation fails)
+double runValueProgram(evalProgram *prog,double x,exprContext *ctx)
+{
+  evalRandom ran = contextRandom(ctx);
+  int xSlot,vSlot;
+  double *vars;
+
+  if (prog==NULL || prog->nVars==0) return 0;
+  vars = contextVars(ctx,prog->nVars);
+  if ((xSlot = evalSlot(prog,"x")) >= 0) vars[xSlot] = x;
+  if (evalRun(prog,vars,&ran)!=0 || (vSlot = evalSlot(prog,"v")) < 0)
+    return 0;
+  return vars[vSlot];
 }
 
-//
-// Routine to remove random numbers that should 
-// only be set once
-//
-int changeRandomOnce(char *expression,controlStruct *control)
+// Program computing "v = inVal", shared through the expression cache. NULL
+// if inVal cannot be parsed
+evalProgram *valueProgram(char *inVal)
 {
-  int result;
-  char express2[1024];
-  char temp[1024],temp2[1024];
-  char *tok,*tok2,*e;
-  int add;
-  double change;
-  char changeStr[1024];
+  char expression[1024];
 
-  printf("Expression at top = %s\n",expression);
+  snprintf(expression,sizeof(expression),"v = %s",inVal);
+  return evalCached(expression);
+}
 
-  if (strstr(expression,"ranOnce(")!=NULL)
-    {
-      //      printf("Must process\n");
-      strcpy(express2,expression);
-      while (strstr(express2,"ranOnce(")!=NULL)
-	{
-	  strcpy(temp,express2);
-	  tok = strstr(temp,"ranOnce(");
-	  express2[tok-temp]='\0';
-	  // Now split between brackets to get the information
-	  tok2 = strtok(tok,"(");
-	  tok2 = strtok(NULL,";)");
-	  // Should check to see the type of random variable
-	  if (strcmp(tok2,"gaussian")==0)
-	    {
-	      double v;
-	      char param[1024];
-	      strcpy(param,tok2);
-	      change = TKgaussDev(&(control->seed));
-	      sprintf(changeStr,"%20.20g",change);  // THIS IS A BIG PROBLEM!! HOW TO SET THIS CORRECTLY???
-	    }
-	  else if (strcmp(tok2,"linear")==0)
-	    {
-	      char param[1024];
-	      strcpy(param,tok2);
-	      change = TKranDev(&(control->seed));
-	      sprintf(changeStr,"%20.20g",change);  // THIS IS A BIG PROBLEM!! HOW TO SET THIS CORRECTLY???
-	    }
-	  else
-	    {
-	      printf("Unknown random parameter: %s\n",tok2);
-	      finishOff(control);
-	    }
-
-	  add = tok2+strlen(tok2)+1-temp;
-	  strcpy(temp2,temp + add);
-
-	  strcat(express2,changeStr);
-	  strcat(express2,temp2);
-	}
-      strcpy(expression,express2);
-    }
+// 1 if "v = inVal" gives the same value in every realisation (it draws no
+// random values, including ranOnce())
+int constantValue(char *inVal)
+{
+  evalProgram *prog = valueProgram(inVal);
 
-  //  strcpy(express2,expression);
-  printf("Expression from ranOnce = %s\n",expression);
-  //  printf("express2 = %s\n",express2);
+  return prog != NULL && prog->random == 0 && prog->nOnce == 0;
+}
 
+// Value of "v = inVal" with the variable x set to x
+double evaluateValue(char *inVal,double x,exprContext *ctx)
+{
+  return runValueProgram(valueProgram(inVal),x,ctx);
+}
 
+// Evaluates "v = inVal" for each of the n values x[0..n) of the variable x,
+// placing the results in out. ran() etc. give a new value for each point,
+// whereas ranOnce() gives the same value for all of them
+void evaluateValueArray(char *inVal,const double *x,double *out,int n,exprContext *ctx)
+{
+  evalProgram *prog = valueProgram(inVal);
+  evalRandom ran = contextRandom(ctx);
+
+  if (prog == NULL || prog->nVars == 0)
+    memset(out,0,sizeof(double)*n);
+  else
+    evalRunArray(prog,contextVars(ctx,prog->nVars),evalSlot(prog,"x"),x,evalSlot(prog,"v"),out,n,&ran);
 }
 
-int checkProbability(valStruct in,controlStruct *control)
+int checkProbability(valStruct in,exprContext *ctx)
 {
-  int res;
-  char process[1024];
-  strcpy(process,"v = ");
-  strcat(process,in.inVal);
-  res = runEvaluateExpression(process,control);
-  if (variable[0].value > 0.1)
+  if (evaluateValue(in.inVal,0,ctx) > 0.1)
     return 1;
   else
     return 0;
 }
+
+// Selects the stream used by random values in expressions. Each stage of a
+// realisation uses its own stream so that the values do not depend on the
+// stages that came before it (index -1 keeps these separate from the streams
+// used directly by the create* routines)
+void setExpressionStream(controlStruct *control,int r,int effect)
+{
+  TKstreamInit(&(control->expr.ranStream),control->seed,r,-1,effect,-1);
+}
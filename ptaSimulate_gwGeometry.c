@@ -0,0 +1,186 @@
+// Antenna response of a pulsar to a single GW source (createGW types 2, 4
+// and 6)
+//
+// The plus and cross responses only depend on the positions of the pulsar
+// and of the source. For a source whose position is the same in every
+// realisation they are held in a process-wide table keyed by the positions,
+// so they are worked out once for each (pulsar, source) pair and shared by
+// all of the realisations and threads. A source with a random position is
+// worked out afresh each time, so the table holds at most one entry for
+// each pair.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include "ptaSimulate.h"
+
+#define GW_GEOMETRY_SIZE0 64 // Initial number of slots in the table (a power of two)
+
+typedef struct geometryEntry {
+  double key[4]; // Pulsar longitude and latitude, source longitude and latitude (rad)
+  gwResponse response;
+  int used;
+} geometryEntry;
+
+static geometryEntry *table = NULL;
+static size_t tableSize = 0,tableUsed = 0;
+static pthread_mutex_t geometryLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Response of the pulsar at (lambda_p, beta_p) to the source at (lambda, beta)
+static void antennaResponse(double lambda_p,double beta_p,double lambda,double beta,gwResponse *out)
+{
+  double n1,n2,n3;
+  double e11p,e21p,e31p,e12p,e22p,e32p,e13p,e23p,e33p;
+  double e11c,e21c,e31c,e12c,e22c,e32c,e13c,e23c,e33c;
+  double cosTheta,resp,resc;
+
+  // Pulsar vector
+  n1 = cosl(lambda_p)*cosl(beta_p);
+  n2 = sinl(lambda_p)*cosl(beta_p);
+  n3 = sinl(beta_p);
+
+  cosTheta = cosl(beta)*cosl(beta_p)*cosl(lambda-lambda_p)+
+    sinl(beta)*sinl(beta_p);
+
+  // From KJ's paper
+  // Gravitational wave matrix
+
+  // NOTE: This is for the plus terms.  For cross should use different terms
+  e11p = pow(sinl(lambda),2)-pow(cosl(lambda),2)*pow(sinl(beta),2);
+  e21p = -sinl(lambda)*cosl(lambda)*(pow(sinl(beta),2)+1);
+  e31p = cosl(lambda)*sinl(beta)*cosl(beta);
+
+  e12p = -sinl(lambda)*cosl(lambda)*(pow(sinl(beta),2)+1);
+  e22p = pow(cosl(lambda),2)-pow(sinl(lambda),2)*pow(sinl(beta),2);
+  e32p = sinl(lambda)*sinl(beta)*cosl(beta);
+
+  e13p = cosl(lambda)*sinl(beta)*cosl(beta);
+  e23p = sinl(lambda)*sinl(beta)*cosl(beta);
+  e33p = -powl(cosl(beta),2);
+
+  resp = (n1*(n1*e11p+n2*e12p+n3*e13p)+
+	  n2*(n1*e21p+n2*e22p+n3*e23p)+
+	  n3*(n1*e31p+n2*e32p+n3*e33p));
+
+  if ((1-cosTheta)==0.0)
+    resp = 0.0;  // Check if this is sensible
+  else
+    resp = 1.0L/(2.0L*(1.0L-cosTheta))*(resp);
+
+  e11c = sin(2*lambda)*sin(beta);
+  e21c = -cos(2*lambda)*sin(beta);
+  e31c = -sin(lambda)*cos(beta);
+
+  e12c = -cos(2*lambda)*sin(beta);
+  e22c = -sin(2*lambda)*sin(beta);
+  e32c = cos(lambda)*cos(beta);
+
+  e13c = -sin(lambda)*cos(beta);
+  e23c = cos(lambda)*cos(beta);
+  e33c  = 0;
+
+  resc = (n1*(n1*e11c+n2*e12c+n3*e13c)+
+	  n2*(n1*e21c+n2*e22c+n3*e23c)+
+	  n3*(n1*e31c+n2*e32c+n3*e33c));
+
+  if ((1-cosTheta)==0.0)
+    resc = 0.0;  // Check if this is sensible
+  else
+    resc = 1.0L/(2.0L*(1.0L-cosTheta))*(resc);
+
+  out->resp = resp;
+  out->resc = resc;
+  out->cosTheta = cosTheta;
+}
+
+static size_t hashKey(const double *key)
+{
+  uint64_t h = 1469598103934665603ULL,bits;
+  int i;
+
+  for (i=0;i<4;i++)
+    {
+      memcpy(&bits,&key[i],sizeof(bits));
+      h = (h ^ bits)*1099511628211ULL;
+      h ^= h >> 29;
+    }
+  return (size_t)h;
+}
+
+// Slot for key in a table of size slots
+static geometryEntry *findSlot(geometryEntry *t,size_t size,const double *key)
+{
+  size_t i = hashKey(key) & (size-1);
+
+  while (t[i].used && memcmp(t[i].key,key,sizeof(t[i].key))!=0)
+    i = (i+1) & (size-1);
+  return &t[i];
+}
+
+static void growResponseTable(void)
+{
+  size_t newSize = (tableSize > 0) ? 2*tableSize : GW_GEOMETRY_SIZE0;
+  geometryEntry *newTable,*slot;
+  size_t i;
+
+  if (!(newTable = (geometryEntry *)calloc(newSize,sizeof(geometryEntry))))
+    {
+      printf("Unable to allocate memory for the GW antenna responses\n");
+      exit(1);
+    }
+  for (i=0;i<tableSize;i++)
+    {
+      if (table[i].used)
+	{
+	  slot = findSlot(newTable,newSize,table[i].key);
+	  *slot = table[i];
+	}
+    }
+  free(table);
+  table = newTable;
+  tableSize = newSize;
+}
+
+// Antenna response of the pulsar at (lambda_p, beta_p) to the GW source at
+// (lambda, beta), all in radians. It is kept for later calls if store is
+// non-zero (the positions are the same in every realisation)
+void gwResponseGet(double lambda_p,double beta_p,double lambda,double beta,int store,gwResponse *out)
+{
+  double key[4];
+  geometryEntry *slot;
+
+  if (!store)
+    {
+      antennaResponse(lambda_p,beta_p,lambda,beta,out);
+      return;
+    }
+  key[0] = lambda_p;
+  key[1] = beta_p;
+  key[2] = lambda;
+  key[3] = beta;
+  pthread_mutex_lock(&geometryLock);
+  if (2*(tableUsed+1) > tableSize)
+    growResponseTable();
+  slot = findSlot(table,tableSize,key);
+  if (!slot->used)
+    {
+      memcpy(slot->key,key,sizeof(key));
+      antennaResponse(lambda_p,beta_p,lambda,beta,&(slot->response));
+      slot->used = 1;
+      tableUsed++;
+    }
+  *out = slot->response;
+  pthread_mutex_unlock(&geometryLock);
+}
+
+void gwResponseCleanup(void)
+{
+  pthread_mutex_lock(&geometryLock);
+  free(table);
+  table = NULL;
+  tableSize = tableUsed = 0;
+  pthread_mutex_unlock(&geometryLock);
+}
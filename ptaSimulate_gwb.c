@@ -0,0 +1,305 @@
+// Residuals from a background of discrete GW sources (createGW type 1)
+//
+// calculateResidualGW works out the antenna response, the angle to the
+// pulsar and the phase of the pulsar term for every ToA, although these only
+// depend on the pulsar and the source. For a given pulsar each source
+// therefore reduces to
+//   res(t) = a sin(omega t) + b cos(omega t)
+// with a and b found once (in long double) from the earth and pulsar terms.
+// The sum over the sources is then a double precision loop over arrays.
+// ToAs at the same epoch (e.g. several observing systems or channels) reuse
+// the previous sum, and ToAs that are evenly spaced advance sin and cos by a
+// rotation instead of calling sin() and cos() again.
+//
+// With 'gwPrecision: fast' the coefficients are also found in double
+// precision. Only the pulsar term phase, which can be ~1e8 rad, needs more
+// than double; it is carried as a double-double (an unevaluated sum hi+lo)
+// until it has been reduced to [-pi, pi]. 'gwPrecision: check' does the
+// same and also sums calculateResidualGW in long double for every ToA, to
+// report the largest difference from that reference at the end of the run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include "ptaSimulate.h"
+#include "GWsim.h"
+
+#define GWB_RESEED   64   // Largest number of rotations before sin and cos are recalculated
+#define GWB_STEP_TOL 1e-7 // ToA spacings (s) that differ by less than this are taken as equal
+#define TWOPI_HI 6.283185307179586232e+00 // 2 pi = TWOPI_HI + TWOPI_LO
+#define TWOPI_LO 2.449293598294706414e-16
+
+typedef struct ddouble {
+  double hi,lo;
+} ddouble;
+
+// Largest differences from the long double reference ('gwPrecision: check')
+static double checkDev = 0,checkRes = 0;
+static long checkSets = 0;
+static pthread_mutex_t checkLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Coefficients of sin(omega t) and cos(omega t) for the source as seen by
+// the pulsar in direction kp at distance dist (as calculateResidualGW)
+static void sourceCoefficients(long double *kp,gwSrc *gw,long double dist,double *a,double *b)
+{
+  long double VC = 299792458.0L; /* Speed of light (m/s)                       */
+  long double tempVal[3],tempVal_im[3];
+  long double cosMu,psrVal1=0.0L,psrVal1_im=0.0L;
+  long double sa,sb,phase;
+  int i,k;
+
+  for (i=0;i<3;i++)
+    {
+      tempVal[i] = 0.0;
+      tempVal_im[i] = 0.0;
+      for (k=0;k<3;k++)
+	{
+	  tempVal[i]    += gw->h[i][k]*kp[k];
+	  tempVal_im[i] += gw->h_im[i][k]*kp[k];
+	}
+    }
+  cosMu = dotProduct(kp,gw->kg);
+  if ((1+cosMu)!=0)
+    {
+      psrVal1    = 0.5L/(1.0L+cosMu)*dotProduct(kp,tempVal);
+      psrVal1_im = 0.5L/(1.0L+cosMu)*dotProduct(kp,tempVal_im);
+    }
+
+  // Earth term: psrVal1 sin(phase+omega t) + psrVal1_im cos(phase+omega t)
+  phase = gw->phase_g;
+  sa = psrVal1*cosl(phase) - psrVal1_im*sinl(phase);
+  sb = psrVal1*sinl(phase) + psrVal1_im*cosl(phase);
+  // Pulsar term, with the phase delayed by the light travel time
+  if (dist != 0)
+    {
+      phase = gw->phase_g-(1+cosMu)*dist/VC*gw->omega_g;
+      sa -= psrVal1*cosl(phase) - psrVal1_im*sinl(phase);
+      sb -= psrVal1*sinl(phase) + psrVal1_im*cosl(phase);
+    }
+  *a = (double)(sa/gw->omega_g);
+  *b = (double)(sb/gw->omega_g);
+}
+
+static ddouble ddFromLong(long double x)
+{
+  ddouble r;
+
+  r.hi = (double)x;
+  r.lo = (double)(x-r.hi);
+  return r;
+}
+
+// a+b for |a| >= |b|, normalised
+static ddouble quickTwoSum(double a,double b)
+{
+  ddouble r;
+
+  r.hi = a+b;
+  r.lo = b-(r.hi-a);
+  return r;
+}
+
+static ddouble ddAdd(ddouble a,ddouble b)
+{
+  double s = a.hi+b.hi;
+  double v = s-a.hi;
+  double e = (a.hi-(s-v))+(b.hi-v);
+
+  return quickTwoSum(s,e+a.lo+b.lo);
+}
+
+static ddouble ddMul(ddouble a,ddouble b)
+{
+  double p = a.hi*b.hi;
+
+  return quickTwoSum(p,fma(a.hi,b.hi,-p)+(a.hi*b.lo+a.lo*b.hi));
+}
+
+// x reduced to [-pi, pi]
+static double ddReduce(ddouble x)
+{
+  double k = nearbyint(x.hi/TWOPI_HI);
+  double p = k*TWOPI_HI;
+  ddouble r,kp;
+
+  kp.hi = -p;
+  kp.lo = -fma(k,TWOPI_HI,-p);
+  r = ddAdd(x,kp);
+  return r.hi+(r.lo-k*TWOPI_LO);
+}
+
+// As sourceCoefficients, in double precision apart from the pulsar term
+// phase. kpdd is kp as double-doubles and travel is dist/c (s)
+static void sourceCoefficientsFast(const ddouble *kpdd,gwSrc *gw,ddouble travel,double *a,double *b)
+{
+  double tempVal,tempVal_im,psrVal1=0,psrVal1_im=0,opc,omega;
+  double phase,sa,sb;
+  ddouble onePlusCosMu,x;
+  int i,k;
+
+  // 1+cosMu is kept to double-double accuracy as it multiplies the travel time
+  onePlusCosMu.hi = 1;
+  onePlusCosMu.lo = 0;
+  for (i=0;i<3;i++)
+    onePlusCosMu = ddAdd(onePlusCosMu,ddMul(kpdd[i],ddFromLong(gw->kg[i])));
+  opc = onePlusCosMu.hi+onePlusCosMu.lo;
+  if (opc != 0)
+    {
+      for (i=0;i<3;i++)
+	{
+	  tempVal = tempVal_im = 0;
+	  for (k=0;k<3;k++)
+	    {
+	      tempVal    += (double)gw->h[i][k]*kpdd[k].hi;
+	      tempVal_im += (double)gw->h_im[i][k]*kpdd[k].hi;
+	    }
+	  psrVal1    += kpdd[i].hi*tempVal;
+	  psrVal1_im += kpdd[i].hi*tempVal_im;
+	}
+      psrVal1    *= 0.5/opc;
+      psrVal1_im *= 0.5/opc;
+    }
+
+  omega = (double)gw->omega_g;
+  phase = (double)gw->phase_g;
+  sa = psrVal1*cos(phase) - psrVal1_im*sin(phase);
+  sb = psrVal1*sin(phase) + psrVal1_im*cos(phase);
+  if (travel.hi != 0)
+    {
+      x = ddMul(ddMul(onePlusCosMu,travel),ddFromLong(gw->omega_g));
+      x.hi = -x.hi;
+      x.lo = -x.lo;
+      phase = ddReduce(ddAdd(ddFromLong(gw->phase_g),x));
+      sa -= psrVal1*cos(phase) - psrVal1_im*sin(phase);
+      sb -= psrVal1*sin(phase) + psrVal1_im*cos(phase);
+    }
+  *a = sa/omega;
+  *b = sb/omega;
+}
+
+// Compares gwRes with the sum of calculateResidualGW over the sources
+static void checkResiduals(controlStruct *control,int p,long double *kp,long double dist,
+			   gwSrc *gw,int ngw,toaEpoch timeOffset,const long double *gwRes)
+{
+  const toaEpoch *sat = control->psr[p].toa.sat;
+  int ntoa = control->psr[p].nToAs;
+  long double ref,time;
+  double dev=0,res=0;
+  int i,k;
+
+  for (i=0;i<ntoa;i++)
+    {
+      time = (epochToLong(sat[i]) - epochToLong(timeOffset))*86400.0L;
+      ref = 0;
+      for (k=0;k<ngw;k++)
+	ref += calculateResidualGW(kp,&gw[k],time,dist);
+      if (fabs((double)(gwRes[i]-ref)) > dev) dev = fabs((double)(gwRes[i]-ref));
+      if (fabs((double)ref) > res) res = fabs((double)ref);
+    }
+  pthread_mutex_lock(&checkLock);
+  if (dev > checkDev) checkDev = dev;
+  if (res > checkRes) checkRes = res;
+  checkSets++;
+  pthread_mutex_unlock(&checkLock);
+}
+
+// Residuals (s) induced in pulsar p by the ngw sources in gw, for the ToAs
+// at times (sat - timeOffset) days. kp points to the pulsar, which is at
+// distance dist (m; 0 for no pulsar term)
+void gwbResiduals(controlStruct *control,int p,long double *kp,long double dist,
+		  gwSrc *gw,int ngw,toaEpoch timeOffset,long double *gwRes)
+{
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  const toaEpoch *sat = control->psr[p].toa.sat;
+  int ntoa = control->psr[p].nToAs;
+  double *omega,*a,*b,*s,*c,*sd,*cd;
+  double t,dt,step=0,last=0,prevDt=0,sum,sn;
+  int i,k,n=0,nrot=0,stepSet=0; // n counts the distinct epochs
+  ddouble kpdd[3],travel;
+
+  omega = (double *)arenaAlloc(&(control->scratch),sizeof(double)*ngw*7);
+  a = omega+ngw;
+  b = omega+2*ngw;
+  s = omega+3*ngw;
+  c = omega+4*ngw;
+  sd = omega+5*ngw;
+  cd = omega+6*ngw;
+  if (control->gwPrecision == GW_PRECISION_LONG)
+    {
+      for (k=0;k<ngw;k++)
+	sourceCoefficients(kp,&gw[k],dist,&a[k],&b[k]);
+    }
+  else
+    {
+      travel = ddFromLong(dist/299792458.0L);
+      for (k=0;k<3;k++)
+	kpdd[k] = ddFromLong(kp[k]);
+      for (k=0;k<ngw;k++)
+	sourceCoefficientsFast(kpdd,&gw[k],travel,&a[k],&b[k]);
+    }
+  for (k=0;k<ngw;k++)
+    omega[k] = (double)gw[k].omega_g;
+
+  for (i=0;i<ntoa;i++)
+    {
+      if (i > 0 && sat[i].day == sat[i-1].day && sat[i].frac == sat[i-1].frac)
+	{
+	  gwRes[i] = gwRes[i-1];
+	  continue;
+	}
+      t = epochSeconds(sat[i],timeOffset);
+      dt = t-last;
+      // Set up the rotation for a spacing that has been seen twice running
+      if (n > 1 && fabs(dt-prevDt) < GWB_STEP_TOL && (!stepSet || fabs(dt-step) >= GWB_STEP_TOL))
+	{
+	  for (k=0;k<ngw;k++)
+	    {
+	      sd[k] = sin(omega[k]*dt);
+	      cd[k] = cos(omega[k]*dt);
+	    }
+	  step = dt;
+	  stepSet = 1;
+	  nrot = 0;
+	}
+      sum = 0;
+      if (n > 0 && stepSet && nrot < GWB_RESEED && fabs(dt-step) < GWB_STEP_TOL)
+	{
+	  for (k=0;k<ngw;k++)
+	    {
+	      sn   = s[k]*cd[k] + c[k]*sd[k];
+	      c[k] = c[k]*cd[k] - s[k]*sd[k];
+	      s[k] = sn;
+	      sum += a[k]*s[k] + b[k]*c[k];
+	    }
+	  nrot++;
+	}
+      else
+	{
+	  for (k=0;k<ngw;k++)
+	    {
+	      s[k] = sin(omega[k]*t);
+	      c[k] = cos(omega[k]*t);
+	      sum += a[k]*s[k] + b[k]*c[k];
+	    }
+	  nrot = 0;
+	}
+      prevDt = dt;
+      last = t;
+      n++;
+      gwRes[i] = sum;
+    }
+  if (control->gwPrecision == GW_PRECISION_CHECK)
+    checkResiduals(control,p,kp,dist,gw,ngw,timeOffset,gwRes);
+  arenaRelease(&(control->scratch),mark);
+}
+
+// Prints the largest difference found with 'gwPrecision: check'
+void gwbPrecisionReport(void)
+{
+  pthread_mutex_lock(&checkLock);
+  if (checkSets > 0)
+    printf("GW background precision check: largest difference from long double %g s (%g of the largest residual) in %ld sets of residuals\n",
+	   checkDev,(checkRes > 0) ? checkDev/checkRes : 0.0,checkSets);
+  pthread_mutex_unlock(&checkLock);
+}
@@ -0,0 +1,233 @@
+// Indexed cache of GW background source sets ('gwb:' with cache=)
+//
+// The sources made by GWbackground and setupGW for each realisation (and
+// each batch within it) are stored, including the derived strain tensors
+// and directions, so that a later run can reuse exactly the same GW skies
+// (for instance after adding pulsars or changing the noise) without making
+// them again. The file starts with a header and an index with one slot per
+// (realisation, batch) giving the offset of its record, so any set is found
+// with a single seek. A record holds the background parameters followed by
+// the ngw sources. The file is written in the native layout of gwSrc, which
+// is checked on opening.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "ptaSimulate.h"
+#include "GWsim.h"
+
+#define GWB_CACHE_MAGIC   "PTAGWBC1"
+#define GWB_CACHE_VERSION 1
+
+typedef struct gwbCacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize; // sizeof(gwSrc) when the file was made
+  uint32_t ngw;        // Sources in each set
+  uint32_t nbatch;     // Sets in each realisation
+  uint64_t nslot;      // Slots in the index that follows
+} gwbCacheHeader;
+
+typedef struct gwbRecordHeader {
+  double amp,alpha,flo,fhi; // Parameters the sources were made with
+} gwbRecordHeader;
+
+typedef struct gwbCacheFile {
+  char *fname;
+  int fd;
+  gwbCacheHeader header;
+  uint64_t *index;   // Offset of each record, 0 if not stored
+  struct gwbCacheFile *next;
+} gwbCacheFile;
+
+static gwbCacheFile *cacheFiles = NULL;
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void cacheIO(gwbCacheFile *c,int write,void *buf,size_t n,uint64_t offset)
+{
+  ssize_t done = write ? pwrite(c->fd,buf,n,(off_t)offset) : pread(c->fd,buf,n,(off_t)offset);
+
+  if (done != (ssize_t)n)
+    {
+      printf("Unable to %s the GW background cache %s\n",write ? "write" : "read",c->fname);
+      exit(1);
+    }
+}
+
+// Opens (or creates, with nslot slots) the cache file fname, with the
+// write lock held
+static gwbCacheFile *openCache(const char *fname,int ngw,int nbatch,uint64_t nslot)
+{
+  gwbCacheFile *c;
+  struct stat st;
+
+  for (c=cacheFiles;c!=NULL;c=c->next)
+    {
+      if (strcmp(c->fname,fname)==0)
+	return c;
+    }
+  if (!(c = (gwbCacheFile *)malloc(sizeof(gwbCacheFile))) || !(c->fname = strdup(fname)))
+    {
+      printf("Unable to allocate memory for the GW background cache %s\n",fname);
+      exit(1);
+    }
+  if ((c->fd = open(fname,O_RDWR|O_CREAT,0644)) < 0 || fstat(c->fd,&st)!=0)
+    {
+      printf("Unable to open the GW background cache %s\n",fname);
+      exit(1);
+    }
+  if (st.st_size == 0)
+    {
+      memset(&(c->header),0,sizeof(gwbCacheHeader));
+      memcpy(c->header.magic,GWB_CACHE_MAGIC,sizeof(c->header.magic));
+      c->header.version = GWB_CACHE_VERSION;
+      c->header.recordSize = sizeof(gwSrc);
+      c->header.ngw = ngw;
+      c->header.nbatch = nbatch;
+      c->header.nslot = nslot;
+      if (!(c->index = (uint64_t *)calloc(nslot,sizeof(uint64_t))))
+	{
+	  printf("Unable to allocate memory for the GW background cache %s\n",fname);
+	  exit(1);
+	}
+      cacheIO(c,1,&(c->header),sizeof(gwbCacheHeader),0);
+      cacheIO(c,1,c->index,sizeof(uint64_t)*nslot,sizeof(gwbCacheHeader));
+      printf("Created GW background cache %s for %d realisations\n",fname,(int)(nslot/nbatch));
+    }
+  else
+    {
+      cacheIO(c,0,&(c->header),sizeof(gwbCacheHeader),0);
+      if (memcmp(c->header.magic,GWB_CACHE_MAGIC,sizeof(c->header.magic))!=0 ||
+	  c->header.version != GWB_CACHE_VERSION || c->header.recordSize != sizeof(gwSrc))
+	{
+	  printf("%s is not a GW background cache from this version of ptaSimulate on this machine\n",fname);
+	  exit(1);
+	}
+      if (c->header.ngw != (uint32_t)ngw || c->header.nbatch != (uint32_t)nbatch)
+	{
+	  printf("The GW background cache %s has %d sources in %d batches, but %d sources in %d batches are needed\n",
+		 fname,(int)c->header.ngw,(int)c->header.nbatch,ngw,nbatch);
+	  exit(1);
+	}
+      if (!(c->index = (uint64_t *)malloc(sizeof(uint64_t)*c->header.nslot)))
+	{
+	  printf("Unable to allocate memory for the GW background cache %s\n",fname);
+	  exit(1);
+	}
+      cacheIO(c,0,c->index,sizeof(uint64_t)*c->header.nslot,sizeof(gwbCacheHeader));
+      printf("Opened GW background cache %s\n",fname);
+    }
+  c->next = cacheFiles;
+  cacheFiles = c;
+  return c;
+}
+
+// Fills gw with the nbatch*ngw sources of realisation r. They are read from
+// the cache file fname if every batch of the realisation is there with the
+// same parameters; otherwise they are made as usual from stream and the
+// missing sets are added to the cache (replacing any made with other
+// parameters)
+void gwbCacheSources(controlStruct *control,const char *fname,int r,gwSrc *gw,int ngw,TKstream *stream,
+		     long double flo,long double fhi,double gwAmp,double alpha,int logspacing)
+{
+  int nbatch = control->nbatch;
+  gwbCacheFile *c;
+  gwbRecordHeader rec,want;
+  uint64_t slot,offset;
+  size_t setSize = sizeof(gwSrc)*ngw;
+  struct stat st;
+  int b,i,found=1;
+
+  memset(&want,0,sizeof(want));
+  want.amp = gwAmp;
+  want.alpha = alpha;
+  want.flo = (double)flo;
+  want.fhi = (double)fhi;
+
+  pthread_mutex_lock(&cacheLock);
+  c = openCache(fname,ngw,nbatch,(uint64_t)control->nreal*nbatch);
+  for (b=0;b<nbatch && found;b++)
+    {
+      slot = (uint64_t)r*nbatch+b;
+      if (slot >= c->header.nslot || c->index[slot] == 0)
+	found = 0;
+      else
+	{
+	  cacheIO(c,0,&rec,sizeof(rec),c->index[slot]);
+	  if (memcmp(&rec,&want,sizeof(rec))!=0)
+	    {
+	      printf("WARNING: the GW background cache %s has realisation %d with different parameters; replacing it\n",fname,r);
+	      found = 0;
+	    }
+	}
+    }
+  if (found)
+    {
+      for (b=0;b<nbatch;b++)
+	cacheIO(c,0,gw+b*ngw,setSize,c->index[(uint64_t)r*nbatch+b]+sizeof(gwbRecordHeader));
+      pthread_mutex_unlock(&cacheLock);
+      printf("Read the GW background for realisation %d from %s\n",r,fname);
+      return;
+    }
+  pthread_mutex_unlock(&cacheLock);
+
+  // Made exactly as without the cache, so the two give the same skies
+  for (b=0;b<nbatch;b++)
+    GWbackground(gw+b*ngw,ngw,stream,flo,fhi,gwAmp,alpha,logspacing);
+  for (i=0;i<ngw*nbatch;i++)
+    setupGW(&gw[i]);
+
+  pthread_mutex_lock(&cacheLock);
+  for (b=0;b<nbatch;b++)
+    {
+      slot = (uint64_t)r*nbatch+b;
+      if (slot >= c->header.nslot)
+	{
+	  printf("WARNING: realisation %d is beyond the end of the GW background cache %s and is not stored\n",r,fname);
+	  break;
+	}
+      // Kept if already stored with these parameters (e.g. by another thread). A
+      // set made with other parameters is replaced: the new record is appended
+      // and the index points to it, leaving the old record unused in the file
+      if (c->index[slot] != 0)
+	{
+	  cacheIO(c,0,&rec,sizeof(rec),c->index[slot]);
+	  if (memcmp(&rec,&want,sizeof(rec))==0)
+	    continue;
+	}
+      if (fstat(c->fd,&st)!=0)
+	{
+	  printf("Unable to read the GW background cache %s\n",fname);
+	  exit(1);
+	}
+      offset = (uint64_t)st.st_size;
+      cacheIO(c,1,&want,sizeof(want),offset);
+      cacheIO(c,1,gw+b*ngw,setSize,offset+sizeof(want));
+      // The index entry is written last, so an interrupted write leaves the slot empty
+      c->index[slot] = offset;
+      cacheIO(c,1,&(c->index[slot]),sizeof(uint64_t),sizeof(gwbCacheHeader)+slot*sizeof(uint64_t));
+    }
+  pthread_mutex_unlock(&cacheLock);
+}
+
+void gwbCacheCleanup(void)
+{
+  gwbCacheFile *c,*next;
+
+  pthread_mutex_lock(&cacheLock);
+  for (c=cacheFiles;c!=NULL;c=next)
+    {
+      next = c->next;
+      close(c->fd);
+      free(c->index);
+      free(c->fname);
+      free(c);
+    }
+  cacheFiles = NULL;
+  pthread_mutex_unlock(&cacheLock);
+}
@@ -0,0 +1,245 @@
+// GW background drawn in a Fourier basis ('gwb:' with nfreq=)
+//
+// Instead of summing plane waves from many discrete sources, the residuals
+// of every pulsar are written as
+//   r_p(t) = sum_k a_pk sin(2 pi k t/T) + b_pk cos(2 pi k t/T),  k = 1..nfreq
+// where T is nspan times the span of the simulation (power at frequencies
+// below 1/T is left out, so T should be longer than the data span unless
+// only the correlations are of interest). For a background with
+// characteristic strain h_c(f) = A f^alpha the residual power spectrum is
+//   P(f) = h_c(f)^2/(12 pi^2 f^3)
+// so each coefficient has variance P(k/T)/T, and the coefficients of the
+// different pulsars are correlated by the Hellings & Downs overlap reduction
+// function. As for the discrete background, a pulsar with no distance (dist
+// 0) has no pulsar term, so its autocorrelation is 0.5 rather than 1. They
+// are drawn for all the pulsars together as L z, where L is the Cholesky
+// factor of the overlap reduction matrix and z is white. L only depends on
+// the pulsar positions, so it is worked out once and shared by all of the
+// realisations.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "ptaSimulate.h"
+
+#define GWB_FOURIER_BLOCK 256 // ToAs evaluated together
+
+typedef struct hdFactor {
+  int npsr;
+  double *gamma; // Overlap reduction matrix
+  double *L;     // Its lower triangular Cholesky factor
+  struct hdFactor *next;
+} hdFactor;
+
+static hdFactor *factors = NULL;
+static pthread_mutex_t factorLock = PTHREAD_MUTEX_INITIALIZER;
+
+static double *gwbFourierAlloc(size_t n)
+{
+  double *ptr = (double *)malloc(n*sizeof(double));
+
+  if (ptr == NULL)
+    {
+      printf("Unable to allocate memory for the Fourier GW background\n");
+      exit(1);
+    }
+  return ptr;
+}
+
+// Hellings & Downs overlap reduction matrix for the pulsars
+static void overlapReduction(controlStruct *control,double *gamma)
+{
+  int npsr = control->npsr;
+  int p1,p2;
+  double ra1,dec1,ra2,dec2,x;
+
+  for (p1=0;p1<npsr;p1++)
+    {
+      ra1 = control->psr[p1].rajd*M_PI/180.0;
+      dec1 = control->psr[p1].decjd*M_PI/180.0;
+      gamma[p1*npsr+p1] = (control->psr[p1].dist == 0) ? 0.5 : 1.0; // Without and with the pulsar term
+      for (p2=0;p2<p1;p2++)
+	{
+	  ra2 = control->psr[p2].rajd*M_PI/180.0;
+	  dec2 = control->psr[p2].decjd*M_PI/180.0;
+	  x = 0.5*(1.0-(cos(dec1)*cos(dec2)*cos(ra1-ra2)+sin(dec1)*sin(dec2)));
+	  if (x > 0)
+	    gamma[p1*npsr+p2] = 1.5*x*log(x)-0.25*x+0.5;
+	  else
+	    gamma[p1*npsr+p2] = 0.5;
+	  gamma[p2*npsr+p1] = gamma[p1*npsr+p2];
+	}
+    }
+}
+
+// Cholesky factor of the overlap reduction matrix, made on first use for
+// each arrangement of the pulsars
+static const double *hdCholesky(controlStruct *control)
+{
+  int npsr = control->npsr;
+  int i,j,k;
+  double *gamma = gwbFourierAlloc((size_t)npsr*npsr);
+  double *L,sum;
+  hdFactor *f;
+
+  overlapReduction(control,gamma);
+  pthread_mutex_lock(&factorLock);
+  for (f=factors;f!=NULL;f=f->next)
+    {
+      if (f->npsr == npsr && memcmp(f->gamma,gamma,sizeof(double)*npsr*npsr)==0)
+	break;
+    }
+  if (f == NULL)
+    {
+      if (!(f = (hdFactor *)malloc(sizeof(hdFactor))))
+	{
+	  printf("Unable to allocate memory for the Fourier GW background\n");
+	  exit(1);
+	}
+      L = gwbFourierAlloc((size_t)npsr*npsr);
+      for (i=0;i<npsr;i++)
+	{
+	  for (j=0;j<=i;j++)
+	    {
+	      sum = gamma[i*npsr+j];
+	      for (k=0;k<j;k++)
+		sum -= L[i*npsr+k]*L[j*npsr+k];
+	      if (i == j)
+		{
+		  if (sum <= 0)
+		    {
+		      printf("The overlap reduction matrix is not positive definite (are two pulsars in the same direction?)\n");
+		      exit(1);
+		    }
+		  L[i*npsr+i] = sqrt(sum);
+		}
+	      else
+		L[i*npsr+j] = sum/L[j*npsr+j];
+	    }
+	  for (j=i+1;j<npsr;j++)
+	    L[i*npsr+j] = 0;
+	}
+      printf("Factorised the overlap reduction matrix for %d pulsars\n",npsr);
+      f->npsr = npsr;
+      f->gamma = gamma;
+      f->L = L;
+      f->next = factors;
+      factors = f;
+      gamma = NULL;
+    }
+  pthread_mutex_unlock(&factorLock);
+  free(gamma);
+  return f->L;
+}
+
+// Fourier coefficients for nbatch backgrounds with amplitude amp (scaled as
+// for the discrete sources, so h_c(f) = amp f^alpha with f in Hz), on a grid
+// of nfreq frequencies spaced by 1/period (period in days). They are stored
+// as [batch][frequency][sin,cos][pulsar] and should be freed by the caller
+double *gwbFourierCoeffs(controlStruct *control,TKstream *stream,int nfreq,double period,
+			 double amp,double alpha,int nbatch)
+{
+  int npsr = control->npsr;
+  double tspan = period*86400.0;
+  const double *L = hdCholesky(control);
+  double *coeffs = gwbFourierAlloc((size_t)nbatch*nfreq*2*npsr);
+  double *z = gwbFourierAlloc((size_t)npsr);
+  double *x,f,sigma,sum;
+  int b,k,j,p1,p2;
+
+  for (b=0;b<nbatch;b++)
+    {
+      for (k=1;k<=nfreq;k++)
+	{
+	  f = k/tspan;
+	  sigma = sqrt(amp*amp*pow(f,2*alpha)/(12*M_PI*M_PI*f*f*f)/tspan);
+	  for (j=0;j<2;j++)
+	    {
+	      x = coeffs+(((size_t)b*nfreq+k-1)*2+j)*npsr;
+	      TKgaussDevFill(stream,z,npsr);
+	      for (p1=0;p1<npsr;p1++)
+		{
+		  sum = 0;
+		  for (p2=0;p2<=p1;p2++)
+		    sum += L[p1*npsr+p2]*z[p2];
+		  x[p1] = sigma*sum;
+		}
+	    }
+	}
+    }
+  free(z);
+  return coeffs;
+}
+
+// Residuals (s) of pulsar p from one background (coeffs for one batch, as
+// made by gwbFourierCoeffs with the same period) for the ToAs at times
+// (sat - timeOffset) days
+void gwbFourierResiduals(controlStruct *control,int p,const double *coeffs,int nfreq,double period,
+			 toaEpoch timeOffset,long double *gwRes)
+{
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  int npsr = control->npsr;
+  int ntoa = control->psr[p].nToAs;
+  const toaEpoch *sat = control->psr[p].toa.sat;
+  double *a,*b,*s1,*c1,*s,*c,*sum,sn,x;
+  int i,i0,n,k;
+
+  a = (double *)arenaAlloc(&(control->scratch),sizeof(double)*(2*nfreq+5*GWB_FOURIER_BLOCK));
+  b = a+nfreq;
+  s1 = b+nfreq;
+  c1 = s1+GWB_FOURIER_BLOCK;
+  s = c1+GWB_FOURIER_BLOCK;
+  c = s+GWB_FOURIER_BLOCK;
+  sum = c+GWB_FOURIER_BLOCK;
+  for (k=0;k<nfreq;k++)
+    {
+      a[k] = coeffs[(2*k)*npsr+p];
+      b[k] = coeffs[(2*k+1)*npsr+p];
+    }
+
+  // sin and cos of the higher harmonics follow by rotation from the first
+  for (i0=0;i0<ntoa;i0+=GWB_FOURIER_BLOCK)
+    {
+      n = (ntoa-i0 < GWB_FOURIER_BLOCK) ? ntoa-i0 : GWB_FOURIER_BLOCK;
+      for (i=0;i<n;i++)
+	{
+	  x = 2*M_PI*epochSeconds(sat[i0+i],timeOffset)/(86400.0*period);
+	  s1[i] = sin(x);
+	  c1[i] = cos(x);
+	  s[i] = s1[i];
+	  c[i] = c1[i];
+	  sum[i] = a[0]*s[i] + b[0]*c[i];
+	}
+      for (k=1;k<nfreq;k++)
+	{
+	  for (i=0;i<n;i++)
+	    {
+	      sn   = s[i]*c1[i] + c[i]*s1[i];
+	      c[i] = c[i]*c1[i] - s[i]*s1[i];
+	      s[i] = sn;
+	      sum[i] += a[k]*s[i] + b[k]*c[i];
+	    }
+	}
+      for (i=0;i<n;i++)
+	gwRes[i0+i] = sum[i];
+    }
+  arenaRelease(&(control->scratch),mark);
+}
+
+void gwbFourierCleanup(void)
+{
+  hdFactor *f,*next;
+
+  pthread_mutex_lock(&factorLock);
+  for (f=factors;f!=NULL;f=next)
+    {
+      next = f->next;
+      free(f->gamma);
+      free(f->L);
+      free(f);
+    }
+  factors = NULL;
+  pthread_mutex_unlock(&factorLock);
+}
@@ -20,13 +20,15 @@ void createOutliers(controlStruct *control,int r)
   toasim_header_t* header;
   toasim_header_t* read_header;
   FILE* file;
-  double offsets[MAX_TOAS]; // Will change to doubles - should use malloc
+  arenaMark mark = arenaGetMark(&(control->scratch));
+  double *offsets = (double *)toaScratch(control,sizeof(double));
   // Create a set of corrections.
   toasim_corrections_t* corr = (toasim_corrections_t*)malloc(sizeof(toasim_corrections_t));
 
   int dd;
-  int k;
+  int k,s;
   int fail;
+  obsStruct *obs;
   corr->offsets=offsets;
   corr->params=""; // Normally leave as NULL. Can store this along with each realisation. 
   // Same length string in every iteration - defined in r_param_length see below
@@ -34,7 +36,7 @@ void createOutliers(controlStruct *control,int r)
   corr->a1=0; // a1*x
   corr->a2=0; // a2*x*X
   
-  nit = 1;
+  nit = control->nbatch;
 
   for (p=0;p<control->npsr;p++)
     {
@@ -59,22 +61,30 @@ void createOutliers(controlStruct *control,int r)
       // First we write the header...
       file = toasim_write_header(header,fname);
       
-      for (j=0;j<control->psr[p].nToAs;j++){
-	offsets[j]=0.0;
-	//	printf("outliers %d %d\n",control->psr[p].obs[j].outlierAmp.set,control->psr[p].nToAs);
-	if (control->psr[p].obs[j].outlierAmp.set==1)
-	  {
-	    fillDval(&(control->psr[p].obs[j].outlierAmp),control);
-	    fillDval(&(control->psr[p].obs[j].outlierProb),control);
-	    fail =0;
-	    fail = checkProbability(control->psr[p].obs[j].outlierProb,control);
-	    if (fail==1)
-	      offsets[j] = control->psr[p].obs[j].outlierAmp.dval;
+      for (i=0;i<nit;i++)
+	{
+	  for (j=0;j<control->psr[p].nToAs;j++){
+	    offsets[j]=0.0;
+	    // The outlier model is part of the schedule entry that made the ToA
+	    s = control->psr[p].toa.sched[j];
+	    if (s == -1)
+	      continue;
+	    obs = &(control->sched[s].obs[control->psr[p].toa.schedObs[j]]);
+	    if (obs->outlierAmp.set==1)
+	      {
+		fillDval(&(obs->outlierAmp),control);
+		fillDval(&(obs->outlierProb),control);
+		fail =0;
+		fail = checkProbability(obs->outlierProb,&(control->expr));
+		if (fail==1)
+		  offsets[j] = obs->outlierAmp.dval;
+	      }
 	  }
-      }
-      printf("Writing corrections\n");
-      toasim_write_corrections(corr,header,file);
+	  printf("Writing corrections\n");
+	  toasim_write_corrections(corr,header,file);
+	}
       printf("Complete writing\n");
       fclose(file);
     }
+  arenaRelease(&(control->scratch),mark);
 }
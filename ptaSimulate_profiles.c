@@ -0,0 +1,178 @@
+// Process-wide store of pulse profiles read from profile files
+//
+// Each profile file (a ptime template of von Mises components) is read
+// once and the profile is then sampled once for each number of bins that
+// is asked for. As the template is analytic, the samples are exact at any
+// resolution. The sampled profiles are held in aligned buffers that are
+// shared, read-only, by all of the realisations; entries are only added
+// while the store is running, so a pointer that has been handed out stays
+// valid until profileStoreCleanup().
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fftw3.h>
+#include "ptaSimulate.h"
+#include "ptimeLib.h"
+
+#define PROFILE_TEMPLATE_ROTATION 0.2 // Phase offset of the template from the profile
+
+typedef struct profileSampling {
+  int nbin;
+  double *prof;  // Profile
+  double *templ; // Template, rotated by PROFILE_TEMPLATE_ROTATION
+  struct profileSampling *next;
+} profileSampling;
+
+typedef struct profileEntry {
+  char *fname;
+  tmplStruct tmpl;
+  profileSampling *samplings;
+  struct profileEntry *next;
+} profileEntry;
+
+static profileEntry *profiles = NULL;
+static pthread_rwlock_t profileLock = PTHREAD_RWLOCK_INITIALIZER;
+
+static profileEntry *findEntry(const char *fname)
+{
+  profileEntry *e;
+
+  for (e=profiles;e!=NULL;e=e->next)
+    {
+      if (strcmp(e->fname,fname)==0)
+	break;
+    }
+  return e;
+}
+
+static profileSampling *findSampling(const char *fname,int nbin,profileEntry **entry)
+{
+  profileSampling *s;
+
+  if ((*entry = findEntry(fname)) == NULL)
+    return NULL;
+  for (s=(*entry)->samplings;s!=NULL;s=s->next)
+    {
+      if (s->nbin == nbin)
+	return s;
+    }
+  return NULL;
+}
+
+// Reads profile file fname into the store (the write lock must be held)
+static profileEntry *addEntry(const char *fname)
+{
+  profileEntry *e;
+
+  if (!(e = (profileEntry *)malloc(sizeof(profileEntry))) || !(e->fname = strdup(fname)))
+    {
+      printf("Unable to allocate memory for profile file %s\n",fname);
+      exit(1);
+    }
+  initialiseTemplate(&(e->tmpl));
+  readTemplate(e->fname,&(e->tmpl));
+  printf("Read profile file %s\n",fname);
+  e->samplings = NULL;
+  e->next = profiles;
+  profiles = e;
+  return e;
+}
+
+static double *profileBuffer(int nbin)
+{
+  double *buf = (double *)fftw_malloc(sizeof(double)*nbin);
+
+  if (buf == NULL)
+    {
+      printf("Unable to allocate memory for a profile of %d bins\n",nbin);
+      exit(1);
+    }
+  return buf;
+}
+
+// Profile and template (which may be NULL) from file fname, sampled at
+// nbin bins. The buffers belong to the store and must not be changed
+void profileStoreGet(const char *fname,int nbin,const double **prof,const double **templ)
+{
+  profileEntry *e;
+  profileSampling *s;
+  int i;
+
+  pthread_rwlock_rdlock(&profileLock);
+  s = findSampling(fname,nbin,&e);
+  pthread_rwlock_unlock(&profileLock);
+  if (s == NULL)
+    {
+      pthread_rwlock_wrlock(&profileLock);
+      // Another thread may have added it in the meantime
+      s = findSampling(fname,nbin,&e);
+      if (s == NULL)
+	{
+	  if (e == NULL)
+	    e = addEntry(fname);
+	  if (!(s = (profileSampling *)malloc(sizeof(profileSampling))))
+	    {
+	      printf("Unable to allocate memory for profile file %s\n",fname);
+	      exit(1);
+	    }
+	  s->nbin = nbin;
+	  s->prof = profileBuffer(nbin);
+	  s->templ = profileBuffer(nbin);
+	  for (i=0;i<nbin;i++)
+	    {
+	      s->prof[i] = evaluateTemplateChannel(&(e->tmpl),(double)i/(double)nbin,0,0,0);
+	      s->templ[i] = evaluateTemplateChannel(&(e->tmpl),(double)i/(double)nbin,0,0,PROFILE_TEMPLATE_ROTATION);
+	    }
+	  s->next = e->samplings;
+	  e->samplings = s;
+	}
+      pthread_rwlock_unlock(&profileLock);
+    }
+  *prof = s->prof;
+  if (templ != NULL)
+    *templ = s->templ;
+}
+
+// The template read from profile file fname, which must not be changed
+const tmplStruct *profileStoreTemplate(const char *fname)
+{
+  profileEntry *e;
+
+  pthread_rwlock_rdlock(&profileLock);
+  e = findEntry(fname);
+  pthread_rwlock_unlock(&profileLock);
+  if (e == NULL)
+    {
+      pthread_rwlock_wrlock(&profileLock);
+      if ((e = findEntry(fname)) == NULL)
+	e = addEntry(fname);
+      pthread_rwlock_unlock(&profileLock);
+    }
+  return &(e->tmpl);
+}
+
+void profileStoreCleanup(void)
+{
+  profileEntry *e,*nextEntry;
+  profileSampling *s,*nextSampling;
+
+  pthread_rwlock_wrlock(&profileLock);
+  for (e=profiles;e!=NULL;e=nextEntry)
+    {
+      nextEntry = e->next;
+      for (s=e->samplings;s!=NULL;s=nextSampling)
+	{
+	  nextSampling = s->next;
+	  fftw_free(s->prof);
+	  fftw_free(s->templ);
+	  free(s);
+	}
+      freeTemplate(&(e->tmpl));
+      free(e->fname);
+      free(e);
+    }
+  profiles = NULL;
+  pthread_rwlock_unlock(&profileLock);
+}
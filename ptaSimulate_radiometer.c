@@ -0,0 +1,138 @@
+// Analytic radiometer-noise ToA errors (see calculateToaErrRadiometer)
+//
+// With white radiometer noise of rms sigma per bin, the uncertainty of a
+// template-matching ToA is sigma/(A*sqrt(sum_i T'(phi_i)^2)) turns, where A
+// scales the template T to the observed profile and T' is its derivative
+// with respect to phase. The sum only depends on the template and on the
+// number of bins, so it is worked out once for each of these and each
+// observation's error then follows from its S/N, without simulating and
+// fitting a noisy profile.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "ptaSimulate.h"
+#include "fftCache.h"
+
+typedef struct templateEntry {
+  char *source; // Profile file or equation
+  int nbin;
+  double sum;   // Sum of the template over the bins
+  double grad2; // Sum over the bins of (dT/dphase)^2, with phase in turns
+  struct templateEntry *next;
+} templateEntry;
+
+static templateEntry *templates = NULL;
+static pthread_mutex_t templateLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Sum of (dT/dphase)^2 over the bins, from the Fourier transform of the
+// template (the Nyquist harmonic has no well defined derivative and is left
+// out)
+static double templateGradient(const double *prof,int nbin)
+{
+  fftw_complex *X = (fftw_complex *)fftw_malloc(sizeof(fftw_complex)*(nbin/2+1));
+  double *in = (double *)fftw_malloc(sizeof(double)*nbin);
+  double grad2=0,w;
+  int k;
+
+  if (X==NULL || in==NULL)
+    {
+      printf("Unable to allocate memory for the radiometer template\n");
+      exit(1);
+    }
+  memcpy(in,prof,sizeof(double)*nbin);
+  fftCacheR2C_d(nbin,in,X);
+  for (k=1;2*k<nbin;k++)
+    {
+      w = 2*M_PI*k;
+      grad2 += 2*w*w*(X[k][0]*X[k][0]+X[k][1]*X[k][1]);
+    }
+  fftw_free(in);
+  fftw_free(X);
+  return grad2/nbin;
+}
+
+// Template for pulsar p (profile file closestProf, or the profile equation
+// if closestProf is -1) with nbin bins, made on first use
+static templateEntry *getTemplate(controlStruct *control,int p,int closestProf,int nbin)
+{
+  const char *source = (closestProf >= 0) ? control->psr[p].profileFile[closestProf] : control->psr[p].profileEqn;
+  templateEntry *t;
+  const double *prof;
+  double *work=NULL,*phase;
+  int i;
+
+  pthread_mutex_lock(&templateLock);
+  for (t=templates;t!=NULL;t=t->next)
+    {
+      if (t->nbin==nbin && strcmp(t->source,source)==0)
+	break;
+    }
+  if (t == NULL)
+    {
+      if (!(t = (templateEntry *)malloc(sizeof(templateEntry))) || !(t->source = strdup(source)))
+	{
+	  printf("Unable to allocate memory for the radiometer template\n");
+	  exit(1);
+	}
+      if (closestProf >= 0)
+	profileStoreGet(control->psr[p].profileFile[closestProf],nbin,&prof,NULL);
+      else
+	{
+	  if (!(work = (double *)malloc(sizeof(double)*nbin*2)))
+	    {
+	      printf("Unable to allocate memory for the radiometer template\n");
+	      exit(1);
+	    }
+	  phase = work+nbin;
+	  for (i=0;i<nbin;i++)
+	    phase[i] = i/(double)nbin;
+	  evaluateValueArray(control->psr[p].profileEqn,phase,work,nbin,&(control->expr));
+	  prof = work;
+	}
+      t->nbin = nbin;
+      t->sum = 0;
+      for (i=0;i<nbin;i++)
+	t->sum += prof[i];
+      t->grad2 = templateGradient(prof,nbin);
+      printf("Radiometer template %s (%d bins): sum = %g, gradient = %g\n",source,nbin,t->sum,t->grad2);
+      free(work);
+      t->next = templates;
+      templates = t;
+    }
+  pthread_mutex_unlock(&templateLock);
+  return t;
+}
+
+// ToA error (in the units of p0) for pulsar p observed with the given
+// flux density and radiometer noise per bin
+double radiometerToaErr(controlStruct *control,int p,int closestProf,int nbin,double flux,double radNoise)
+{
+  templateEntry *t = getTemplate(control,p,closestProf,nbin);
+  double amp;
+
+  if (t->sum == 0 || t->grad2 <= 0)
+    {
+      printf("The profile of %s has no structure, so its ToA error cannot be calculated\n",control->psr[p].name);
+      exit(1);
+    }
+  amp = flux/t->sum*nbin; // Scaling of the template in the observed profile
+  return radNoise/(amp*sqrt(t->grad2))*control->psr[p].p0;
+}
+
+void radiometerCacheCleanup(void)
+{
+  templateEntry *t,*next;
+
+  pthread_mutex_lock(&templateLock);
+  for (t=templates;t!=NULL;t=next)
+    {
+      next = t->next;
+      free(t->source);
+      free(t);
+    }
+  templates = NULL;
+  pthread_mutex_unlock(&templateLock);
+}
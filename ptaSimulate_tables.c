@@ -0,0 +1,109 @@
+// Growable tables in the control structure
+//
+// The pulsars, observing runs, schedules, noise definitions etc. are held in
+// arrays that grow as the script is read (GROW_TABLE in ptaSimulate.h), so
+// there is no fixed limit on the size of a simulation.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ptaSimulate.h"
+
+void finishOff(controlStruct *control);
+
+// Makes sure that table (with *nalloc entries) has an entry n
+void *growTable(controlStruct *control,void *table,int *nalloc,int n,size_t size)
+{
+  int nnew;
+  char *new;
+
+  if (n < *nalloc) return table;
+  nnew = (*nalloc > 0) ? *nalloc : 4;
+  while (nnew <= n) nnew*=2;
+  if (!(new = (char *)realloc(table,nnew*size)))
+    {
+      printf("Unable to allocate memory for a table of %d entries\n",nnew);
+      finishOff(control);
+    }
+  memset(new+(*nalloc)*size,0,(nnew-*nalloc)*size);
+  *nalloc = nnew;
+  return new;
+}
+
+static void *copyTable(void *table,int n,size_t size)
+{
+  void *new;
+
+  if (n == 0) return NULL;
+  if (!(new = malloc(n*size)))
+    {
+      printf("Unable to allocate memory for a table of %d entries\n",n);
+      exit(1);
+    }
+  memcpy(new,table,n*size);
+  return new;
+}
+
+#define COPY_TABLE(dest,src,table,n,nalloc) \
+  {(dest)->table = copyTable((src)->table,(src)->n,sizeof(*((src)->table))); (dest)->nalloc = (src)->n;}
+
+// Gives dest (a copy of src made with memcpy) its own copy of each table, so
+// that it can be changed independently of src. The ToA tables are not
+// copied (see allocateObservations) and dest starts with empty scratch
+// space and expression variables
+void copyControlTables(controlStruct *dest,controlStruct *src)
+{
+  int i;
+
+  COPY_TABLE(dest,src,psr,npsr,npsrAlloc);
+  COPY_TABLE(dest,src,obsRun,nObsRun,nObsRunAlloc);
+  for (i=0;i<src->nObsRun;i++)
+    COPY_TABLE(&(dest->obsRun[i]),&(src->obsRun[i]),T2Tim,nT2Tim,nT2TimAlloc);
+  COPY_TABLE(dest,src,sched,nSched,nSchedAlloc);
+  for (i=0;i<src->nSched;i++)
+    COPY_TABLE(&(dest->sched[i]),&(src->sched[i]),obs,nObsSched,nObsSchedAlloc);
+  COPY_TABLE(dest,src,tnoise,nTnoise,nTnoiseAlloc);
+  COPY_TABLE(dest,src,planets,nPlanets,nPlanetsAlloc);
+  COPY_TABLE(dest,src,dmVar,nDMvar,nDMvarAlloc);
+  COPY_TABLE(dest,src,dmCovar,nDMcovar,nDMcovarAlloc);
+  COPY_TABLE(dest,src,dmFunc,nDMfunc,nDMfuncAlloc);
+  COPY_TABLE(dest,src,jitter,nJitter,nJitterAlloc);
+  COPY_TABLE(dest,src,gw,nGW,nGWAlloc);
+  COPY_TABLE(dest,src,rcvr,nRCVR,nRCVRAlloc);
+  COPY_TABLE(dest,src,be,nBE,nBEAlloc);
+  COPY_TABLE(dest,src,obsSys,nObsSys,nObsSysAlloc);
+  COPY_TABLE(dest,src,glitches,nGlitches,nGlitchesAlloc);
+  COPY_TABLE(dest,src,observatory,nObservatory,nObservatoryAlloc);
+  COPY_TABLE(dest,src,output,nOutput,nOutputAlloc);
+  arenaInit(&(dest->scratch),0);
+  dest->expr.vars = NULL;
+  dest->expr.nVarsAlloc = 0;
+}
+
+void freeControlTables(controlStruct *control)
+{
+  int i;
+
+  for (i=0;i<control->nObsRun;i++)
+    free(control->obsRun[i].T2Tim);
+  for (i=0;i<control->nSched;i++)
+    free(control->sched[i].obs);
+  free(control->psr);
+  free(control->obsRun);
+  free(control->sched);
+  free(control->tnoise);
+  free(control->planets);
+  free(control->dmVar);
+  free(control->dmCovar);
+  free(control->dmFunc);
+  free(control->jitter);
+  free(control->gw);
+  free(control->rcvr);
+  free(control->be);
+  free(control->obsSys);
+  free(control->glitches);
+  free(control->observatory);
+  free(control->output);
+  arenaFree(&(control->scratch));
+  free(control->expr.vars);
+}
@@ -0,0 +1,92 @@
+// Creates realisations concurrently within a single process (--threads N)
+//
+// Each worker owns a private copy of the control structure (including its
+// tables, ToAs and scratch arena), so the process* and create* routines can run
+// unchanged. The random numbers are keyed by realisation rather than drawn
+// from a shared generator, so the output does not depend on the number of
+// threads. The expression evaluator keeps its state per thread.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fftw3.h>
+#include "ptaSimulate.h"
+
+void finishOff(controlStruct *control);
+
+typedef struct workerStruct {
+  controlStruct *control; // Private copy of the control structure
+  char *dir0;
+  pthread_t thread;
+} workerStruct;
+
+static pthread_mutex_t nextRealLock = PTHREAD_MUTEX_INITIALIZER;
+static int nextReal;
+
+static void *realisationWorker(void *arg)
+{
+  workerStruct *worker = (workerStruct *)arg;
+  int r;
+
+  do {
+    pthread_mutex_lock(&nextRealLock);
+    r = nextReal++;
+    pthread_mutex_unlock(&nextRealLock);
+    if (r < worker->control->nreal)
+      runRealisation(worker->control,r,worker->dir0);
+  } while (r < worker->control->nreal);
+  return NULL;
+}
+
+void runRealisationsThreaded(controlStruct *control,char *dir0)
+{
+  workerStruct *worker;
+  int i,nthreads;
+
+  nthreads = control->nthreads;
+  if (nthreads > control->nreal-1) nthreads = control->nreal-1;
+
+  // The first realisation reads the catalogue/ephemeris files and sets the
+  // parameters that are kept constant, so create it before copying control
+  runRealisation(control,0,dir0);
+
+  printf("Creating realisations 1 to %d using %d threads\n",control->nreal-1,nthreads);
+  fftw_make_planner_thread_safe();
+  fftwf_make_planner_thread_safe();
+
+  if (!(worker = (workerStruct *)malloc(sizeof(workerStruct)*nthreads)))
+    {
+      printf("Unable to allocate memory for %d threads\n",nthreads);
+      finishOff(control);
+    }
+  nextReal = 1;
+  for (i=0;i<nthreads;i++)
+    {
+      if (!(worker[i].control = (controlStruct *)malloc(sizeof(controlStruct))))
+	{
+	  printf("Unable to allocate memory for thread %d\n",i);
+	  finishOff(control);
+	}
+      memcpy(worker[i].control,control,sizeof(controlStruct));
+      copyControlTables(worker[i].control,control);
+      allocateObservations(worker[i].control);
+      worker[i].dir0 = dir0;
+    }
+  for (i=0;i<nthreads;i++)
+    {
+      if (pthread_create(&(worker[i].thread),NULL,realisationWorker,&worker[i])!=0)
+	{
+	  printf("Unable to start thread %d\n",i);
+	  finishOff(control);
+	}
+    }
+  for (i=0;i<nthreads;i++)
+    {
+      pthread_join(worker[i].thread,NULL);
+      freeObservations(worker[i].control);
+      freeControlTables(worker[i].control);
+      free(worker[i].control);
+    }
+  free(worker);
+}
@@ -0,0 +1,133 @@
+// Per-pulsar ToA tables (see toaTable in ptaSimulate.h)
+//
+// The columns grow as ToAs are added, so each pulsar only holds as many
+// ToAs as it has actually been given.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ptaSimulate.h"
+
+void finishOff(controlStruct *control);
+
+static void *growColumn(void *col,int n,size_t size,controlStruct *control)
+{
+  void *new;
+
+  if (!(new = realloc(col,n*size)))
+    {
+      printf("Unable to allocate memory for %d ToAs\n",n);
+      finishOff(control);
+    }
+  return new;
+}
+
+// Make sure that pulsar p can hold at least n ToAs
+void reserveToAs(controlStruct *control,int p,int n)
+{
+  toaTable *toa = &(control->psr[p].toa);
+  int nalloc;
+
+  if (n <= toa->nalloc) return;
+  nalloc = (toa->nalloc > 0) ? toa->nalloc : 64;
+  while (nalloc < n) nalloc*=2;
+
+  toa->sat       = (toaEpoch *)growColumn(toa->sat,nalloc,sizeof(toaEpoch),control);
+  toa->freq      = (double *)growColumn(toa->freq,nalloc,sizeof(double),control);
+  toa->toaErr    = (double *)growColumn(toa->toaErr,nalloc,sizeof(double),control);
+  toa->dmErr     = (double *)growColumn(toa->dmErr,nalloc,sizeof(double),control);
+  toa->efac      = (double *)growColumn(toa->efac,nalloc,sizeof(double),control);
+  toa->equad     = (double *)growColumn(toa->equad,nalloc,sizeof(double),control);
+  toa->tobs      = (double *)growColumn(toa->tobs,nalloc,sizeof(double),control);
+  toa->rcvrNum   = (int *)growColumn(toa->rcvrNum,nalloc,sizeof(int),control);
+  toa->beNum     = (int *)growColumn(toa->beNum,nalloc,sizeof(int),control);
+  toa->obsSysNum = (int *)growColumn(toa->obsSysNum,nalloc,sizeof(int),control);
+  toa->tel       = (int *)growColumn(toa->tel,nalloc,sizeof(int),control);
+  toa->obsRun    = (int *)growColumn(toa->obsRun,nalloc,sizeof(int),control);
+  toa->sched     = (int *)growColumn(toa->sched,nalloc,sizeof(int),control);
+  toa->schedObs  = (int *)growColumn(toa->schedObs,nalloc,sizeof(int),control);
+  toa->nalloc = nalloc;
+}
+
+// Returns the index of telescope tel in the table, adding it if necessary
+int toaTelescopeId(toaTable *toa,const char *tel)
+{
+  int i;
+
+  for (i=0;i<toa->ntel;i++)
+    {
+      if (strcmp(toa->telName[i],tel)==0)
+	return i;
+    }
+  if (!(toa->telName = (char **)realloc(toa->telName,sizeof(char *)*(toa->ntel+1))) ||
+      !(toa->telName[toa->ntel] = strdup(tel)))
+    {
+      printf("Unable to allocate memory for telescope %s\n",tel);
+      exit(1);
+    }
+  return toa->ntel++;
+}
+
+static void freeToaTable(toaTable *toa)
+{
+  int i;
+
+  free(toa->sat);
+  free(toa->freq);
+  free(toa->toaErr);
+  free(toa->dmErr);
+  free(toa->efac);
+  free(toa->equad);
+  free(toa->tobs);
+  free(toa->rcvrNum);
+  free(toa->beNum);
+  free(toa->obsSysNum);
+  free(toa->tel);
+  free(toa->obsRun);
+  free(toa->sched);
+  free(toa->schedObs);
+  for (i=0;i<toa->ntel;i++)
+    free(toa->telName[i]);
+  free(toa->telName);
+  memset(toa,0,sizeof(toaTable));
+}
+
+// Gives each pulsar an empty ToA table. Used for the main control structure
+// and for each worker's copy of it, so any tables that were copied in are
+// left with their original owner
+void allocateObservations(controlStruct *control)
+{
+  int p;
+
+  for (p=0;p<control->npsr;p++)
+    memset(&(control->psr[p].toa),0,sizeof(toaTable));
+}
+
+void freeObservations(controlStruct *control)
+{
+  int p;
+
+  for (p=0;p<control->npsr;p++)
+    freeToaTable(&(control->psr[p].toa));
+}
+
+// Largest number of ToAs held by any pulsar
+int maxToAs(controlStruct *control)
+{
+  int p,n=0;
+
+  for (p=0;p<control->npsr;p++)
+    {
+      if (control->psr[p].nToAs > n)
+	n = control->psr[p].nToAs;
+    }
+  return n;
+}
+
+// Scratch array with room for one value (of size bytes) per ToA of any
+// pulsar, taken from the realisation's arena. The caller releases it by
+// returning the arena to an earlier mark
+void *toaScratch(controlStruct *control,size_t size)
+{
+  return arenaAlloc(&(control->scratch),size*(maxToAs(control)+1));
+}
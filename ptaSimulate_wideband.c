@@ -0,0 +1,216 @@
+// Wideband radiometer ToAs ('wideband:' in the define block and 'nchan:'
+// for the backend)
+//
+// An observation with toaerr=radiometer on a backend with more than one
+// channel is simulated across the channels. The noise-free profile of each
+// channel is the channel of the pulsar's ptime template (von Mises
+// components) that covers its frequency, or the profile equation if the
+// pulsar has no profile file. Each channel then gets radiometer noise for
+// its own bandwidth, flux density and sky temperature, and the channels
+// that share a template are fitted together (fftfitMany).
+//
+// The channel ToAs are either kept as they are ('wideband: channels') or
+// combined ('wideband: wideband') into one ToA and DM by fitting
+// t_c = t + DM/(DM_CONST f_c^2) across the channels. That ToA is referred to
+// the frequency at which its error is not correlated with the DM error.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ptaSimulate.h"
+#include "ptimeLib.h"
+#include "fftfit.h"
+
+// Entry of a frequency-dependent table closest to freq
+static int closestFreq(valStruct *f,int n,double freq)
+{
+  int i,c=0;
+
+  for (i=1;i<n;i++)
+    {
+      if (fabs(f[i].dval-freq) < fabs(f[c].dval-freq))
+	c=i;
+    }
+  return c;
+}
+
+// Channel of the template that covers freq, or else the closest one
+static int templateChannel(const tmplStruct *tmpl,double freq)
+{
+  int i,c=0;
+  double diff,best=-1;
+
+  for (i=0;i<tmpl->nchan;i++)
+    {
+      if (freq >= tmpl->channel[i].freqLow && freq <= tmpl->channel[i].freqHigh)
+	return i;
+      diff = fabs(0.5*(tmpl->channel[i].freqLow+tmpl->channel[i].freqHigh)-freq);
+      if (best < 0 || diff < best)
+	{
+	  best = diff;
+	  c = i;
+	}
+    }
+  return c;
+}
+
+// Returns the number of ToAs given by observation j of schedule s0 (for
+// observing system sys), with their frequencies (MHz) and errors (s) in
+// *freq and *toaErr, and the DM error (cm^-3 pc) in *dmErr for a wideband
+// ToA. Returns 0 if the observation should give a single radiometer ToA in
+// the usual way (including when too few channels can be fitted). The arrays
+// are taken from the scratch arena
+int widebandToaErrs(controlStruct *control,int s0,int j,int sys,double scale,int realisation,
+		    double **freq,double **toaErr,double *dmErr)
+{
+  int p,s,r,b,nchan,nbin,c,c0,i,ngood,nuse;
+  long nval;
+  double cfreq,bw,tobs,tsys,gain,tsky,flux,radNoise,sum;
+  double w,x,sw,swx,swxx,xbar;
+  double *chanFreq,*err,*prof,*templ,*noise,*phase;
+  double *shift,*eshift,*snr,*esnr,*amp,*errAmp;
+  int *tchan;
+  const tmplStruct *tmpl;
+  arena *scratch = &(control->scratch);
+  TKstream stream;
+
+  if (control->widebandMode == WIDEBAND_OFF)
+    return 0;
+  p = control->sched[s0].obs[j].psrNum;
+  s = control->sched[s0].obs[j].obsSysNum;
+  if (s != -1)
+    {
+      cfreq=control->obsSys[s].freq[sys].dval;
+      r=control->obsSys[s].rcvrNum[sys];
+      b=control->obsSys[s].beNum[sys];
+    }
+  else
+    {
+      cfreq=control->sched[s0].obs[j].freq.dval;
+      r=control->sched[s0].obs[j].rcvrNum;
+      b=control->sched[s0].obs[j].beNum;
+    }
+  nchan = (int)control->be[b].nchan.dval;
+  if (nchan <= 1)
+    return 0;
+
+  nbin = (int)control->be[b].nbin.dval;
+  bw = control->be[b].bw.dval;
+  tsys = control->rcvr[r].tsys.dval;
+  gain = control->rcvr[r].gain.dval;
+  tobs = control->psr[p].toa.tobs[control->psr[p].nToAs];
+  TKstreamInit(&stream,control->seed,realisation,p,RAN_PROFILE,control->psr[p].nToAs);
+
+  nval = (long)nchan*nbin;
+  chanFreq = (double *)arenaAlloc(scratch,sizeof(double)*nchan*8);
+  err = chanFreq+nchan;
+  shift = chanFreq+2*nchan;
+  eshift = chanFreq+3*nchan;
+  snr = chanFreq+4*nchan;
+  esnr = chanFreq+5*nchan;
+  amp = chanFreq+6*nchan;
+  errAmp = chanFreq+7*nchan;
+  tchan = (int *)arenaAlloc(scratch,sizeof(int)*nchan);
+  prof = (double *)arenaAlloc(scratch,sizeof(double)*nval);
+  templ = (double *)arenaAlloc(scratch,sizeof(double)*nval);
+  noise = (double *)arenaAlloc(scratch,sizeof(double)*nval);
+
+  for (c=0;c<nchan;c++)
+    chanFreq[c] = cfreq+bw*((c+0.5)/nchan-0.5);
+
+  // Noise-free profile in each channel
+  if (control->psr[p].nProfileFile > 0)
+    {
+      tmpl = profileStoreTemplate(control->psr[p].profileFile[closestFreq(control->psr[p].freqProfileFile,
+									  control->psr[p].nProfileFile,cfreq)]);
+      for (c=0;c<nchan;c++)
+	{
+	  tchan[c] = templateChannel(tmpl,chanFreq[c]);
+	  if (c > 0 && tchan[c] == tchan[c-1])
+	    memcpy(templ+(long)c*nbin,templ+(long)(c-1)*nbin,sizeof(double)*nbin);
+	  else
+	    evaluateTemplateChannelBins(tmpl,tchan[c],0,0,nbin,templ+(long)c*nbin);
+	}
+    }
+  else
+    {
+      phase = (double *)arenaAlloc(scratch,sizeof(double)*nbin);
+      for (i=0;i<nbin;i++)
+	phase[i] = i/(double)nbin;
+      evaluateValueArray(control->psr[p].profileEqn,phase,templ,nbin,&(control->expr));
+      tchan[0] = 0;
+      for (c=1;c<nchan;c++)
+	{
+	  tchan[c] = 0;
+	  memcpy(templ+(long)c*nbin,templ,sizeof(double)*nbin);
+	}
+    }
+
+  // Add the radiometer noise for each channel
+  TKgaussDevFill(&stream,noise,nval);
+  for (c=0;c<nchan;c++)
+    {
+      tsky = control->psr[p].tsky[closestFreq(control->psr[p].freqTsky,control->psr[p].nTsky,chanFreq[c])].dval;
+      flux = control->psr[p].flux[closestFreq(control->psr[p].freqFlux,control->psr[p].nFlux,chanFreq[c])].dval*1e-3*scale;
+      radNoise = (tsys+tsky)/(gain)/sqrt(2.0*(tobs/nbin)*bw*1e6/nchan);
+      sum=0;
+      for (i=0;i<nbin;i++)
+	sum += templ[(long)c*nbin+i];
+      for (i=0;i<nbin;i++)
+	prof[(long)c*nbin+i] = templ[(long)c*nbin+i]*(flux/sum)*nbin + noise[(long)c*nbin+i]*radNoise;
+    }
+
+  // Fit the channels that share a template together
+  for (c0=0;c0<nchan;c0=c)
+    {
+      for (c=c0+1;c<nchan && tchan[c]==tchan[c0];c++);
+      fftfitMany(prof+(long)c0*nbin,c-c0,templ+(long)c0*nbin,nbin,shift+c0,eshift+c0,
+		 snr+c0,esnr+c0,amp+c0,errAmp+c0,&ngood);
+    }
+  // Channels whose fit failed (an error of 999 bins from fftfit) or that
+  // have no usable error (a negative amplitude at low S/N) are dropped
+  for (c=0,nuse=0;c<nchan;c++)
+    {
+      if (eshift[c] == 999.0 || !isfinite(eshift[c]) || eshift[c] <= 0)
+	continue;
+      chanFreq[nuse] = chanFreq[c];
+      err[nuse++] = eshift[c]/nbin*control->psr[p].p0;
+    }
+  if (nuse < nchan)
+    printf("Dropped %d of %d channels for %s with failed profile fits\n",nchan-nuse,nchan,control->psr[p].name);
+  nchan = nuse;
+  // The wideband fit needs at least two channels
+  if (nchan == 0 || (nchan == 1 && control->widebandMode == WIDEBAND_FIT))
+    return 0;
+
+  *freq = chanFreq;
+  *toaErr = err;
+  *dmErr = 0;
+  if (control->widebandMode == WIDEBAND_CHANNELS)
+    {
+      printf("Channel ToAs for %s: %d channels from %g to %g MHz\n",control->psr[p].name,nchan,chanFreq[0],chanFreq[nchan-1]);
+      return nchan;
+    }
+
+  // Weighted straight line fit in x = 1/(DM_CONST f^2), with f in MHz
+  sw=swx=0;
+  for (c=0;c<nchan;c++)
+    {
+      w = 1.0/(err[c]*err[c]);
+      sw += w;
+      swx += w/(DM_CONST*chanFreq[c]*chanFreq[c]);
+    }
+  xbar = swx/sw;
+  swxx=0;
+  for (c=0;c<nchan;c++)
+    {
+      x = 1.0/(DM_CONST*chanFreq[c]*chanFreq[c])-xbar;
+      swxx += x*x/(err[c]*err[c]);
+    }
+  chanFreq[0] = 1.0/sqrt(DM_CONST*xbar);
+  err[0] = 1.0/sqrt(sw);
+  *dmErr = 1.0/sqrt(swxx);
+  printf("Wideband ToA for %s: freq = %g MHz, toaErr = %g s, dmErr = %g cm^-3 pc\n",control->psr[p].name,chanFreq[0],err[0],*dmErr);
+  return 1;
+}
@@ -206,6 +206,41 @@ double evaluateTemplateChannel(tmplStruct *tmpl,double phi,int chan,int stokes,d
   return result;
 }
 
+// Evaluate a given frequency channel and polarisation at nbin equally spaced
+// phases, out[i] at phase i/nbin. The cosines are found from tables made
+// once for all of the components, so each component only needs one exp()
+// per bin
+void evaluateTemplateChannelBins(const tmplStruct *tmpl,int chan,int stokes,double phiRot,int nbin,double *out)
+{
+  double *cosTab,*sinTab;
+  double cm,sm,height,conc;
+  int i,k;
+  const polStruct *pol = &(tmpl->channel[chan].pol[stokes]);
+
+  if (!(cosTab = (double *)malloc(sizeof(double)*nbin*2))){
+    printf("Error in allocating memory for the phase tables\n");
+    exit(1);
+  }
+  sinTab = cosTab+nbin;
+  for (i=0;i<nbin;i++)
+    {
+      cosTab[i] = cos(2*M_PI*i/(double)nbin);
+      sinTab[i] = sin(2*M_PI*i/(double)nbin);
+      out[i] = 0;
+    }
+  for (k=0;k<pol->nComp;k++)
+    {
+      // cos(phi-centre-phiRot) = cos(phi)cos(centre+phiRot) + sin(phi)sin(centre+phiRot)
+      cm = cos((pol->comp[k].centroid+phiRot)*2*M_PI);
+      sm = sin((pol->comp[k].centroid+phiRot)*2*M_PI);
+      height = pol->comp[k].height;
+      conc = pol->comp[k].concentration;
+      for (i=0;i<nbin;i++)
+	out[i] += height*exp(conc*(cosTab[i]*cm+sinTab[i]*sm-1));
+    }
+  free(cosTab);
+}
+
 // Allocate specific amount of memory
 void allocateMemoryTemplateDefault(tmplStruct *tmpl,int nchan,int npol,int ncomp)
 {
@@ -278,3 +313,27 @@ void saveTemplate(char *fname,tmplStruct *tmpl)
   fclose(fout);
 }
 
+
+// Frees the memory allocated for the channels, Stokes parameters and components
+void freeTemplate(tmplStruct *tmpl)
+{
+  int i,j;
+
+  if (tmpl->channelMemoryAllocated == 0)
+    return;
+  for (i=0;i<tmpl->nChannelAllocated;i++)
+    {
+      if (tmpl->channel[i].polMemoryAllocated == 0)
+	continue;
+      for (j=0;j<tmpl->channel[i].nPolAllocated;j++)
+	{
+	  if (tmpl->channel[i].pol[j].compMemoryAllocated == 1)
+	    free(tmpl->channel[i].pol[j].comp);
+	}
+      free(tmpl->channel[i].pol);
+    }
+  free(tmpl->channel);
+  tmpl->channelMemoryAllocated = 0;
+  tmpl->nChannelAllocated = 0;
+  tmpl->nchan = 0;
+}
@@ -51,7 +51,9 @@ void initialiseTemplate(tmplStruct *tmpl);
 void readTemplate(char *file,tmplStruct *tmpl);
 double evaluateTemplateComponent(tmplStruct *tmpl,double phi,int chan,int stokes,int comp,double phiRot);
 double evaluateTemplateChannel(tmplStruct *tmpl,double phi,int chan,int stokes,double phiRot);
+void evaluateTemplateChannelBins(const tmplStruct *tmpl,int chan,int stokes,double phiRot,int nbin,double *out);
 void allocateMemoryTemplateDefault(tmplStruct *tmpl,int nchan,int npol,int ncomp);
 void saveTemplate(char *fname,tmplStruct *tmpl);
+void freeTemplate(tmplStruct *tmpl);
 
 #endif
@@ -49,6 +49,7 @@ void toasim_free_corrections(toasim_corrections_t* corr);
 toasim_header_t *toasim_init_header();
 toasim_header_t *toasim_read_header(FILE *file);
 toasim_corrections_t *toasim_read_corrections(toasim_header_t *header, int nreal, FILE *file);
+double* toasim_apply_corrections(toasim_header_t* header, toasim_corrections_t* corr, double* vals);
 
 #ifdef __cplusplus
 }